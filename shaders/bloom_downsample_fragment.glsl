@@ -0,0 +1,23 @@
+#version 460 core
+
+in vec2 tex_coords;
+
+// the previous (larger) level of the bloom chain, or the bright pass for the first level
+uniform sampler2D source_sampler;
+uniform float spread;
+
+out vec4 frag_color;
+
+// dual filter downsample : center plus 4 diagonal bilinear taps, half a source texel away
+void main()
+{
+	vec2 offset = (0.5f + spread) / textureSize(source_sampler, 0);
+
+	vec3 res = texture(source_sampler, tex_coords).rgb * 4.0f;
+	res += texture(source_sampler, tex_coords + vec2(-offset.x, -offset.y)).rgb;
+	res += texture(source_sampler, tex_coords + vec2(offset.x, -offset.y)).rgb;
+	res += texture(source_sampler, tex_coords + vec2(-offset.x, offset.y)).rgb;
+	res += texture(source_sampler, tex_coords + vec2(offset.x, offset.y)).rgb;
+
+	frag_color = vec4(res / 8.0f, 1.0f);
+}
@@ -0,0 +1,26 @@
+#version 460 core
+
+in vec2 tex_coords;
+
+// the next (smaller) level of the bloom chain
+uniform sampler2D source_sampler;
+uniform float spread;
+
+out vec4 frag_color;
+
+// dual filter upsample : 8 tap tent, edge taps a full source texel away weighted 1, diagonal taps weighted 2
+void main()
+{
+	vec2 offset = (0.5f + spread) / textureSize(source_sampler, 0);
+
+	vec3 res = texture(source_sampler, tex_coords + vec2(-offset.x * 2.0f, 0.0f)).rgb;
+	res += texture(source_sampler, tex_coords + vec2(offset.x * 2.0f, 0.0f)).rgb;
+	res += texture(source_sampler, tex_coords + vec2(0.0f, -offset.y * 2.0f)).rgb;
+	res += texture(source_sampler, tex_coords + vec2(0.0f, offset.y * 2.0f)).rgb;
+	res += texture(source_sampler, tex_coords + vec2(-offset.x, offset.y)).rgb * 2.0f;
+	res += texture(source_sampler, tex_coords + vec2(offset.x, offset.y)).rgb * 2.0f;
+	res += texture(source_sampler, tex_coords + vec2(offset.x, -offset.y)).rgb * 2.0f;
+	res += texture(source_sampler, tex_coords + vec2(-offset.x, -offset.y)).rgb * 2.0f;
+
+	frag_color = vec4(res / 12.0f, 1.0f);
+}
@@ -0,0 +1,18 @@
+#version 460 core
+
+in vec2 tex_coords;
+
+// full resolution scene color, sampled at the corner shared by each 2x2 block so linear filtering averages it
+uniform sampler2D scene_sampler;
+uniform float threshold;
+uniform float intensity;
+
+out vec4 frag_color;
+
+void main()
+{
+	vec3 color = texture(scene_sampler, tex_coords).rgb;
+	float brightness = dot(color, vec3(0.2126, 0.7152, 0.0722));
+
+	frag_color = vec4(brightness > threshold ? color * intensity : vec3(0.0f), 1.0f);
+}
@@ -0,0 +1,38 @@
+#version 460 core
+
+// Depth only, for the shadow cascades and the depth prepass. Only the position (and the UVs of alpha tested
+// materials) is read, so every vertex format works : quantized positions are mapped back into mesh space by the
+// object transform.
+layout (location = 0) in vec3 in_pos;
+layout (location = 2) in vec2 in_tex_coord;
+
+#ifdef ALPHA_TEST
+out vec2 tex_coord;
+#endif
+
+struct ObjectData
+{
+	mat4 model_mat;
+	vec4 color;
+};
+
+// per object data, indexed by the base instance of each indirect draw command
+layout (std430, binding = 0) readonly buffer ObjectBuffer
+{
+	ObjectData objects[];
+};
+
+uniform mat4 view_mat;
+uniform mat4 projection_mat;
+
+// the prepass depth has to match the color pass bit for bit (GL_EQUAL), so both compute it the same way
+invariant gl_Position;
+
+void main()
+{
+#ifdef ALPHA_TEST
+	tex_coord = in_tex_coord;
+#endif
+
+	gl_Position = projection_mat * view_mat * objects[gl_BaseInstance].model_mat * vec4(in_pos, 1.0f);
+}
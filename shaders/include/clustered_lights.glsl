@@ -0,0 +1,51 @@
+// Point lights culled into clusters by ClusteredLighting, the grid size must match CLUSTER_X / Y / Z there
+
+#define CLUSTER_X 16u
+#define CLUSTER_Y 9u
+#define CLUSTER_Z 24u
+
+struct PointLight
+{
+	vec3 position;
+	float radius;
+	vec3 color;
+	float intensity;
+};
+
+layout (std430, binding = 1) readonly buffer LightBuffer
+{
+	PointLight point_lights[];
+};
+
+// (offset into light_indices, light count) per cluster
+layout (std430, binding = 2) readonly buffer ClusterBuffer
+{
+	uvec2 clusters[];
+};
+
+layout (std430, binding = 3) readonly buffer LightIndexBuffer
+{
+	uint light_indices[];
+};
+
+// screen pixels per tile, and slice = log(view depth) * scale + bias
+uniform vec2 cluster_tile_size;
+uniform float cluster_z_scale;
+uniform float cluster_z_bias;
+
+uvec2 get_cluster_lights(vec2 frag_coord, float view_depth)
+{
+	uvec2 tile = min(uvec2(frag_coord / cluster_tile_size), uvec2(CLUSTER_X - 1u, CLUSTER_Y - 1u));
+	uint slice = uint(clamp(log(view_depth) * cluster_z_scale + cluster_z_bias, 0.0f, float(CLUSTER_Z - 1u)));
+
+	return clusters[tile.x + CLUSTER_X * (tile.y + CLUSTER_Y * slice)];
+}
+
+// inverse square falloff, windowed to reach zero at the light radius
+float calc_point_attenuation(float dist, float radius)
+{
+	float ratio = dist / radius;
+	float window = clamp(1.0f - ratio * ratio * ratio * ratio, 0.0f, 1.0f);
+
+	return window * window / (dist * dist + 1.0f);
+}
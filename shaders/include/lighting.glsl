@@ -0,0 +1,31 @@
+// Blinn-Phong terms shared by the lit fragment shaders. Everything is in tangent space.
+
+vec3 calc_ambient(vec3 diffuse_texture)
+{
+	float ambient_strength = 0.3f;
+	vec3 ambient = ambient_strength * diffuse_texture;
+
+	return ambient;
+}
+
+vec3 calc_diffuse(vec3 diffuse_texture, vec3 norm, vec3 light_dir)
+{
+	float diff = max(dot(light_dir, norm), 0.0f);
+	vec3 diffuse = diff * diffuse_texture;
+
+	return diffuse;
+}
+
+vec3 calc_specular(vec3 specular_texture, vec3 norm, vec3 half_way_dir)
+{
+	float spec = pow(max(dot(norm, half_way_dir), 0.0f), 16);
+
+	vec3 specular = spec * specular_texture;
+
+	return specular;
+}
+
+float calc_attenuation(float dist)
+{
+	return 1.0f / (0.05f + dist * 0.009f + dist * dist * 0.0032f);
+}
@@ -0,0 +1,44 @@
+// Parallax occlusion mapping : steps through 8 - 16 layers of the height map (at most 20 samples) along the view
+// direction and interpolates between the last two. Expects height_scale to be declared by the includer.
+
+vec2 parallax_mapping(sampler2D height_map, vec2 tex_coords, vec3 view_dir)
+{
+	const float min_layers = 8;
+	const float max_layers = 16;
+	float num_layers = mix(max_layers, min_layers, abs(dot(vec3(0.0, 0.0, 1.0), view_dir)));
+
+	float layer_depth = 1.0 / num_layers;
+
+	float current_layer_depth = 0.0;
+
+	vec2 p = view_dir.xy / view_dir.z * height_scale;
+	vec2 delta_tex_coords = p / num_layers;
+
+	vec2  current_tex_coords     = tex_coords;
+	float current_depth_map_value = texture(height_map, current_tex_coords).r;
+
+	int max_iters = 20;
+	while(current_layer_depth < current_depth_map_value && max_iters > 0)
+	{
+		// shift texture coordinates along direction of P
+		current_tex_coords -= delta_tex_coords;
+		// get depthmap value at current texture coordinates
+		current_depth_map_value = texture(height_map, current_tex_coords).r;
+		// get depth of next layer
+		current_layer_depth += layer_depth;
+		max_iters--;
+	}
+
+	// get texture coordinates before collision (reverse operations)
+	vec2 prev_tex_coords = current_tex_coords + delta_tex_coords;
+
+	// get depth after and before collision for linear interpolation
+	float after_depth  = current_depth_map_value - current_layer_depth;
+	float before_depth = texture(height_map, prev_tex_coords).r - current_layer_depth + layer_depth;
+
+	// interpolation of texture coordinates
+	float weight = after_depth / (after_depth - before_depth);
+	vec2 final_tex_coords = prev_tex_coords * weight + current_tex_coords * (1.0 - weight);
+
+	return final_tex_coords;
+}
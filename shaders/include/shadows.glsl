@@ -0,0 +1,42 @@
+// Cascaded shadow map lookup for the directional light, MAX_CASCADES must match ShadowRenderer
+
+#define MAX_CASCADES 4
+
+uniform sampler2DArrayShadow shadow_map;
+uniform mat4 light_space_matrices[MAX_CASCADES];
+
+// far view depth of each cascade
+uniform float cascade_splits[MAX_CASCADES];
+uniform int cascade_count;
+
+// 1 when lit, 0 when fully shadowed. Fragments past the last cascade are lit.
+float calc_shadow(vec3 world_position, float view_depth)
+{
+	int cascade = 0;
+	while (cascade < cascade_count && view_depth > cascade_splits[cascade])
+	{
+		cascade++;
+	}
+
+	if (cascade >= cascade_count)
+	{
+		return 1.0f;
+	}
+
+	vec4 light_space_position = light_space_matrices[cascade] * vec4(world_position, 1.0f);
+	vec3 shadow_coord = light_space_position.xyz / light_space_position.w * 0.5f + 0.5f;
+
+	// 3x3 taps of 2x2 hardware PCF
+	vec2 texel_size = 1.0f / vec2(textureSize(shadow_map, 0).xy);
+	float lit = 0.0f;
+
+	for (int y = -1; y <= 1; y++)
+	{
+		for (int x = -1; x <= 1; x++)
+		{
+			lit += texture(shadow_map, vec4(shadow_coord.xy + vec2(x, y) * texel_size, float(cascade), shadow_coord.z));
+		}
+	}
+
+	return lit / 9.0f;
+}
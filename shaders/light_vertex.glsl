@@ -6,11 +6,30 @@ layout (location = 2) in vec2 in_tex_coord;
 layout (location = 3) in vec3 in_tangents;
 layout (location = 4) in vec3 in_bitangents;
 
-uniform mat4 model_mat;
+flat out vec3 object_color;
+
+struct ObjectData
+{
+	mat4 model_mat;
+	vec4 color;
+};
+
+// per object data, indexed by the base instance of each indirect draw command
+layout (std430, binding = 0) readonly buffer ObjectBuffer
+{
+	ObjectData objects[];
+};
+
 uniform mat4 view_mat;
 uniform mat4 projection_mat;
 
+// must match depth_vertex.glsl, whose prepass depth is tested with GL_EQUAL
+invariant gl_Position;
+
 void main()
 {
-	gl_Position = projection_mat * view_mat * model_mat * vec4(in_pos, 1.0f);
+	ObjectData object = objects[gl_BaseInstance];
+
+	object_color = object.color.rgb;
+	gl_Position = projection_mat * view_mat * object.model_mat * vec4(in_pos, 1.0f);
 }
\ No newline at end of file
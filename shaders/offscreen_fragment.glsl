@@ -12,10 +12,12 @@ uniform float bloom_intensity;
 void main()
 {
 	
-    vec3 bloom_res = texture(bloom_texture_sampler, tex_coords).rgb;
-
-
-    bloom_res *= bloom_intensity;
+    // the bloom pass is culled when its intensity is zero, and its texture left undefined
+    vec3 bloom_res = vec3(0.0f);
+    if (bloom_intensity > 0.0f)
+    {
+        bloom_res = texture(bloom_texture_sampler, tex_coords).rgb * bloom_intensity;
+    }
 
 	vec3 fragment = texture(offscreen_texture_sampler, tex_coords).xyz + bloom_res;
 	vec3 tonned_mapping = vec3(1.0f) - exp(-fragment * exposure);
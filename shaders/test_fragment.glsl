@@ -1,7 +1,7 @@
 #version 460 core
 
-#define near 0.1f
-#define far 100.0f
+// Compiled in variants (see ShaderVariants) : HAS_NORMAL_MAP, HAS_HEIGHT_MAP and ALPHA_TEST are defined only for
+// materials that need them, so flat and opaque materials skip the parallax loop and the alpha discard.
 
 layout (location = 0) out vec4 out_frag_color;
 layout (location = 1) out vec4 out_bright_color;
@@ -12,12 +12,19 @@ in vec3 frag_position_tbn;
 in vec3 light_pos_tbn;
 in vec3 camera_pos_tbn;
 
+in vec3 frag_position_world;
+in mat3 world_to_tbn;
+
 struct Material
 {
 	sampler2D texture_diffuse1;
 	sampler2D texture_specular1;
+#ifdef HAS_NORMAL_MAP
 	sampler2D texture_normal1;
+#endif
+#ifdef HAS_HEIGHT_MAP
 	sampler2D texture_height1;
+#endif
 };
 
 uniform Material material;
@@ -27,99 +34,57 @@ uniform vec3 light_color;
 
 uniform float light_intensity;
 
-vec2 parallax_mapping(vec2 tex_coords, vec3 view_dir)
-{
-	const float min_layers = 8;
-    const float max_layers = 16;
-    float num_layers = mix(max_layers, min_layers, abs(dot(vec3(0.0, 0.0, 1.0), view_dir)));  
-    
-    float layer_depth = 1.0 / num_layers;
-    
-    float current_layer_depth = 0.0;
-    
-    vec2 p = view_dir.xy / view_dir.z * height_scale; 
-    vec2 delta_tex_coords = p / num_layers;
-  
-    
-    vec2  current_tex_coords     = tex_coords;
-    float current_depth_map_value = texture(material.texture_height1, current_tex_coords).r;
-      
-	int max_iters = 20;
-    while(current_layer_depth < current_depth_map_value && max_iters > 0)
-    {
-        // shift texture coordinates along direction of P
-        current_tex_coords -= delta_tex_coords;
-        // get depthmap value at current texture coordinates
-        current_depth_map_value = texture(material.texture_height1, current_tex_coords).r;  
-        // get depth of next layer
-        current_layer_depth += layer_depth;  
-		max_iters--;
-    }
-    
-    // get texture coordinates before collision (reverse operations)
-    vec2 prev_tex_coords = current_tex_coords + delta_tex_coords;
-
-    // get depth after and before collision for linear interpolation
-    float after_depth  = current_depth_map_value - current_layer_depth;
-    float before_depth = texture(material.texture_height1, prev_tex_coords).r - current_layer_depth + layer_depth;
- 
-    // interpolation of texture coordinates
-    float weight = after_depth / (after_depth - before_depth);
-    vec2 final_tex_coords = prev_tex_coords * weight + current_tex_coords * (1.0 - weight);
-
-    return final_tex_coords;
-}
-
-vec3 calc_ambient(vec3 diffuse_texture)
-{
-	float ambient_strength = 0.3f;
-	vec3 ambient = ambient_strength * diffuse_texture;
-
-	return ambient;
-}
-
-vec3 calc_diffuse(vec3 diffuse_texture, vec3 norm, vec3 light_dir)
-{
-	float diff = max(dot(light_dir, norm), 0.0f);
-	vec3 diffuse = diff * diffuse_texture;
+uniform mat4 view_mat;
 
-	return diffuse;
-}
+// directional light, from the light into the scene, in world space
+uniform vec3 sun_direction;
+uniform vec3 sun_color;
+uniform float sun_intensity;
 
-vec3 calc_specular(vec3 specular_texture, vec3 norm, vec3 half_way_dir)
-{
-	float spec = pow(max(dot(norm, half_way_dir), 0.0f), 16);
+#include "include/lighting.glsl"
+#include "include/clustered_lights.glsl"
+#include "include/shadows.glsl"
 
-	vec3 specular = spec * specular_texture;
-
-	return specular;
-}
+#ifdef HAS_HEIGHT_MAP
+#include "include/parallax.glsl"
+#endif
 
 void main()
 {
+#ifdef ALPHA_TEST
 	float alpha = texture(material.texture_diffuse1, tex_coord).a;
 	if (alpha < 0.1f)
 	{
 		discard;
 	}
+#endif
 
 	vec3 view_dir = normalize(camera_pos_tbn - frag_position_tbn);
-	vec3 height_texture = vec3(texture(material.texture_height1, tex_coord));
-	
-	vec2 parallaxed_tex_coord = parallax_mapping(tex_coord, view_dir);
+
+#ifdef HAS_HEIGHT_MAP
+	vec2 parallaxed_tex_coord = parallax_mapping(material.texture_height1, tex_coord, view_dir);
+#else
+	vec2 parallaxed_tex_coord = tex_coord;
+#endif
 
 	vec3 diff_texture = vec3(texture(material.texture_diffuse1, parallaxed_tex_coord));
 	vec3 specular_texture = vec3(texture(material.texture_specular1, parallaxed_tex_coord));
+
+#ifdef HAS_NORMAL_MAP
 	vec3 normal_texture = vec3(texture(material.texture_normal1, parallaxed_tex_coord));
 	normal_texture = normal_texture * 2.0f - 1.0f;
 
 	vec3 norm  = normalize(normal_texture);
+#else
+	// the interpolated vertex normal, which is the z axis of tangent space
+	vec3 norm = vec3(0.0f, 0.0f, 1.0f);
+#endif
 
 	vec3 light_dir = normalize(light_pos_tbn - frag_position_tbn);
 	vec3 half_way_dir = normalize(light_dir + view_dir);
 
 	float dist = length(light_pos_tbn - frag_position_tbn);
-	float attenuation = 1.0f / (0.05f + dist * 0.009f + dist * dist * 0.0032f);
+	float attenuation = calc_attenuation(dist);
 	vec3 result = calc_ambient(diff_texture) + (calc_specular(specular_texture, norm, half_way_dir) + calc_diffuse(diff_texture, norm, light_dir));
 	// transform to grayscale
 	if (light_intensity > 1.0f)
@@ -127,7 +92,37 @@ void main()
 		attenuation = 1.0f;
 	}
 
-	out_frag_color = vec4(result * light_color * attenuation * light_intensity, 1.0f);
+	vec3 color = result * light_color * attenuation * light_intensity;
+
+	float view_depth = -(view_mat * vec4(frag_position_world, 1.0f)).z;
+
+	vec3 sun_dir = normalize(world_to_tbn * -sun_direction);
+	vec3 sun_half_way_dir = normalize(sun_dir + view_dir);
+	vec3 sun = calc_specular(specular_texture, norm, sun_half_way_dir) + calc_diffuse(diff_texture, norm, sun_dir);
+	color += sun * sun_color * sun_intensity * calc_shadow(frag_position_world, view_depth);
+
+	// point lights of this fragment's cluster only
+	uvec2 cluster = get_cluster_lights(gl_FragCoord.xy, view_depth);
+
+	for (uint i = 0u; i < cluster.y; i++)
+	{
+		PointLight light = point_lights[light_indices[cluster.x + i]];
+
+		vec3 to_light = light.position - frag_position_world;
+		float light_dist = length(to_light);
+		if (light_dist >= light.radius)
+		{
+			continue;
+		}
+
+		vec3 point_light_dir = normalize(world_to_tbn * to_light);
+		vec3 point_half_way_dir = normalize(point_light_dir + view_dir);
+
+		vec3 lit = calc_specular(specular_texture, norm, point_half_way_dir) + calc_diffuse(diff_texture, norm, point_light_dir);
+		color += lit * light.color * light.intensity * calc_point_attenuation(light_dist, light.radius);
+	}
+
+	out_frag_color = vec4(color, 1.0f);
 	
 	float brightness = dot(out_frag_color.xyz, vec3(0.2126, 0.7152, 0.0722));
 
@@ -141,4 +136,4 @@ void main()
 		out_bright_color = vec4(0.0f, 0.0f, 0.0f, 1.0f);
 	}
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,72 @@
+#version 460 core
+
+// test_vertex.glsl for the packed vertex formats (see vertex_format.hpp). Quantized positions arrive as [0, 1] and
+// are mapped back into mesh space by the object transform.
+layout (location = 0) in vec3 in_pos;
+layout (location = 1) in vec2 in_normal_oct;
+layout (location = 2) in vec2 in_tex_coord;
+layout (location = 3) in vec4 in_tangent_oct;
+
+out vec2 tex_coord;
+out vec3 frag_position_tbn;
+out vec3 light_pos_tbn;
+out vec3 camera_pos_tbn;
+
+// for the clustered point lights, which are looked up by world position and lit in tangent space
+out vec3 frag_position_world;
+out mat3 world_to_tbn;
+
+uniform vec3 light_pos;
+uniform vec3 camera_pos;
+
+struct ObjectData
+{
+	mat4 model_mat;
+	vec4 color;
+};
+
+// per object data, indexed by the base instance of each indirect draw command
+layout (std430, binding = 0) readonly buffer ObjectBuffer
+{
+	ObjectData objects[];
+};
+
+uniform mat4 view_mat;
+uniform mat4 projection_mat;
+
+// must match depth_vertex.glsl, whose prepass depth is tested with GL_EQUAL
+invariant gl_Position;
+
+vec3 octahedral_decode(vec2 oct)
+{
+	vec3 v = vec3(oct, 1.0f - abs(oct.x) - abs(oct.y));
+	float t = max(-v.z, 0.0f);
+	v.xy += vec2(v.x >= 0.0f ? -t : t, v.y >= 0.0f ? -t : t);
+
+	return normalize(v);
+}
+
+void main()
+{	
+	mat4 model_mat = objects[gl_BaseInstance].model_mat;
+
+	vec3 normal = octahedral_decode(in_normal_oct);
+	vec3 tangent = octahedral_decode(in_tangent_oct.xy);
+	vec3 bitangent = cross(normal, tangent) * (in_tangent_oct.w < 0.0f ? -1.0f : 1.0f);
+
+	vec3 t = normalize(mat3(model_mat) * tangent);
+	vec3 b = normalize(mat3(model_mat) * bitangent);
+	vec3 n = normalize(mat3(model_mat) * normal);
+
+	mat3 tbn_mat = transpose(mat3(t, b, n));
+
+	tex_coord = in_tex_coord;
+	frag_position_world = vec3(model_mat * vec4(in_pos, 1.0f));
+	world_to_tbn = tbn_mat;
+
+	frag_position_tbn = tbn_mat * frag_position_world;
+	light_pos_tbn = tbn_mat * light_pos;
+	camera_pos_tbn = tbn_mat * camera_pos;
+
+	gl_Position = projection_mat * view_mat * model_mat * vec4(in_pos, 1.0f);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "vertex_format.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+class Model;
+
+struct AssetCacheStats
+{
+	uint64_t texture_hits;
+	uint64_t texture_misses;
+
+	uint64_t model_hits;
+	uint64_t model_misses;
+};
+
+// Process wide cache of textures and models, so an asset referenced from several meshes / models is decoded and
+// uploaded once. Textures are keyed on their canonical path and sRGB flag and are reference counted, the GL texture is
+// deleted when the last reference is released. Models are handed out as shared_ptr and only weakly referenced here.
+class AssetCache
+{
+public:
+	static AssetCache& get();
+
+	AssetCache(const AssetCache&) = delete;
+	AssetCache& operator=(const AssetCache&) = delete;
+
+	// Every acquire_texture must be paired with a release_texture
+	uint32_t acquire_texture(const std::string& path, bool gamma, const uint8_t placeholder[4]);
+	void release_texture(uint32_t texture_id);
+
+	// The same file loaded with different vertex formats gives separate models
+	std::shared_ptr<Model> acquire_model(const std::string& path, VertexFormat format = VertexFormat::Full);
+
+	// Hot reload : decodes a changed image again into the textures loaded from it (sRGB and linear), returns false
+	// if no texture uses the file
+	bool reload_texture(const std::string& path);
+
+	// Hot reload : reloads the live models in the directory of a changed model file (.gltf, its .bin buffers, ...),
+	// returns how many were reloaded
+	uint32_t reload_models(const std::string& path);
+
+	const AssetCacheStats& get_stats() const;
+	size_t get_texture_count() const;
+
+	static std::string get_canonical_path(const std::string& path);
+
+private:
+	AssetCache();
+
+private:
+	struct TextureEntry
+	{
+		uint32_t texture_id;
+		uint32_t ref_count;
+	};
+
+	std::unordered_map<std::string, TextureEntry> m_textures;
+	std::unordered_map<uint32_t, std::string> m_texture_keys;
+
+	std::unordered_map<std::string, std::weak_ptr<Model>> m_models;
+
+	AssetCacheStats m_stats;
+};
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Measurements of one benchmark frame
+struct BenchmarkFrame
+{
+	float cpu_ms;
+
+	// negative when the frame's GPU timestamps were not available
+	float gpu_ms;
+
+	uint32_t draw_calls;
+	uint64_t triangles;
+};
+
+struct BenchmarkPercentiles
+{
+	float mean;
+	float p50;
+	float p95;
+	float p99;
+	float max;
+};
+
+struct BenchmarkSummary
+{
+	uint32_t frame_count;
+
+	BenchmarkPercentiles cpu_ms;
+	BenchmarkPercentiles gpu_ms;
+
+	// per frame means
+	float draw_calls;
+	float triangles;
+
+	// peak resident set of the process, and peak memory of the render graph's pooled targets
+	double peak_memory_mb;
+	double peak_render_target_mb;
+};
+
+// Summaries of benchmark runs, their JSON form and comparison against a stored baseline
+class Benchmark
+{
+public:
+	static BenchmarkSummary summarize(const std::vector<BenchmarkFrame>& frames);
+
+	static bool save(const BenchmarkSummary& summary, const std::string& path);
+	static bool load(const std::string& path, BenchmarkSummary& summary);
+
+	// Prints every timing next to the baseline's, returns false when one is slower by more than tolerance
+	// (0.05 for 5 %)
+	static bool compare(const BenchmarkSummary& summary, const BenchmarkSummary& baseline, float tolerance);
+
+	// Peak resident memory of the process so far
+	static double get_peak_memory_mb();
+};
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "shader.hpp"
+#include "gpu_timer.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// Bloom on a mip chain : the bright pass is filtered down through mip_count progressively halved levels and back
+// up again with the dual filter kernels (bloom_downsample / bloom_upsample), ending at half resolution.
+// The old full resolution gaussian ping-pong is kept as render_gaussian to compare against.
+class BloomRenderer
+{
+public:
+	static constexpr uint32_t DEFAULT_MIP_COUNT = 6;
+	static constexpr uint32_t MAX_MIP_COUNT = 10;
+	static constexpr uint32_t GAUSSIAN_PASSES = 100;
+
+	BloomRenderer(uint32_t width, uint32_t height, uint32_t mip_count = DEFAULT_MIP_COUNT, uint32_t format = GL_RGBA16F);
+	~BloomRenderer();
+
+	BloomRenderer(const BloomRenderer&) = delete;
+	BloomRenderer& operator=(const BloomRenderer&) = delete;
+
+	void resize(uint32_t width, uint32_t height);
+
+	// Deeper chains give a wider bloom, clamped so the smallest level stays at least 1x1
+	void set_mip_count(uint32_t mip_count);
+	uint32_t get_mip_count() const;
+
+	// Sized internal format of every bloom target
+	void set_format(uint32_t format);
+	uint32_t get_format() const;
+
+	// Returns the bloom texture, valid until the next render call. Leaves the viewport at width x height.
+	uint32_t render(uint32_t bright_texture, float spread, uint32_t quad_vao);
+	uint32_t render_gaussian(uint32_t bright_texture, float spread, uint32_t quad_vao, uint32_t passes = GAUSSIAN_PASSES);
+
+	// Texture render / render_gaussian leave their result in, known before rendering so it can be declared up front
+	uint32_t get_output_texture(bool gaussian, uint32_t passes = GAUSSIAN_PASSES) const;
+	glm::ivec2 get_output_size(bool gaussian) const;
+
+	// GPU time of the last finished render / render_gaussian
+	float get_mip_chain_ms() const;
+	float get_gaussian_ms() const;
+
+private:
+	// (Re)fetches the uniform handles, after construction and after a shader reload
+	void resolve_uniforms();
+
+	void create_targets();
+	void destroy_targets();
+
+private:
+	Shader m_downsample_shader;
+	Shader m_upsample_shader;
+	Shader m_gaussian_shader;
+
+	UniformHandle<float> m_downsample_spread;
+	UniformHandle<float> m_upsample_spread;
+	UniformHandle<bool> m_gaussian_horizontal;
+	UniformHandle<float> m_gaussian_spread;
+
+	// shader generations the handles were fetched for, 0 before the first fetch
+	uint32_t m_uniform_generation;
+
+	uint32_t m_width;
+	uint32_t m_height;
+	uint32_t m_mip_count;
+	uint32_t m_format;
+
+	// one texture with a level per mip, sampled through single level views so that reading level i + 1 while
+	// drawing into level i is not a feedback loop
+	uint32_t m_mip_texture;
+	std::vector<uint32_t> m_mip_views;
+	std::vector<uint32_t> m_mip_fbos;
+	std::vector<glm::ivec2> m_mip_sizes;
+
+	uint32_t m_gaussian_fbos[2];
+	uint32_t m_gaussian_textures[2];
+
+	GpuTimer m_mip_chain_timer;
+	GpuTimer m_gaussian_timer;
+};
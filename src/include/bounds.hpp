@@ -0,0 +1,36 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <limits>
+
+// Axis aligned bounding box
+struct Bounds
+{
+	glm::vec3 min;
+	glm::vec3 max;
+};
+
+struct BoundingSphere
+{
+	glm::vec3 center;
+	float radius;
+};
+
+// Box around the corners of bounds under transform
+inline Bounds transform_bounds(const Bounds& bounds, const glm::mat4& transform)
+{
+	Bounds result = { glm::vec3(std::numeric_limits<float>::max()), glm::vec3(std::numeric_limits<float>::lowest()) };
+
+	for (uint32_t corner = 0; corner < 8; corner++)
+	{
+		const glm::vec3 position((corner & 1) ? bounds.max.x : bounds.min.x, (corner & 2) ? bounds.max.y : bounds.min.y, (corner & 4) ? bounds.max.z : bounds.min.z);
+		const glm::vec3 transformed = glm::vec3(transform * glm::vec4(position, 1.0f));
+
+		result.min = glm::min(result.min, transformed);
+		result.max = glm::max(result.max, transformed);
+	}
+
+	return result;
+}
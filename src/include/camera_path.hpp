@@ -0,0 +1,45 @@
+#pragma once
+
+#include "camera.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct CameraKeyframe
+{
+	// seconds from the start of the path
+	float time;
+
+	glm::vec3 position;
+	float yaw;
+	float pitch;
+};
+
+// Camera position / orientation over time, linearly interpolated between keyframes. Yaw is not wrapped, a path
+// turning past 180 degrees keeps counting. Stored as JSON :
+// { "keyframes" : [ { "time" : 0.0, "position" : [x, y, z], "yaw" : -90.0, "pitch" : 0.0 }, ... ] }
+class CameraPath
+{
+public:
+	bool load(const std::string& path);
+	bool save(const std::string& path) const;
+
+	// Keyframes have to be added in time order
+	void add_keyframe(const CameraKeyframe& keyframe);
+	void clear();
+
+	// Places camera where the path is at time, clamped to the path's range
+	void apply(float time, Camera& camera) const;
+
+	float get_duration() const;
+	bool is_empty() const;
+
+	// One turn around center at radius and height above it over duration seconds, looking at center
+	static CameraPath make_orbit(const glm::vec3& center, float radius, float height, float duration, uint32_t keyframe_count);
+
+private:
+	std::vector<CameraKeyframe> m_keyframes;
+};
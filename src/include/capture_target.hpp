@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// RGBA8 framebuffer the final image renders into when there is no window, read back to PNG
+class CaptureTarget
+{
+public:
+	CaptureTarget(uint32_t width, uint32_t height);
+	~CaptureTarget();
+
+	CaptureTarget(const CaptureTarget&) = delete;
+	CaptureTarget& operator=(const CaptureTarget&) = delete;
+
+	uint32_t get_framebuffer() const;
+
+	// Reads the image back (waits for the GPU to finish the frame) and writes it top row first
+	bool save_png(const std::string& path);
+
+private:
+	uint32_t m_width;
+	uint32_t m_height;
+
+	uint32_t m_framebuffer;
+	uint32_t m_texture;
+
+	std::vector<uint8_t> m_pixels;
+};
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "shader.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// Point light as stored in the light buffer (std430), the light has no effect past radius
+struct PointLight
+{
+	glm::vec3 position;
+	float radius;
+	glm::vec3 color;
+	float intensity;
+};
+
+struct ClusteredLightingStats
+{
+	uint32_t light_count;
+
+	// lights touching at least one cluster, and the entries of all the cluster light lists
+	uint32_t visible_light_count;
+	uint32_t light_index_count;
+
+	uint32_t max_lights_per_cluster;
+};
+
+// Clustered forward light culling : the view frustum is split into CLUSTER_X x CLUSTER_Y screen tiles and
+// CLUSTER_Z exponential depth slices, and every point light is added to the list of each cluster its bounds
+// overlap. The lights, the per cluster (offset, count) ranges and the light index lists go to SSBOs, so a fragment
+// only loops over the lights of its own cluster (shaders/include/clustered_lights.glsl, whose grid size must match).
+// Lights are brought to view space 4 at a time with SSE, the cluster lists are built on the CPU.
+class ClusteredLighting
+{
+public:
+	static constexpr uint32_t CLUSTER_X = 16;
+	static constexpr uint32_t CLUSTER_Y = 9;
+	static constexpr uint32_t CLUSTER_Z = 24;
+	static constexpr uint32_t CLUSTER_COUNT = CLUSTER_X * CLUSTER_Y * CLUSTER_Z;
+
+	// after RenderQueue::OBJECT_BUFFER_BINDING
+	static constexpr uint32_t LIGHT_BUFFER_BINDING = 1;
+	static constexpr uint32_t CLUSTER_BUFFER_BINDING = 2;
+	static constexpr uint32_t LIGHT_INDEX_BUFFER_BINDING = 3;
+
+	ClusteredLighting();
+	~ClusteredLighting();
+
+	ClusteredLighting(const ClusteredLighting&) = delete;
+	ClusteredLighting& operator=(const ClusteredLighting&) = delete;
+
+	// projection_mat is a symmetric perspective projection with the given near / far planes, rendering to a
+	// width x height target
+	void build(const std::vector<PointLight>& lights, const glm::mat4& view_mat, const glm::mat4& projection_mat, float near_plane, float far_plane,
+		uint32_t width, uint32_t height);
+
+	// Binds the three buffers, before drawing with a shader that reads them
+	void bind() const;
+
+	// Grid parameters of the last build
+	void set_uniforms(Shader& shader) const;
+
+	const ClusteredLightingStats& get_stats() const;
+
+private:
+	// Cluster range of a light, inclusive
+	struct LightClusters
+	{
+		uint32_t light;
+		uint16_t min_x, max_x;
+		uint16_t min_y, max_y;
+		uint16_t min_z, max_z;
+	};
+
+	void transform_lights(const std::vector<PointLight>& lights, const glm::mat4& view_mat);
+	uint32_t get_slice(float depth) const;
+
+private:
+	// view space light centers, SoA for the SSE transform
+	std::vector<float> m_view_x;
+	std::vector<float> m_view_y;
+	std::vector<float> m_view_z;
+
+	std::vector<LightClusters> m_light_clusters;
+
+	// (offset, count) into m_light_indices per cluster
+	std::vector<glm::uvec2> m_clusters;
+	std::vector<uint32_t> m_light_indices;
+	std::vector<uint32_t> m_cursors;
+
+	uint32_t m_light_buffer;
+	uint32_t m_cluster_buffer;
+	uint32_t m_light_index_buffer;
+
+	glm::vec2 m_tile_size;
+	float m_z_scale;
+	float m_z_bias;
+
+	ClusteredLightingStats m_stats;
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "model.hpp"
+#include "bounds.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <memory>
+
+// Placement of an entity in world space. Set dirty after changing position, rotation or scale.
+struct TransformComponent
+{
+	glm::vec3 position;
+
+	// euler angles in radians, applied around y, then x, then z
+	glm::vec3 rotation;
+	glm::vec3 scale;
+
+	// rebuilt from the above by SceneSystems::update_transforms, which bumps version every time
+	glm::mat4 world_mat;
+	uint32_t version;
+	bool dirty;
+
+	static TransformComponent make(const glm::vec3& position, const glm::vec3& rotation = glm::vec3(0.0f), const glm::vec3& scale = glm::vec3(1.0f))
+	{
+		return { position, rotation, scale, glm::mat4(1.0f), 0, true };
+	}
+};
+
+// Draws a model at the entity's transform, with the variant of shader_variants matching each material when set
+// and with shader otherwise
+struct MeshRendererComponent
+{
+	std::shared_ptr<Model> model;
+	Shader* shader;
+	ShaderVariants* shader_variants;
+	glm::vec3 color;
+};
+
+// Point light at the entity's position
+struct LightComponent
+{
+	glm::vec3 color;
+	float radius;
+	float intensity;
+};
+
+// Moves the entity around a circle in the xz plane, at one radian per second
+struct OrbitComponent
+{
+	glm::vec3 anchor;
+	float radius;
+	float phase;
+};
+
+// World space bounds of a MeshRendererComponent's model, as of transform_version of the entity's transform and
+// model_reload_count of the model
+struct BoundsComponent
+{
+	Bounds world;
+	uint32_t transform_version;
+	uint32_t model_reload_count;
+};
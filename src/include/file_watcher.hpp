@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Watches directory trees for files that were written, created or moved in, from a background thread. On Linux the
+// thread blocks on inotify; elsewhere, or when inotify is unavailable, it compares write times every
+// POLL_INTERVAL_MS.
+class FileWatcher
+{
+public:
+	static constexpr uint32_t POLL_INTERVAL_MS = 500;
+
+	// Changes are handed out once no new change came in for this long, so that an editor saving through several
+	// writes (or a tool exporting several files) is picked up as one batch
+	static constexpr uint32_t SETTLE_MS = 100;
+
+	explicit FileWatcher(const std::vector<std::string>& directories);
+	~FileWatcher();
+
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator=(const FileWatcher&) = delete;
+
+	// Canonical paths of the files changed since the last call, empty while changes are still settling
+	std::vector<std::string> take_changes();
+
+	bool is_using_inotify() const;
+
+private:
+	void add_change(const std::filesystem::path& path);
+
+	void poll_loop();
+	void scan(bool record_changes);
+
+#ifdef __linux__
+	void inotify_loop();
+	void add_watches(const std::filesystem::path& directory);
+#endif
+
+private:
+	std::vector<std::string> m_directories;
+
+	std::thread m_thread;
+	std::atomic<bool> m_stop;
+
+	std::mutex m_mutex;
+	std::set<std::string> m_changes;
+	std::chrono::steady_clock::time_point m_last_change;
+
+	// polling : last seen write time of every file
+	std::unordered_map<std::string, std::filesystem::file_time_type> m_write_times;
+
+#ifdef __linux__
+	int m_inotify;
+
+	// watch descriptor -> watched directory
+	std::unordered_map<int, std::filesystem::path> m_watch_directories;
+#endif
+};
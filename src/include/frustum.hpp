@@ -0,0 +1,62 @@
+#pragma once
+
+#include "bounds.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// Six normalized planes (xyz : normal pointing inside, w : distance), in the space of the matrix they were taken from
+struct Frustum
+{
+	glm::vec4 planes[6];
+
+	// Gribb / Hartmann plane extraction, pass projection * view for world space planes
+	static Frustum from_matrix(const glm::mat4& view_projection);
+};
+
+// Culls world space bounds against a frustum, 4 at a time with SSE over SoA arrays. Bounds are added with the
+// transform of their object and tested as both a box and a sphere, either one being outside culls the bound.
+class FrustumCuller
+{
+public:
+	FrustumCuller();
+
+	void clear();
+
+	// Returns the index to query is_visible with after cull
+	uint32_t add(const Bounds& bounds, const BoundingSphere& sphere, const glm::mat4& transform);
+
+	void cull(const Frustum& frustum);
+
+	bool is_visible(uint32_t index) const;
+	uint32_t get_count() const;
+
+	// World space sphere of a bound (xyz : center, w : radius)
+	glm::vec4 get_world_sphere(uint32_t index) const;
+
+	// World space box of a bound
+	Bounds get_world_bounds(uint32_t index) const;
+
+private:
+	void cull_scalar(const Frustum& frustum, uint32_t begin, uint32_t end);
+
+private:
+	uint32_t m_count;
+
+	// world space box as center / half extent, and sphere center / radius
+	std::vector<float> m_center_x;
+	std::vector<float> m_center_y;
+	std::vector<float> m_center_z;
+	std::vector<float> m_extent_x;
+	std::vector<float> m_extent_y;
+	std::vector<float> m_extent_z;
+
+	std::vector<float> m_sphere_x;
+	std::vector<float> m_sphere_y;
+	std::vector<float> m_sphere_z;
+	std::vector<float> m_sphere_radius;
+
+	std::vector<uint8_t> m_visible;
+};
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "mesh.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+// Layout of a command in GL_DRAW_INDIRECT_BUFFER for glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand
+{
+	uint32_t count;
+	uint32_t instance_count;
+	uint32_t first_index;
+	int32_t base_vertex;
+	uint32_t base_instance;
+};
+
+struct GeometryArenaStats
+{
+	uint32_t allocation_count;
+
+	uint32_t vertex_capacity;
+	uint32_t vertices_used;
+
+	uint32_t index_capacity;
+	uint32_t indices_used;
+};
+
+// One vertex buffer and one index buffer shared by every mesh of a vertex format, with a single VAO. Meshes get a
+// handle to a sub-allocation, and look their offsets up through it since compact() moves allocations around.
+class GeometryArena
+{
+public:
+	static constexpr uint32_t INVALID_HANDLE = 0xffffffff;
+
+	// One arena per vertex format, each with the attribute setup of its layout policy
+	static GeometryArena& get(VertexFormat format = VertexFormat::Full);
+
+	GeometryArena(const GeometryArena&) = delete;
+	GeometryArena& operator=(const GeometryArena&) = delete;
+
+	// vertices are in the arena's vertex format
+	uint32_t allocate(const void* vertices, uint32_t vertex_count, const uint32_t* indices, uint32_t index_count);
+	void free(uint32_t handle);
+
+	// Moves every live allocation to the front of the buffers, removing the holes left by freed meshes
+	void compact();
+
+	// Compacts when the holes between allocations exceed threshold of the used space
+	void compact_if_fragmented(float threshold = 0.25f);
+
+	uint32_t get_base_vertex(uint32_t handle) const;
+	uint32_t get_first_index(uint32_t handle) const;
+	uint32_t get_index_count(uint32_t handle) const;
+
+	uint32_t get_vao() const;
+
+	GeometryArenaStats get_stats() const;
+
+private:
+	GeometryArena(uint32_t vertex_size, void (*setup_attributes)(uint32_t vao));
+
+	void create_buffers(uint32_t vertex_capacity, uint32_t index_capacity);
+	void grow(uint32_t min_vertex_capacity, uint32_t min_index_capacity);
+
+	static bool allocate_range(std::map<uint32_t, uint32_t>& free_ranges, uint32_t count, uint32_t& offset);
+	static void free_range(std::map<uint32_t, uint32_t>& free_ranges, uint32_t offset, uint32_t count);
+
+private:
+	struct Allocation
+	{
+		uint32_t vertex_offset;
+		uint32_t vertex_count;
+		uint32_t index_offset;
+		uint32_t index_count;
+		bool live;
+	};
+
+	std::vector<Allocation> m_allocations;
+	std::vector<uint32_t> m_free_handles;
+
+	// offset -> count of free ranges, in vertices / indices
+	std::map<uint32_t, uint32_t> m_free_vertices;
+	std::map<uint32_t, uint32_t> m_free_indices;
+
+	size_t m_vertex_size;
+	uint32_t m_vertex_capacity;
+	uint32_t m_index_capacity;
+
+	uint32_t m_vao;
+	uint32_t m_vbo;
+	uint32_t m_ebo;
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+
+// Query of any single value target (GL_TIME_ELAPSED, GL_FRAGMENT_SHADER_INVOCATIONS, ...) over a ring of
+// QUERY_COUNT queries, so results lag up to QUERY_COUNT begin / end pairs behind. get_value never touches the GPU.
+// begin collects the results that are available without waiting, but blocks on the query it is about to reuse
+// when the GPU is still more than QUERY_COUNT pairs behind. begin / end may not be nested with another
+// GpuCounter of the same target.
+class GpuCounter
+{
+public:
+	static constexpr uint32_t QUERY_COUNT = 4;
+
+	explicit GpuCounter(uint32_t target);
+	~GpuCounter();
+
+	GpuCounter(const GpuCounter&) = delete;
+	GpuCounter& operator=(const GpuCounter&) = delete;
+
+	void begin();
+	void end();
+
+	// Latest available result
+	uint64_t get_value() const;
+
+private:
+	uint32_t m_target;
+
+	uint32_t m_queries[QUERY_COUNT];
+	bool m_pending[QUERY_COUNT];
+	uint32_t m_current;
+
+	uint64_t m_value;
+};
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "gpu_counter.hpp"
+
+// GpuCounter of GL_TIME_ELAPSED, read in milliseconds. Waits and lags like GpuCounter, begin / end may not be
+// nested with another GpuTimer.
+class GpuTimer
+{
+public:
+	static constexpr uint32_t QUERY_COUNT = GpuCounter::QUERY_COUNT;
+
+	GpuTimer();
+
+	void begin();
+	void end();
+
+	// Latest available result, in milliseconds
+	float get_ms() const;
+
+private:
+	GpuCounter m_counter;
+};
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+
+// OpenGL context without a window or display, for build / CI machines : EGL on Mesa's surfaceless platform
+// (llvmpipe works without a GPU). There is no default framebuffer, everything renders into framebuffer objects.
+// Only available when built with EGL (GLENGINE_EGL).
+class HeadlessContext
+{
+public:
+	HeadlessContext();
+	~HeadlessContext();
+
+	HeadlessContext(const HeadlessContext&) = delete;
+	HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+	// Whether a context was created, made current and GL loaded through it
+	bool is_valid() const;
+
+private:
+	void* m_display;
+	void* m_context;
+	bool m_valid;
+};
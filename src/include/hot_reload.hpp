@@ -0,0 +1,59 @@
+#pragma once
+
+#include "file_watcher.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class Shader;
+
+struct HotReloadStats
+{
+	uint32_t shader_reloads;
+	uint32_t shader_failures;
+
+	uint32_t texture_reloads;
+	uint32_t model_reloads;
+};
+
+// Watches the shader and asset directories and rebuilds whatever a changed file feeds : the shaders including it,
+// the textures decoded from it, or the models of its directory. Changes are only applied from apply(), called at the
+// start of a frame on the GL thread, so a frame never mixes old and new versions. Anything that fails to rebuild
+// keeps its previous version.
+class HotReload
+{
+public:
+	static HotReload& get();
+
+	HotReload(const HotReload&) = delete;
+	HotReload& operator=(const HotReload&) = delete;
+
+	void start(const std::vector<std::string>& directories);
+	void stop();
+
+	bool is_running() const;
+
+	// Every Shader registers itself, so it can be found by its source files
+	void register_shader(Shader* shader);
+	void unregister_shader(Shader* shader);
+
+	void apply();
+
+	const HotReloadStats& get_stats() const;
+
+private:
+	HotReload();
+
+	static bool is_image(const std::string& path);
+
+	// files the engine writes itself next to the assets (mesh caches, their temporaries)
+	static bool is_generated(const std::string& path);
+
+private:
+	std::unique_ptr<FileWatcher> m_watcher;
+	std::vector<Shader*> m_shaders;
+
+	HotReloadStats m_stats;
+};
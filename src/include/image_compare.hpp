@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Difference between two RGBA8 images over their RGB channels, in 8 bit steps
+struct ImageDifference
+{
+	uint32_t max_error;
+	float mean_error;
+
+	// peak signal to noise ratio in dB, infinite for identical images
+	float psnr;
+
+	// share of pixels with a channel more than one step off
+	float differing_ratio;
+};
+
+ImageDifference compare_rgba8(const uint8_t* image, const uint8_t* reference, size_t pixel_count);
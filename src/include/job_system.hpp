@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Jobs still running of a group submitted together, waited on with JobSystem::wait
+struct JobCounter
+{
+	std::atomic<uint32_t> pending{ 0 };
+};
+
+// Small pool of worker threads started once, for the CPU work of a frame that can run next to the GL thread
+// (the scene systems). Waiting runs queued jobs on the calling thread rather than idling.
+class JobSystem
+{
+public:
+	static JobSystem& get();
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	void submit(std::function<void()> job, JobCounter& counter);
+
+	// Returns once every job of counter has finished
+	void wait(JobCounter& counter);
+
+	// Threads that run jobs, the thread waiting on them included
+	uint32_t get_thread_count() const;
+
+private:
+	JobSystem();
+	~JobSystem();
+
+	struct Job
+	{
+		std::function<void()> fn;
+		JobCounter* counter;
+	};
+
+	void worker_loop();
+
+	// pops and runs one job, false if the queue was empty
+	bool run_one();
+
+private:
+	std::vector<std::thread> m_workers;
+
+	std::mutex m_mutex;
+	std::condition_variable m_job_cv;
+	std::condition_variable m_done_cv;
+
+	std::deque<Job> m_jobs;
+	bool m_stop;
+};
@@ -1,21 +1,15 @@
 #pragma once
 
 #include "shader.hpp"
+#include "shader_variants.hpp"
+#include "vertex_format.hpp"
 
 #include <glm/glm.hpp>
 
+#include <cstddef>
 #include <string>
 #include <vector>
 
-struct Vertex
-{
-	glm::vec3 position;
-	glm::vec3 normal;
-	glm::vec2 tex_coords;
-	glm::vec3 tangent;
-	glm::vec3 bitangent;
-};
-
 struct Texture
 {
 	uint32_t texture_id;
@@ -23,22 +17,119 @@ struct Texture
 	std::string path;
 };
 
+// Range of a mesh's index buffer holding one level of detail, error is the object space distance the simplified
+// surface may deviate from the full detail one
+struct MeshLod
+{
+	uint32_t index_offset;
+	uint32_t index_count;
+	float error;
+};
+
 class Mesh
 {
 public:
-	Mesh(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, std::vector<Texture>& textures);
+	static constexpr uint32_t MAX_LODS = 4;
+
+	// LOD error of the occluder relative to the mesh radius, a simplified occluder must not cover much more than
+	// the real mesh
+	static constexpr float OCCLUDER_LOD_ERROR = 0.01f;
+
+	// format picks the layout the vertices are packed into on the GPU. indices holds every LOD back to back as
+	// described by lods, no lods means indices is a single full detail LOD. Only the geometry arena keeps the
+	// vertices and indices, apart from the occluder below.
+	Mesh(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, std::vector<Texture>& textures, const Bounds& bounds, const BoundingSphere& sphere,
+		const std::vector<MeshLod>& lods, VertexFormat format = VertexFormat::Full);
+
+	// vertex_data is already in the layout of format (a cooked mesh cache), it is uploaded as is
+	Mesh(const uint8_t* vertex_data, size_t vertex_count, const uint32_t* indices, size_t index_count, std::vector<Texture>& textures, const Bounds& bounds,
+		const BoundingSphere& sphere, const std::vector<MeshLod>& lods, VertexFormat format = VertexFormat::Full);
+
+	// Frees the mesh's range of the geometry arena, the mesh can not be drawn afterwards
+	void release();
+
+	// Points the material sampler uniforms of shader at the fixed texture units of this mesh
+	void bind_samplers(Shader& shader);
+
+	// Texture i of m_textures is always bound to unit get_texture_units()[i]
+	const std::vector<uint32_t>& get_texture_units() const;
+
+	// Meshes using the same set of textures share a material id
+	uint32_t get_material_id() const;
+
+	// ShaderKeywords of the variant matching the mesh's textures and alpha test
+	uint32_t get_shader_keywords() const;
+
+	// For cutout materials (alpha masked foliage, ...), which discard texels of low alpha
+	void set_alpha_test(bool alpha_test);
+
+	// Geometry lives in the GeometryArena of the mesh's vertex format, drawn with the arena's VAO
+	uint32_t get_vao() const;
+	uint32_t get_index_count(uint32_t lod = 0) const;
+	uint32_t get_first_index(uint32_t lod = 0) const;
+	uint32_t get_base_vertex() const;
 
-	void draw(Shader& shader);
+	// LOD 0 is full detail, higher LODs are coarser
+	uint32_t get_lod_count() const;
+	const MeshLod& get_lod(uint32_t lod) const;
 
-	void setup_mesh();
+	// Coarsest LOD whose error stays under max_error, given in the space of the draw bounds
+	uint32_t select_lod(float max_error) const;
+
+	VertexFormat get_format() const;
+
+	// Triangles of the LOD the software occlusion culler rasterizes, positions in the space of the draw bounds
+	const std::vector<glm::vec3>& get_occluder_positions() const;
+	const std::vector<uint32_t>& get_occluder_indices() const;
+
+	// Bounds in mesh space
+	const Bounds& get_bounds() const;
+	const BoundingSphere& get_sphere() const;
+
+	// Bounds in the space of the positions stored on the GPU, which the object transform is applied to
+	const Bounds& get_draw_bounds() const;
+	const BoundingSphere& get_draw_sphere() const;
+
+	// Maps the vertex positions stored on the GPU into mesh space, to be applied before the object transform
+	// (identity unless the positions are quantized)
+	glm::mat4 get_dequantize_mat() const;
+
+	void setup_mesh(const uint8_t* vertex_data, uint32_t vertex_count, const uint32_t* indices, uint32_t index_count);
+	void setup_material();
 
 public:
-	std::vector<Vertex> m_vertices;
-	std::vector<uint32_t> m_indices;
 	std::vector<Texture> m_textures;
 
 private:
-	uint32_t m_vao;
-	uint32_t m_vbo;
-	uint32_t m_ebo;
+	// keeps the vertices of the occluder LOD only, renumbered in the order its indices first use them
+	void setup_occluder(const uint8_t* vertex_data, const uint32_t* indices);
+
+	// Sampler uniform of each texture ("material.texture_diffuse1", ...), built once instead of every draw
+	std::vector<std::string> m_sampler_names;
+
+	// Handles of m_sampler_names in the program that last drew this mesh
+	std::vector<UniformHandle<int>> m_sampler_handles;
+	uint32_t m_sampler_program;
+
+	std::vector<uint32_t> m_texture_units;
+	uint32_t m_material_id;
+
+	uint32_t m_shader_keywords;
+	bool m_alpha_test;
+
+	VertexFormat m_format;
+	std::vector<MeshLod> m_lods;
+
+	Bounds m_bounds;
+	BoundingSphere m_sphere;
+	Bounds m_draw_bounds;
+	BoundingSphere m_draw_sphere;
+
+	// mesh space units per draw space unit
+	float m_dequantize_scale;
+
+	uint32_t m_allocation;
+
+	std::vector<glm::vec3> m_occluder_positions;
+	std::vector<uint32_t> m_occluder_indices;
 };
\ No newline at end of file
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "mesh.hpp"
+#include "scene_graph.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Texture used by a mesh, before it is resolved into a GL texture
+struct TextureRef
+{
+	std::string type;
+	std::string path;
+};
+
+// CPU side result of importing a single aiMesh
+struct MeshData
+{
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	std::vector<TextureRef> textures;
+
+	Bounds bounds;
+	BoundingSphere sphere;
+
+	// LODs stored back to back in indices, empty if only the full detail one exists
+	std::vector<MeshLod> lods;
+
+	// the material is not opaque (glTF alpha mode MASK / BLEND, or an opacity map)
+	bool alpha_test;
+};
+
+// Node of the imported aiNode tree, in depth first order. Its meshes are the range [first_mesh_ref,
+// first_mesh_ref + mesh_ref_count) of the model's mesh reference table, each entry indexing the meshes, so a mesh
+// instanced by several nodes is stored once.
+struct NodeData
+{
+	// SceneGraph::NO_PARENT for the root
+	uint32_t parent;
+	uint32_t first_mesh_ref;
+	uint32_t mesh_ref_count;
+
+	// relative to the parent
+	glm::mat4 transform;
+};
+
+// Mesh stored inside a mapped cache file. Vertex and index pointers point straight into the mapping, the vertices
+// already in the GPU layout of the cache's VertexFormat.
+struct CachedMesh
+{
+	const uint8_t* vertices;
+	uint32_t vertex_count;
+
+	const uint32_t* indices;
+	uint32_t index_count;
+
+	std::vector<TextureRef> textures;
+
+	Bounds bounds;
+	BoundingSphere sphere;
+
+	std::vector<MeshLod> lods;
+
+	bool alpha_test;
+};
+
+// Versioned binary cache of imported meshes, stored next to the source model, one per VertexFormat so loading is a
+// straight copy of the packed vertices. The cache is keyed on the hash of the source file (and of the buffers /
+// material libraries it references) and the assimp import flags, so a changed source or import pipeline
+// invalidates it.
+class MeshCache
+{
+public:
+	// Bump when the file layout, the vertex layouts or the import time processing change
+	static constexpr uint32_t VERSION = 8;
+
+	MeshCache(const std::string& cache_path, uint64_t source_hash, uint32_t import_flags, VertexFormat format);
+	~MeshCache();
+
+	MeshCache(const MeshCache&) = delete;
+	MeshCache& operator=(const MeshCache&) = delete;
+
+	bool is_valid() const;
+	const std::vector<CachedMesh>& get_meshes() const;
+	const std::vector<NodeData>& get_nodes() const;
+	const std::vector<uint32_t>& get_mesh_refs() const;
+
+	// Packs the vertices of meshes into format
+	static bool write(const std::string& cache_path, uint64_t source_hash, uint32_t import_flags, VertexFormat format, const std::vector<MeshData>& meshes,
+		const std::vector<NodeData>& nodes, const std::vector<uint32_t>& mesh_refs);
+
+	// <model>.<format name>.meshcache
+	static std::string get_cache_path(const std::string& source_path, VertexFormat format);
+	static uint64_t hash_file(const std::string& path);
+
+	// hash_file of the model folded with the size and write time of the files it references
+	static uint64_t hash_source(const std::string& path);
+
+private:
+	bool map_file(const std::string& cache_path);
+	bool parse(uint64_t source_hash, uint32_t import_flags, VertexFormat format);
+	void unmap_file();
+
+private:
+	const uint8_t* m_data;
+	size_t m_size;
+
+	std::vector<CachedMesh> m_meshes;
+	std::vector<NodeData> m_nodes;
+	std::vector<uint32_t> m_mesh_refs;
+
+#ifdef _WIN32
+	void* m_file;
+	void* m_mapping;
+#else
+	int m_file;
+#endif
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "mesh_cache.hpp"
+
+#include <cstdint>
+
+// Vertex cache / overdraw / fetch efficiency of an index buffer, as reported by meshoptimizer
+struct MeshEfficiency
+{
+	// average cache miss ratio, transformed vertices per triangle (0.5 is ideal)
+	float acmr;
+	// average transformed vertex ratio, transformed vertices per unique vertex (1.0 is ideal)
+	float atvr;
+	// shaded pixels per covered pixel
+	float overdraw;
+	// fetched vertex bytes per vertex buffer byte
+	float overfetch;
+};
+
+struct MeshOptimizeStats
+{
+	uint32_t vertex_count_before;
+	uint32_t vertex_count_after;
+
+	MeshEfficiency before;
+	MeshEfficiency after;
+};
+
+// Import time optimization of a mesh's vertex / index buffers, the rendered result does not change.
+class MeshOptimizer
+{
+public:
+	// Post transform cache size the stats are measured against
+	static constexpr uint32_t VERTEX_CACHE_SIZE = 16;
+
+	// How much the overdraw pass may worsen ACMR (1.05 = 5%) in exchange for less overdraw
+	static constexpr float OVERDRAW_THRESHOLD = 1.05f;
+
+	// Deduplicates vertices, then reorders indices for the vertex cache and for overdraw, and finally reorders
+	// vertices in the order they are first used
+	static MeshOptimizeStats optimize(MeshData& mesh);
+
+	// Simplified LODs stop once a level removes less than this fraction of the previous level's triangles
+	static constexpr float MIN_LOD_REDUCTION = 0.2f;
+
+	// Meshes below this many triangles are not worth simplifying
+	static constexpr uint32_t MIN_LOD_TRIANGLES = 64;
+
+	// Appends up to Mesh::MAX_LODS - 1 simplified index buffers (each about half the triangles of the previous one)
+	// to mesh.indices and fills mesh.lods. Run after optimize, the LODs reuse its vertex buffer.
+	static void generate_lods(MeshData& mesh);
+
+	static MeshEfficiency analyze(const MeshData& mesh);
+};
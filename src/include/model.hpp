@@ -2,26 +2,81 @@
 
 #include "shader.hpp"
 #include "mesh.hpp"
+#include "mesh_cache.hpp"
+#include "scene_graph.hpp"
 
 #include <assimp/scene.h>
 
+#include <functional>
+
+class RenderQueue;
+
 class Model
 {
 public:
-    Model(const char *path);
-    void draw(Shader& shader);
+    // format is the GPU vertex layout every mesh of the model is uploaded with
+    Model(const char *path, VertexFormat format = VertexFormat::Full);
+    ~Model();
+
+    Model(const Model&) = delete;
+    Model& operator=(const Model&) = delete;
+
+    // Queues every mesh of the model, drawn on the next RenderQueue::flush
+    void submit(RenderQueue& queue, Shader& shader, const glm::mat4& transform, const glm::vec3& color = glm::vec3(1.0f));
+
+    // Same, each mesh drawn with the variant of shaders matching its material
+    void submit(RenderQueue& queue, ShaderVariants& shaders, const glm::mat4& transform, const glm::vec3& color = glm::vec3(1.0f));
 
+    // Loads from the mesh cache next to path, falling back to (and refreshing the cache from) an assimp import
     void load_model(const std::string& path);
-    
-    void process_node(aiNode *node, const aiScene* scene);
 
-    // Translate aiMesh into a Mesh object
-    Mesh process_mesh(aiMesh *mesh, const aiScene *scene);
-    std::vector<Texture> load_material_texture(aiMaterial *material, aiTextureType type, const std::string& type_name);
+    // Loads the model again after its source changed, the current meshes stay if that fails
+    bool reload();
+
+    // Successful reloads so far, so anything derived from the meshes (bounds) knows to refresh
+    uint32_t get_reload_count() const;
+
+    // Directory of the model file, which its buffers and textures are relative to
+    const std::string& get_directory() const;
+
+    // Union of the mesh bounds under their node transforms, in model space
+    Bounds get_bounds() const;
+
+    // The imported node hierarchy, one node per NodeData with world matrices relative to the model
+    const SceneGraph& get_node_graph() const;
+
+    // Import the model and write its mesh cache without creating any GL objects (used by --cook)
+    static bool cook(const std::string& path);
+
+    // Every aiMesh is imported once, meshes[i] being scene->mMeshes[i], and the nodes reference them through mesh_refs
+    static bool import_model(const std::string& path, std::vector<MeshData>& meshes, std::vector<NodeData>& nodes, std::vector<uint32_t>& mesh_refs);
+
+    // Appends node and its subtree depth first, keeping each node's transform and mesh references
+    static void process_node(aiNode *node, uint32_t parent, std::vector<NodeData>& nodes, std::vector<uint32_t>& mesh_refs);
+
+    // Translate aiMesh into a MeshData
+    static MeshData process_mesh(aiMesh *mesh, const aiScene *scene);
+    static std::vector<TextureRef> get_material_textures(aiMaterial *material, aiTextureType type, const std::string& type_name);
+
+    std::vector<Texture> load_material_textures(const std::vector<TextureRef>& texture_refs);
+
+private:
+    void release_meshes(std::vector<Mesh>& meshes);
+    void build_node_graph();
+    void submit_meshes(RenderQueue& queue, const glm::mat4& transform, const glm::vec3& color, const std::function<Shader&(const Mesh&)>& select_shader);
 
 private:
     std::vector<Mesh> m_meshes;
+
+    // the node tree, its transforms resolved once at load in m_node_graph, and the meshes of each node as ranges of
+    // m_mesh_refs (indices into m_meshes)
+    std::vector<NodeData> m_nodes;
+    std::vector<uint32_t> m_mesh_refs;
+    SceneGraph m_node_graph;
+
+    std::string m_path;
     std::string m_directory;
 
-    std::vector<Texture> m_textures_loaded;
-};
\ No newline at end of file
+    VertexFormat m_format;
+    uint32_t m_reload_count;
+};
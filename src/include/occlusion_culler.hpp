@@ -0,0 +1,126 @@
+#pragma once
+
+#include "shader.hpp"
+#include "mesh.hpp"
+#include "bounds.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+enum class OcclusionMode
+{
+	Off,
+	// two phase hierarchical Z culling in compute shaders
+	Gpu,
+	// software rasterized occluders, tested on the CPU
+	Cpu,
+};
+
+struct OcclusionStats
+{
+	// items tested, and items found hidden (for the GPU a few frames behind, like the GPU timers)
+	uint32_t tested_items;
+	uint32_t occluded_items;
+
+	// CPU only
+	uint32_t occluders;
+	uint32_t occluder_triangles;
+};
+
+// Occlusion culling of the camera view, for the draws of RenderQueue that ask for it.
+//
+// Gpu : phase one draws the items that were visible last frame, then a Hi-Z pyramid (farthest depth per texel) is
+// built from the depth buffer and every item's bounds are tested against it. Phase two draws the items that passed
+// and were not drawn by phase one. Both phases run the same indirect commands, a compute shader sets their instance
+// counts to 0 or 1, so nothing is read back. Visibility is kept per item index, which is stable as long as the scene
+// is submitted in the same order every frame.
+//
+// Cpu : the largest visible meshes are rasterized at low resolution into a depth buffer, keeping only pixels they
+// cover entirely at their farthest depth, and every item's screen rect is tested against it before anything is
+// drawn. Meant for the headless path (e.g. software GL, where compute is slow).
+class OcclusionCuller
+{
+public:
+	// std430 bindings, after ClusteredLighting's
+	static constexpr uint32_t COMMAND_BUFFER_BINDING = 4;
+	static constexpr uint32_t ITEM_BUFFER_BINDING = 5;
+	static constexpr uint32_t BOUNDS_BUFFER_BINDING = 6;
+	static constexpr uint32_t VISIBILITY_BUFFER_BINDING = 7;
+	static constexpr uint32_t STATS_BUFFER_BINDING = 8;
+
+	static constexpr uint32_t SOFTWARE_WIDTH = 256;
+	static constexpr uint32_t SOFTWARE_HEIGHT = 128;
+	static constexpr uint32_t MAX_OCCLUDERS = 64;
+
+	// stats buffers in flight, read back once they come around again
+	static constexpr uint32_t STATS_LATENCY = 4;
+
+	OcclusionCuller();
+	~OcclusionCuller();
+
+	OcclusionCuller(const OcclusionCuller&) = delete;
+	OcclusionCuller& operator=(const OcclusionCuller&) = delete;
+
+	// Starts a frame : view_projection is the camera's, depth_texture the depth attachment the culled draws write
+	void begin_frame(OcclusionMode mode, const glm::mat4& view_projection, uint32_t item_count, uint32_t depth_texture, uint32_t width, uint32_t height);
+
+	OcclusionMode get_mode() const;
+
+	// Gpu : commands (in the command buffer, bound to GL_DRAW_INDIRECT_BUFFER) draw items[i] with world bounds
+	// bounds[i]. Once tested, the draws of the rest of the frame reuse the visibility.
+	void set_commands(uint32_t command_buffer, const std::vector<uint32_t>& items, const std::vector<Bounds>& bounds);
+	bool is_tested() const;
+
+	// Sets the instance counts to the visibility of the previous test (of the last frame until test runs)
+	void apply_visibility();
+
+	// Gpu : builds the pyramid from the depth written so far, tests every command against it and sets the instance
+	// counts of the ones that became visible. Cpu : ends the occluders.
+	void test();
+
+	// Cpu : occluders are added first, then test, then the items are queried against them
+	void add_occluder(const Mesh& mesh, const glm::mat4& model_mat);
+	bool is_visible(const Bounds& bounds);
+
+	const OcclusionStats& get_stats() const;
+
+private:
+	void create_pyramid(uint32_t width, uint32_t height);
+	void build_pyramid();
+	void read_stats();
+
+	void rasterize_triangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c);
+
+private:
+	Shader m_pyramid_shader;
+	Shader m_cull_shader;
+
+	OcclusionMode m_mode;
+	glm::mat4 m_view_projection;
+
+	uint32_t m_depth_texture;
+	uint32_t m_pyramid;
+	uint32_t m_pyramid_width;
+	uint32_t m_pyramid_height;
+	uint32_t m_pyramid_levels;
+
+	uint32_t m_item_buffer;
+	uint32_t m_bounds_buffer;
+	uint32_t m_visibility_buffer;
+	uint32_t m_stats_buffers[STATS_LATENCY];
+	uint32_t m_stats_frame;
+
+	uint32_t m_item_count;
+	uint32_t m_command_count;
+	bool m_tested;
+
+	// bounds as (min, max) pairs for the cull shader
+	std::vector<glm::vec4> m_bounds_data;
+
+	// Cpu : farthest depth of the nearest occluder covering each pixel, [0, 1]
+	std::vector<float> m_software_depth;
+
+	OcclusionStats m_stats;
+};
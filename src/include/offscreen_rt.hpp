@@ -0,0 +1,48 @@
+#pragma once
+
+#include "render_graph.hpp"
+
+#include <cstdint>
+
+// Storage of the offscreen HDR targets, Full is the reference the others are validated against
+enum class HdrPrecision
+{
+	Full,	// RGBA32F, 16 bytes per pixel
+	Half,	// RGBA16F, 8 bytes per pixel
+	Packed	// R11G11B10F, 4 bytes per pixel, no alpha (read back as 1)
+};
+
+// Format policy of the offscreen targets. The targets themselves are allocated every frame by the render graph from
+// these descriptions.
+struct HdrFormatPolicy
+{
+	HdrPrecision precision;
+
+	// The bright pass gets its own pass extracting it from scene color at half resolution, instead of being a
+	// second full resolution attachment of the scene pass
+	bool half_res_bright;
+
+	RenderTargetDesc get_color_desc(uint32_t width, uint32_t height) const;
+	RenderTargetDesc get_bright_desc(uint32_t width, uint32_t height) const;
+	RenderTargetDesc get_depth_desc(uint32_t width, uint32_t height) const;
+
+	// Format of the bloom chain blurring the bright pass
+	uint32_t get_bloom_format() const;
+
+	static const char* get_name(HdrPrecision precision);
+};
+
+// Format policy of the scene targets and the fullscreen quad used to draw them
+struct OffscreenRT
+{
+	OffscreenRT(const HdrFormatPolicy& policy);
+	~OffscreenRT();
+
+	OffscreenRT(const OffscreenRT&) = delete;
+	OffscreenRT& operator=(const OffscreenRT&) = delete;
+
+	HdrFormatPolicy policy;
+
+	uint32_t vao;
+	uint32_t vbo;
+};
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// One scope of a resolved frame
+struct ProfileScopeResult
+{
+	uint32_t name_id;
+	uint32_t depth;
+
+	float cpu_ms;
+
+	// negative for CPU only scopes, or when the frame's queries were not ready in time
+	float gpu_ms;
+
+	uint32_t draw_calls;
+	uint64_t triangles;
+};
+
+// Frame profiler : nested CPU scopes, optionally bracketed by GL_TIMESTAMP queries. Queries go to a ring of
+// FRAME_LATENCY frames and a frame is only resolved when its slot comes around again, so reading results never
+// waits on the GPU (a frame whose queries are still not done by then loses its GPU times). Draw calls and triangles
+// reported with add_draws count towards the innermost open scope.
+class Profiler
+{
+public:
+	static constexpr uint32_t FRAME_LATENCY = 4;
+	static constexpr uint32_t HISTORY_SIZE = 128;
+	static constexpr uint32_t INVALID_SCOPE = 0xffffffff;
+
+	static Profiler& get();
+
+	Profiler(const Profiler&) = delete;
+	Profiler& operator=(const Profiler&) = delete;
+
+	// Every scope lives between the two, inside the "frame" scope they open and close
+	void begin_frame();
+	void end_frame();
+
+	uint32_t begin_scope(std::string_view name, bool gpu);
+	void end_scope(uint32_t scope);
+
+	void add_draws(uint32_t draw_calls, uint64_t triangles);
+
+	// Takes effect on the next begin_frame
+	void set_enabled(bool enabled);
+	bool is_enabled() const;
+
+	// Records the next frame_count resolved frames and writes them to path as Chrome trace JSON
+	// (chrome://tracing, ui.perfetto.dev), CPU and GPU on separate tracks
+	void start_capture(uint32_t frame_count, const std::string& path);
+	bool is_capturing() const;
+
+	// Scopes of the latest resolved frame, in the order they began, the "frame" scope first
+	const std::vector<ProfileScopeResult>& get_results() const;
+
+	// Index of the frame get_results describes, and of the frame being recorded
+	uint64_t get_results_frame_index() const;
+	uint64_t get_frame_index() const;
+	const std::string& get_name(uint32_t name_id) const;
+
+	// Rolling per frame times of a scope name (summed when it occurs several times in a frame), HISTORY_SIZE
+	// entries with the oldest at get_history_offset()
+	const float* get_cpu_history(uint32_t name_id) const;
+	const float* get_gpu_history(uint32_t name_id) const;
+	uint32_t get_history_offset() const;
+
+	uint64_t get_dropped_frame_count() const;
+
+private:
+	Profiler();
+	~Profiler();
+
+	struct Scope
+	{
+		uint32_t name_id;
+		uint32_t depth;
+
+		double cpu_begin_us;
+		double cpu_end_us;
+
+		// indices into the frame's queries, INVALID_SCOPE without GPU timing
+		uint32_t gpu_begin_query;
+		uint32_t gpu_end_query;
+
+		uint32_t draw_calls;
+		uint64_t triangles;
+	};
+
+	struct Frame
+	{
+		std::vector<Scope> scopes;
+
+		// GL_TIMESTAMP queries, grown on demand and reused, query_count of them written this frame
+		std::vector<uint32_t> queries;
+		uint32_t query_count;
+
+		uint64_t frame_index;
+
+		// CPU time (us) minus GPU time (us) sampled at begin_frame, to place GPU events on the CPU timeline
+		double gpu_offset_us;
+
+		bool pending;
+	};
+
+	struct CaptureEvent
+	{
+		uint32_t name_id;
+		uint64_t frame_index;
+
+		double cpu_begin_us;
+		double cpu_duration_us;
+
+		// gpu_duration_us is negative without GPU timing
+		double gpu_begin_us;
+		double gpu_duration_us;
+
+		uint32_t draw_calls;
+		uint64_t triangles;
+	};
+
+	struct History
+	{
+		float cpu_ms[HISTORY_SIZE];
+		float gpu_ms[HISTORY_SIZE];
+	};
+
+	void resolve(Frame& frame);
+	void write_capture();
+
+	uint32_t get_name_id(std::string_view name);
+	uint32_t write_timestamp(Frame& frame);
+	double get_cpu_time_us() const;
+
+private:
+	bool m_enabled;
+	bool m_frame_active;
+	uint32_t m_frame_scope;
+
+	Frame m_frames[FRAME_LATENCY];
+	uint64_t m_frame_index;
+
+	// scopes of the current frame still open, innermost last
+	std::vector<uint32_t> m_open_scopes;
+
+	// Transparent hash so name lookups with a string_view do not allocate
+	struct StringHash
+	{
+		using is_transparent = void;
+
+		size_t operator()(std::string_view str) const
+		{
+			return std::hash<std::string_view>{}(str);
+		}
+	};
+
+	std::vector<std::string> m_names;
+	std::unordered_map<std::string, uint32_t, StringHash, std::equal_to<>> m_name_ids;
+
+	std::vector<ProfileScopeResult> m_results;
+	uint64_t m_results_frame_index;
+	std::vector<History> m_histories;
+	uint32_t m_history_offset;
+	uint64_t m_dropped_frames;
+
+	std::vector<CaptureEvent> m_capture_events;
+	std::string m_capture_path;
+	uint32_t m_capture_frames_left;
+
+	std::chrono::steady_clock::time_point m_epoch;
+};
+
+// Profiles the enclosing block
+class ProfileScope
+{
+public:
+	ProfileScope(std::string_view name, bool gpu = true);
+	~ProfileScope();
+
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+	uint32_t m_scope;
+};
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+struct ProgramCacheStats
+{
+	uint32_t hits;
+	uint32_t misses;
+
+	// binaries found on disk but refused by the driver (driver update, other GPU)
+	uint32_t rejected;
+};
+
+// On disk cache of linked program binaries (glGetProgramBinary), one file per program in CACHE_DIRECTORY.
+// Programs are keyed on the hash of their final sources and of the vendor / renderer / version strings, so an edited
+// shader or a different driver simply misses. Misses are compiled with GL_KHR_parallel_shader_compile when the driver
+// has it, so programs created back to back compile concurrently and only block when they are first used.
+class ProgramCache
+{
+public:
+	// Bump when the file layout changes
+	static constexpr uint32_t VERSION = 1;
+
+	static constexpr const char* CACHE_DIRECTORY = "../shader_cache";
+
+	static ProgramCache& get();
+
+	ProgramCache(const ProgramCache&) = delete;
+	ProgramCache& operator=(const ProgramCache&) = delete;
+
+	// Key of a program built from the given stage sources
+	uint64_t get_key(std::string_view vs_source, std::string_view fs_source);
+
+	// Returns a linked program, or 0 if there is no usable binary for the key
+	uint32_t load(uint64_t key);
+	void store(uint64_t key, uint32_t program);
+
+	void set_enabled(bool enabled);
+	bool is_enabled() const;
+
+	// Whether compile / link status can be polled without blocking (GL_COMPLETION_STATUS_KHR)
+	bool has_parallel_compile();
+
+	const ProgramCacheStats& get_stats() const;
+
+	static uint64_t hash(std::string_view data, uint64_t seed = 0xcbf29ce484222325ull);
+
+private:
+	ProgramCache();
+
+	// Driver state is only queried on first use, the cache may be created before the context
+	void init();
+
+	std::string get_path(uint64_t key) const;
+
+private:
+	bool m_initialized;
+	bool m_enabled;
+	bool m_parallel_compile;
+
+	// disables the cache for drivers without binary formats
+	bool m_binary_supported;
+
+	uint64_t m_driver_hash;
+
+	ProgramCacheStats m_stats;
+};
@@ -0,0 +1,274 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+using Entity = uint32_t;
+
+static constexpr Entity NO_ENTITY = std::numeric_limits<Entity>::max();
+
+class ComponentPoolBase
+{
+public:
+	virtual ~ComponentPoolBase() = default;
+
+	virtual void remove(Entity entity) = 0;
+};
+
+// Sparse set : the components of one type packed in a dense array, in step with the entity owning each, and a
+// sparse array from entity to dense index. Removing moves the last component into the hole, so the dense arrays
+// never have gaps and iterating them touches nothing else.
+template <typename T>
+class ComponentPool : public ComponentPoolBase
+{
+public:
+	T& add(Entity entity, const T& component)
+	{
+		if (entity >= m_sparse.size())
+		{
+			m_sparse.resize(entity + 1, NO_INDEX);
+		}
+
+		if (m_sparse[entity] != NO_INDEX)
+		{
+			return m_components[m_sparse[entity]] = component;
+		}
+
+		m_sparse[entity] = static_cast<uint32_t>(m_components.size());
+		m_entities.push_back(entity);
+		m_components.push_back(component);
+
+		return m_components.back();
+	}
+
+	void remove(Entity entity) override
+	{
+		if (!has(entity))
+		{
+			return;
+		}
+
+		const uint32_t index = m_sparse[entity];
+		const Entity last = m_entities.back();
+
+		m_components[index] = std::move(m_components.back());
+		m_entities[index] = last;
+		m_sparse[last] = index;
+
+		m_components.pop_back();
+		m_entities.pop_back();
+		m_sparse[entity] = NO_INDEX;
+	}
+
+	bool has(Entity entity) const
+	{
+		return entity < m_sparse.size() && m_sparse[entity] != NO_INDEX;
+	}
+
+	T& get(Entity entity)
+	{
+		return m_components[m_sparse[entity]];
+	}
+
+	const T& get(Entity entity) const
+	{
+		return m_components[m_sparse[entity]];
+	}
+
+	// Dense arrays, entities[i] owns components[i]
+	std::vector<T>& get_components()
+	{
+		return m_components;
+	}
+
+	const std::vector<Entity>& get_entities() const
+	{
+		return m_entities;
+	}
+
+	size_t size() const
+	{
+		return m_components.size();
+	}
+
+private:
+	static constexpr uint32_t NO_INDEX = std::numeric_limits<uint32_t>::max();
+
+	std::vector<uint32_t> m_sparse;
+	std::vector<Entity> m_entities;
+	std::vector<T> m_components;
+};
+
+// Entities and their components, one ComponentPool per component type. Pools are created by register_component or
+// the first add, the read only accessors never create one, so systems touching different components can run on
+// different threads once every pool they use exists.
+class Registry
+{
+public:
+	Registry()
+		: m_entity_count(0)
+	{
+	}
+
+	Registry(const Registry&) = delete;
+	Registry& operator=(const Registry&) = delete;
+
+	// Ids of destroyed entities are handed out again
+	Entity create()
+	{
+		if (!m_free_entities.empty())
+		{
+			const Entity entity = m_free_entities.back();
+			m_free_entities.pop_back();
+			m_alive[entity] = true;
+			return entity;
+		}
+
+		m_alive.push_back(true);
+		return m_entity_count++;
+	}
+
+	bool is_alive(Entity entity) const
+	{
+		return entity < m_entity_count && m_alive[entity];
+	}
+
+	// Destroying an entity that is not alive (twice, or never created) does nothing, so its id is never handed out twice
+	void destroy(Entity entity)
+	{
+		if (!is_alive(entity))
+		{
+			return;
+		}
+
+		m_alive[entity] = false;
+
+		for (const std::unique_ptr<ComponentPoolBase>& pool : m_pools)
+		{
+			if (pool)
+			{
+				pool->remove(entity);
+			}
+		}
+
+		m_free_entities.push_back(entity);
+	}
+
+	// Number of live entities
+	uint32_t get_entity_count() const
+	{
+		return m_entity_count - static_cast<uint32_t>(m_free_entities.size());
+	}
+
+	template <typename T>
+	ComponentPool<T>& register_component()
+	{
+		const uint32_t type = get_type<T>();
+		if (type >= m_pools.size())
+		{
+			m_pools.resize(type + 1);
+		}
+
+		if (!m_pools[type])
+		{
+			m_pools[type] = std::make_unique<ComponentPool<T>>();
+		}
+
+		return static_cast<ComponentPool<T>&>(*m_pools[type]);
+	}
+
+	template <typename T>
+	T& add(Entity entity, const T& component)
+	{
+		return register_component<T>().add(entity, component);
+	}
+
+	template <typename T>
+	void remove(Entity entity)
+	{
+		if (ComponentPool<T>* pool = find_pool<T>())
+		{
+			pool->remove(entity);
+		}
+	}
+
+	template <typename T>
+	bool has(Entity entity) const
+	{
+		const ComponentPool<T>* pool = find_pool<T>();
+		return pool != nullptr && pool->has(entity);
+	}
+
+	// The entity must have the component
+	template <typename T>
+	T& get(Entity entity)
+	{
+		return find_pool<T>()->get(entity);
+	}
+
+	// Calls fn(entity, first, others...) for every entity having all the components, walking the dense array of
+	// First : put the rarest component first
+	template <typename First, typename... Others, typename Fn>
+	void each(Fn&& fn)
+	{
+		ComponentPool<First>* first = find_pool<First>();
+		if (first == nullptr)
+		{
+			return;
+		}
+
+		const auto others = std::make_tuple(find_pool<Others>()...);
+		if (((std::get<ComponentPool<Others>*>(others) == nullptr) || ...))
+		{
+			return;
+		}
+
+		std::vector<First>& components = first->get_components();
+		const std::vector<Entity>& entities = first->get_entities();
+
+		for (size_t i = 0; i < components.size(); i++)
+		{
+			const Entity entity = entities[i];
+			if ((std::get<ComponentPool<Others>*>(others)->has(entity) && ...))
+			{
+				fn(entity, components[i], std::get<ComponentPool<Others>*>(others)->get(entity)...);
+			}
+		}
+	}
+
+	template <typename T>
+	ComponentPool<T>* find_pool()
+	{
+		const uint32_t type = get_type<T>();
+		return type < m_pools.size() ? static_cast<ComponentPool<T>*>(m_pools[type].get()) : nullptr;
+	}
+
+	template <typename T>
+	const ComponentPool<T>* find_pool() const
+	{
+		const uint32_t type = get_type<T>();
+		return type < m_pools.size() ? static_cast<const ComponentPool<T>*>(m_pools[type].get()) : nullptr;
+	}
+
+private:
+	// Index of T's pool, numbered in order of first use
+	template <typename T>
+	static uint32_t get_type()
+	{
+		static const uint32_t type = s_type_count++;
+		return type;
+	}
+
+private:
+	static inline std::atomic<uint32_t> s_type_count = 0;
+
+	std::vector<std::unique_ptr<ComponentPoolBase>> m_pools;
+	std::vector<Entity> m_free_entities;
+	std::vector<bool> m_alive;
+	Entity m_entity_count;
+};
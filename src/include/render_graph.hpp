@@ -0,0 +1,183 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+struct RenderTargetDesc
+{
+	uint32_t width;
+	uint32_t height;
+
+	// sized internal format (GL_RGBA16F, GL_DEPTH24_STENCIL8, ...)
+	uint32_t format;
+
+	bool operator==(const RenderTargetDesc& other) const = default;
+};
+
+// Texture of the graph, only valid for the frame it was declared in
+struct RenderGraphResource
+{
+	static constexpr uint32_t INVALID = 0xffffffff;
+
+	uint32_t index = INVALID;
+
+	bool is_valid() const
+	{
+		return index != INVALID;
+	}
+};
+
+struct RenderGraphStats
+{
+	uint32_t pass_count;
+	uint32_t culled_pass_count;
+
+	// transient textures declared by the passes, and the pooled textures backing them
+	uint32_t transient_count;
+	uint32_t physical_count;
+
+	uint64_t transient_bytes;
+	uint64_t physical_bytes;
+};
+
+class RenderGraph;
+
+// Handed to a pass's setup function to declare what it reads and writes
+class RenderPassBuilder
+{
+public:
+	// New transient texture, allocated from the graph's pool for the passes that use it
+	RenderGraphResource create(const std::string& name, const RenderTargetDesc& desc);
+
+	void read(RenderGraphResource resource);
+
+	// Attachments of the framebuffer the graph binds (with a matching viewport) before the pass executes
+	void write_color(RenderGraphResource resource);
+	void write_depth(RenderGraphResource resource);
+
+	// Written by the pass through its own means (own framebuffers, compute, copies)
+	void write(RenderGraphResource resource);
+
+	// The pass is never culled, for results that leave the graph (timers, readbacks). Writing the backbuffer
+	// implies it.
+	void set_side_effect();
+
+private:
+	friend class RenderGraph;
+
+	RenderPassBuilder(RenderGraph& graph, uint32_t pass_index);
+
+	RenderGraph& m_graph;
+	uint32_t m_pass_index;
+};
+
+// Frame graph rebuilt every frame : passes declare their resources in a setup callback, compile orders them by
+// dependency, culls passes nothing needs and assigns pooled textures to the transient resources. Transients whose
+// lifetimes do not overlap share a pooled texture when their descriptions match, so memory follows the peak
+// number of live targets rather than the number of passes. Pooled textures unused for a few frames (e.g. after a
+// resize) are freed.
+class RenderGraph
+{
+public:
+	using SetupFn = std::function<void(RenderPassBuilder&)>;
+	using ExecuteFn = std::function<void(RenderGraph&)>;
+
+	// Frames a pooled texture may stay unused before it is deleted
+	static constexpr uint32_t MAX_UNUSED_FRAMES = 4;
+
+	RenderGraph();
+	~RenderGraph();
+
+	RenderGraph(const RenderGraph&) = delete;
+	RenderGraph& operator=(const RenderGraph&) = delete;
+
+	// Clears the passes and resources of the previous frame
+	void reset();
+
+	// Texture owned outside of the graph
+	RenderGraphResource import_texture(const std::string& name, uint32_t texture, const RenderTargetDesc& desc);
+
+	// The final framebuffer (the window's by default, or e.g. a headless output), usable as a color output only
+	RenderGraphResource import_backbuffer(uint32_t width, uint32_t height, uint32_t framebuffer = 0);
+
+	// setup runs right away, execute runs from execute() unless the pass gets culled
+	void add_pass(const std::string& name, const SetupFn& setup, ExecuteFn execute);
+
+	void compile();
+	void execute();
+
+	uint32_t get_texture(RenderGraphResource resource) const;
+	const RenderTargetDesc& get_desc(RenderGraphResource resource) const;
+
+	const RenderGraphStats& get_stats() const;
+
+	static uint64_t get_byte_size(const RenderTargetDesc& desc);
+
+private:
+	friend class RenderPassBuilder;
+
+	struct Resource
+	{
+		std::string name;
+		RenderTargetDesc desc;
+
+		bool imported;
+		bool backbuffer;
+
+		// the framebuffer for the backbuffer
+		uint32_t texture;
+
+		// index into m_pool for transients, and the first / last position in m_order using the resource
+		uint32_t physical;
+		uint32_t first_use;
+		uint32_t last_use;
+	};
+
+	struct Pass
+	{
+		std::string name;
+		ExecuteFn execute;
+
+		std::vector<uint32_t> reads;
+		std::vector<uint32_t> writes;
+		std::vector<uint32_t> color_outputs;
+		uint32_t depth_output;
+
+		bool side_effect;
+		bool culled;
+	};
+
+	struct PhysicalTexture
+	{
+		RenderTargetDesc desc;
+		uint32_t texture;
+
+		bool in_use;
+		uint32_t unused_frames;
+	};
+
+	void sort_passes(const std::vector<std::vector<uint32_t>>& dependencies);
+	void cull_passes(const std::vector<std::vector<uint32_t>>& dependencies);
+	void assign_physical_textures();
+
+	uint32_t acquire_physical(const RenderTargetDesc& desc);
+	uint32_t get_framebuffer(const Pass& pass);
+	void destroy_framebuffers();
+
+private:
+	std::vector<Resource> m_resources;
+	std::vector<Pass> m_passes;
+
+	// execution order, culled passes excluded
+	std::vector<uint32_t> m_order;
+
+	std::vector<PhysicalTexture> m_pool;
+
+	// color attachments + depth attachment -> framebuffer
+	std::map<std::vector<uint32_t>, uint32_t> m_framebuffers;
+
+	RenderGraphStats m_stats;
+};
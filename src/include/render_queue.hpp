@@ -0,0 +1,177 @@
+#pragma once
+
+#include "shader.hpp"
+#include "mesh.hpp"
+#include "geometry_arena.hpp"
+#include "frustum.hpp"
+#include "occlusion_culler.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+// Per object data read by the vertex shaders from the object buffer (std430), indexed with gl_BaseInstance
+struct ObjectData
+{
+	glm::mat4 model_mat;
+	glm::vec4 color;
+};
+
+struct DrawItem
+{
+	Shader* shader;
+	Mesh* mesh;
+
+	uint32_t object_index;
+
+	// picked by flush
+	uint32_t lod;
+};
+
+// State changes issued and skipped by the last flush / draw
+struct RenderQueueStats
+{
+	uint32_t submitted_items;
+
+	// by the frustum, or by the CPU occlusion culling
+	uint32_t culled_items;
+
+	// triangles drawn, and the count at full detail for comparison
+	uint64_t triangles;
+	uint64_t full_detail_triangles;
+
+	uint32_t draw_calls;
+	uint32_t draw_commands;
+
+	// the GPU occlusion culling's second submission of the same commands, kept out of the counts above and below
+	uint32_t second_phase_draw_calls;
+
+	uint32_t shader_binds;
+	uint32_t material_binds;
+	uint32_t texture_binds;
+	uint32_t vao_binds;
+
+	uint32_t skipped_shader_binds;
+	uint32_t skipped_material_binds;
+	uint32_t skipped_texture_binds;
+	uint32_t skipped_vao_binds;
+
+	uint32_t get_saved_state_changes() const
+	{
+		return skipped_shader_binds + skipped_material_binds + skipped_texture_binds + skipped_vao_binds;
+	}
+};
+
+// Collects draws for a frame, frustum culls them, sorts them by shader, material and VAO with a 64 bit key and submits every run of
+// items sharing shader and material as one glMultiDrawElementsIndirect, skipping state that is already bound.
+// Per shader uniforms (view / projection / lights) are set by the caller before flush.
+class RenderQueue
+{
+public:
+	static constexpr uint32_t OBJECT_BUFFER_BINDING = 0;
+
+	RenderQueue();
+	~RenderQueue();
+
+	RenderQueue(const RenderQueue&) = delete;
+	RenderQueue& operator=(const RenderQueue&) = delete;
+
+	// Returns the index of the object in the object buffer, shared by every mesh submitted with it
+	uint32_t add_object(const glm::mat4& transform, const glm::vec3& color = glm::vec3(1.0f));
+	void submit(Shader& shader, Mesh& mesh, uint32_t object_index);
+
+	// Items whose bounds (under their object's transform) are outside the frustum are dropped by flush, the frustum
+	// is usually set every frame from projection * view
+	void set_frustum(const Frustum& frustum);
+	void set_culling_enabled(bool enabled);
+
+	// Every item is drawn with the coarsest LOD whose error projects to at most lod_error_pixels on screen, seen from
+	// camera_position with a vertical field of view of fov_y (radians). A threshold of 0 always draws full detail.
+	void set_lod_view(const glm::vec3& camera_position, float fov_y, float viewport_height, float lod_error_pixels);
+
+	// Culls, sorts and draws every submitted item, then clears the queue
+	void flush();
+
+	// The two halves of flush, for a queue drawn more than once per frame (several targets or views). With
+	// occlusion, items hidden from the camera are skipped as well, the first occluded draw of the frame (which
+	// should write depth) doing the occlusion test.
+	void draw(OcclusionCuller* occlusion = nullptr);
+	void clear();
+
+	// Draws every submitted item that intersects frustum for a depth only pass (shadow maps, depth prepass) :
+	// alpha tested items with alpha_test_shader and their material, everything else with shader alone, so opaque
+	// items only split into draws by VAO. Returns the number of items drawn (before occlusion culling).
+	uint32_t draw_depth(Shader& shader, Shader& alpha_test_shader, const Frustum& frustum, OcclusionCuller* occlusion = nullptr);
+
+	uint32_t get_item_count() const;
+
+	// Hash of the submitted objects and meshes, equal between two frames whose queues would draw the same geometry
+	uint64_t get_scene_hash() const;
+
+	const RenderQueueStats& get_stats() const;
+
+	static uint64_t make_sort_key(uint32_t program, uint32_t material_id, uint32_t vao);
+
+private:
+	uint32_t select_lod(const DrawItem& item, const glm::vec4& world_sphere) const;
+
+	// Submits the items of m_sort_keys (indices into items, which are indexed like m_items) in batches sharing
+	// shader, material and VAO. For depth only draws, opaque items have no material to bind. With GPU occlusion the
+	// commands are drawn in two phases around the occlusion test.
+	void draw_batches(const std::vector<DrawItem>& items, bool depth_only, RenderQueueStats& stats, OcclusionCuller* occlusion);
+	void submit_batches(const std::vector<DrawItem>& items, bool depth_only, RenderQueueStats& stats);
+
+	// CPU occlusion, once per frame : rasterizes the largest items in view and marks the items they hide
+	void cull_occluded(OcclusionCuller& occlusion);
+	bool is_occluded(uint32_t index, const OcclusionCuller* occlusion) const;
+
+	static bool is_alpha_tested(const DrawItem& item);
+	static uint32_t get_batch_material(const DrawItem& item, bool depth_only);
+
+	// Shared by the draws of a frame, done by the first one
+	void build_bounds();
+	void upload_objects();
+
+private:
+	static constexpr uint32_t MAX_TEXTURE_UNITS = 16;
+
+	static constexpr uint32_t UNBOUND = std::numeric_limits<uint32_t>::max();
+	static constexpr uint32_t NO_MATERIAL = UNBOUND - 1;
+
+	std::vector<ObjectData> m_objects;
+	std::vector<DrawItem> m_items;
+
+	// copies of the items of a depth draw (by item index, only the visible ones are set), with the depth shaders in
+	// place of theirs
+	std::vector<DrawItem> m_depth_items;
+	std::vector<std::pair<uint64_t, uint32_t>> m_sort_keys;
+	std::vector<DrawElementsIndirectCommand> m_commands;
+
+	// item and world bounds of each command, for the GPU occlusion test
+	std::vector<uint32_t> m_occlusion_items;
+	std::vector<Bounds> m_occlusion_bounds;
+
+	// CPU occlusion : (screen size, item) of the occluder candidates, and whether each item is hidden
+	std::vector<std::pair<float, uint32_t>> m_occluder_candidates;
+	std::vector<uint8_t> m_occluded;
+
+	FrustumCuller m_culler;
+	Frustum m_frustum;
+	bool m_culling_enabled;
+
+	bool m_bounds_built;
+	bool m_objects_uploaded;
+
+	glm::vec3 m_camera_position;
+	// screen pixels per world unit at distance 1
+	float m_lod_projection_scale;
+	float m_lod_error_pixels;
+
+	uint32_t m_object_buffer;
+	uint32_t m_indirect_buffer;
+
+	RenderQueueStats m_stats;
+};
@@ -0,0 +1,209 @@
+#pragma once
+
+#include "camera.hpp"
+#include "shader.hpp"
+#include "shader_variants.hpp"
+#include "model.hpp"
+#include "render_queue.hpp"
+#include "render_graph.hpp"
+#include "bloom_renderer.hpp"
+#include "offscreen_rt.hpp"
+#include "image_compare.hpp"
+#include "clustered_lighting.hpp"
+#include "shadow_renderer.hpp"
+#include "occlusion_culler.hpp"
+#include "registry.hpp"
+#include "components.hpp"
+#include "gpu_counter.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Fragment shader invocations of the scene pass (pipeline statistics, a few frames behind)
+struct SceneInvocationStats
+{
+	uint64_t prepass;
+	uint64_t color;
+
+	// latest color pass count measured with the prepass off, to compare against
+	uint64_t color_without_prepass;
+};
+
+// Everything the UI tweaks, read by Renderer::render_frame every frame
+struct RenderSettings
+{
+	RenderSettings();
+
+	glm::vec4 clear_color;
+
+	glm::vec3 light_position;
+	glm::vec3 light_color;
+	float light_intensity;
+	float height_scale;
+
+	// clustered point lights scattered over the scene, on top of the main light
+	int point_light_count;
+	float point_light_radius;
+	float point_light_intensity;
+	bool animate_point_lights;
+
+	// directional light with cascaded shadows
+	glm::vec3 sun_direction;
+	glm::vec3 sun_color;
+	float sun_intensity;
+	bool shadows;
+	int shadow_cascade_count;
+	int shadow_resolution;
+	float shadow_distance;
+	float shadow_split_lambda;
+
+	// depth only pass before the color pass, which then shades each pixel once with GL_EQUAL
+	bool depth_prepass;
+
+	// OcclusionMode of the camera view
+	int occlusion_culling;
+
+	glm::vec3 cube_position;
+	glm::vec3 cube_scale;
+	glm::vec3 cube_color;
+
+	// cubes scattered over the scene as entities, to load the entity systems and the render queue
+	int object_count;
+
+	bool frustum_culling;
+	float lod_error_pixels;
+
+	float exposure;
+	float bloom_intensity;
+	float spread;
+	int bloom_mip_count;
+	bool gaussian_bloom;
+	bool compare_bloom;
+
+	int hdr_precision;
+	bool half_res_bright;
+	bool validate_precision;
+};
+
+// The scene and the frame pipeline (scene -> bloom -> tonemap -> ui through the render graph), independent of how
+// the context was created so the windowed app and headless runs render the same frames
+class Renderer
+{
+public:
+	// luminance above which the half resolution bright pass keeps a pixel, as in test_fragment
+	static constexpr float BRIGHT_THRESHOLD = 0.5f;
+
+	static constexpr float NEAR_PLANE = 0.1f;
+	static constexpr float FAR_PLANE = 1000.0f;
+
+	static constexpr int MAX_POINT_LIGHTS = 1024;
+
+	// radius of the circle the animated point lights follow
+	static constexpr float POINT_LIGHT_ORBIT = 2.0f;
+
+	static constexpr int MAX_OBJECTS = 50000;
+
+	Renderer(uint32_t width, uint32_t height);
+
+	Renderer(const Renderer&) = delete;
+	Renderer& operator=(const Renderer&) = delete;
+
+	// Renders the scene seen from camera into output_framebuffer (0 for the window's), width x height. draw_ui,
+	// when set, draws on top of the tonemapped image in a last pass.
+	void render_frame(Camera& camera, uint32_t width, uint32_t height, uint32_t output_framebuffer, const std::function<void()>& draw_ui);
+
+	// Renders one frame like render_frame, then waits for every shader variant it asked for, so the next frames
+	// draw with the real variants rather than stand-ins. For runs whose output must not depend on compile times.
+	void warm_up(Camera& camera, uint32_t width, uint32_t height, uint32_t output_framebuffer);
+
+	RenderSettings& get_settings();
+
+	// Seconds driving the animations (point lights), set by the caller so headless runs stay deterministic
+	void set_time(float time);
+
+	// stats of the previous frame
+	const RenderQueueStats& get_queue_stats() const;
+	const RenderGraphStats& get_graph_stats() const;
+	const BloomRenderer& get_bloom_renderer() const;
+	const ImageDifference& get_precision_difference() const;
+	size_t get_scene_shader_variant_count() const;
+	const ClusteredLightingStats& get_light_stats() const;
+	const ShadowStats& get_shadow_stats() const;
+	SceneInvocationStats get_invocation_stats() const;
+	const OcclusionStats& get_occlusion_stats() const;
+	uint32_t get_entity_count() const;
+
+private:
+	void submit_scene(Camera& camera, uint32_t width, uint32_t height);
+
+	// create or destroy entities to match the light and object counts of the settings
+	void update_point_lights();
+	void update_objects();
+
+	// world space bounds of the scene model
+	Bounds get_scene_bounds() const;
+
+	// pass bodies, shared with the reference passes of the precision validation (which are not counted or
+	// occlusion culled)
+	void draw_scene(bool count_invocations, OcclusionCuller* occlusion);
+	void render_bloom(BloomRenderer& renderer, uint32_t bright_texture, bool gaussian);
+	void draw_tonemap(uint32_t scene_texture, uint32_t bloom_texture);
+
+private:
+	RenderSettings m_settings;
+
+	// everything placed in the scene, updated each frame by SceneSystems
+	Registry m_registry;
+
+	Entity m_sponza;
+	Entity m_light_source;
+	Entity m_cube;
+
+	// the lights circle around fixed anchors (xyz, phase in w), spread once over the scene bounds
+	std::vector<Entity> m_point_light_entities;
+	std::vector<PointLight> m_point_lights;
+	std::vector<glm::vec4> m_point_light_anchors;
+	std::vector<glm::vec3> m_point_light_colors;
+	float m_time;
+
+	std::vector<Entity> m_object_entities;
+
+	Shader m_light_shader;
+
+	// test_fragment permutations, one per combination of material textures in the scene
+	ShaderVariants m_scene_shaders;
+
+	// depth_vertex / depth_fragment for the prepass, the variants of the frame picked before their uniforms are set.
+	// The alpha tested one is never a stand-in : drawn without the discard, its transparent texels would write
+	// depth that the GL_EQUAL color pass then discards, leaving holes.
+	ShaderVariants m_depth_shaders;
+	Shader* m_opaque_depth_shader;
+	Shader* m_alpha_test_depth_shader;
+	Shader m_offscreen_fb_shader;
+	Shader m_bright_extract_shader;
+
+	OffscreenRT m_offscreen_rt;
+	RenderQueue m_render_queue;
+	ClusteredLighting m_clustered_lighting;
+	ShadowRenderer m_shadow_renderer;
+	OcclusionCuller m_occlusion_culler;
+	BloomRenderer m_bloom_renderer;
+	Frustum m_view_frustum;
+	glm::mat4 m_view_projection;
+
+	// color pass counters without / with the prepass, so each keeps the results of its own mode
+	GpuCounter m_prepass_invocations;
+	GpuCounter m_color_invocations[2];
+	RenderGraph m_render_graph;
+
+	// precision validation : the frame is rendered a second time with 32F targets and the tonemapped outputs compared
+	HdrFormatPolicy m_reference_policy;
+	std::unique_ptr<BloomRenderer> m_reference_bloom_renderer;
+	std::vector<uint8_t> m_validation_pixels;
+	std::vector<uint8_t> m_reference_pixels;
+	ImageDifference m_precision_difference;
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+// Transform hierarchy stored flat in depth first order : a node's parent always comes before it and its subtree is
+// the range [node, node + subtree size). Local and world matrices, parents and dirty flags live in separate arrays.
+// update only recomputes the subtrees of the nodes whose local matrix changed, starting at the first one, and
+// splits large updates into independent subtree ranges over the threads of the JobSystem.
+class SceneGraph
+{
+public:
+	static constexpr uint32_t NO_PARENT = std::numeric_limits<uint32_t>::max();
+
+	// nodes left to update from which update goes parallel
+	static constexpr uint32_t PARALLEL_THRESHOLD = 16384;
+
+	SceneGraph();
+
+	void clear();
+	void reserve(uint32_t node_count);
+
+	// Appends a node, which keeps the depth first order only if parent is NO_PARENT, the last node or one of its
+	// ancestors. Returns the node, or NO_PARENT if parent breaks the order.
+	uint32_t add_node(uint32_t parent, const glm::mat4& local_mat);
+
+	// Marks the node dirty if local_mat differs from its current one
+	void set_local(uint32_t node, const glm::mat4& local_mat);
+
+	// Brings the world matrices of every dirty node and its subtree up to date
+	void update();
+
+	uint32_t get_node_count() const;
+	uint32_t get_parent(uint32_t node) const;
+	uint32_t get_subtree_size(uint32_t node) const;
+	const glm::mat4& get_local(uint32_t node) const;
+
+	// As of the last update
+	const glm::mat4& get_world(uint32_t node) const;
+
+	// World matrices recomputed by the last update
+	uint32_t get_updated_count() const;
+
+private:
+	// Updates nodes [begin, end), whose parents outside the range are up to date, returns the updated count
+	uint32_t update_range(uint32_t begin, uint32_t end);
+	void update_parallel(uint32_t begin, uint32_t thread_count);
+
+private:
+	std::vector<uint32_t> m_parents;
+	std::vector<uint32_t> m_subtree_sizes;
+	std::vector<glm::mat4> m_local;
+	std::vector<glm::mat4> m_world;
+
+	// set for a changed local matrix, then during update for every node whose world matrix changes
+	std::vector<uint8_t> m_dirty;
+	uint32_t m_first_dirty;
+
+	// subtrees handed to the threads of a parallel update
+	std::vector<std::pair<uint32_t, uint32_t>> m_ranges;
+
+	uint32_t m_updated_count;
+};
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "registry.hpp"
+#include "components.hpp"
+#include "clustered_lighting.hpp"
+#include "render_queue.hpp"
+
+#include <vector>
+
+// The systems run over the Registry every frame, each walking the dense arrays of the components it needs. Orbits
+// and transforms come first, after them bounds, lights and submit only read the transforms and write disjoint data,
+// so they can run at the same time (submit issues GL calls when a shader variant is first used, so it has to stay
+// on the GL thread).
+class SceneSystems
+{
+public:
+	// Registers every component pool, so the systems running in parallel never create one
+	static void register_components(Registry& registry);
+
+	// Moves the orbiting entities to their position at time (seconds)
+	static void update_orbits(Registry& registry, float time);
+
+	// Rebuilds the world matrix of every dirty transform
+	static void update_transforms(Registry& registry);
+
+	// Refreshes the world bounds of the renderers whose transform or model changed since the last update
+	static void update_bounds(Registry& registry);
+
+	// Replaces lights with every light entity, in pool order
+	static void collect_point_lights(Registry& registry, std::vector<PointLight>& lights);
+
+	static void submit_renderers(Registry& registry, RenderQueue& queue);
+};
@@ -4,23 +4,125 @@
 #include <glm/glm.hpp>
 
 #include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
+// Location of an active uniform, resolved once and kept by the caller. The type only selects the set() overload.
+template <typename T>
+struct UniformHandle
+{
+	int32_t location = -1;
+};
+
+// The program comes from the ProgramCache when a binary of the same sources exists, otherwise compiling and linking
+// is only submitted by the constructor. With GL_KHR_parallel_shader_compile the driver compiles on its own threads,
+// so shaders created back to back build concurrently, and the link result is picked up the first time the program
+// is used or queried.
+//
+// A shader is either a vertex / fragment pair or a single compute stage.
+//
+// Sources are preprocessed before compiling : #include "file" lines are replaced by the file (relative to the
+// including one, each file included once), and every entry of defines becomes a #define right after #version.
 class Shader
 {
 public:
-	Shader(const char* vs_path, const char* fs_path);
+	Shader(const char* vs_path, const char* fs_path, const std::vector<std::string>& defines = {});
+	explicit Shader(const char* cs_path, const std::vector<std::string>& defines = {});
+	~Shader();
+
+	// Registered with HotReload by address
+	Shader(const Shader&) = delete;
+	Shader& operator=(const Shader&) = delete;
 
 	void use();
 
+	// Compute shaders : use() and glDispatchCompute
+	void dispatch(uint32_t groups_x, uint32_t groups_y = 1, uint32_t groups_z = 1);
+
+	uint32_t get_program() const;
+
+	// Non-blocking : true once compiling and linking finished (always true without parallel compile support)
+	bool is_ready() const;
+
+	// Blocks until the program is linked, then reports errors, reflects the uniforms and stores the binary.
+	// Returns false if compiling or linking failed.
+	bool wait() const;
+
+	// Rebuilds the program from the files on disk. On failure the errors are reported and the previous program
+	// stays in use. Uniform locations may move, handles taken before must be fetched again when the generation
+	// changed.
+	bool reload();
+	uint32_t get_generation() const;
+
+	// The stage files and everything they include
+	const std::vector<std::string>& get_source_files() const;
+
+	// Looked up in the table reflected at link time, -1 (ignored by glUniform*) for inactive uniforms
+	int32_t get_uniform_location(std::string_view name) const;
+
+	template <typename T>
+	UniformHandle<T> get_uniform(std::string_view name) const
+	{
+		return UniformHandle<T>{ get_uniform_location(name) };
+	}
+
+	void set(UniformHandle<int> handle, int value) const;
+	void set(UniformHandle<bool> handle, bool value) const;
+	void set(UniformHandle<float> handle, float value) const;
+	void set(UniformHandle<glm::vec3> handle, const glm::vec3& value) const;
+	void set(UniformHandle<glm::mat4> handle, const glm::mat4& mat) const;
+
 	void set_int(const char* name, int value) const;
 	void set_bool(const char* name, bool value) const;
 	void set_float(const char* name, float value) const;
+	void set_vec2f(const char* name, const glm::vec2& value) const;
 	void set_vec3f(const char* name, const glm::vec3& value) const;
 	void set_vec3f(const char* name, float x, float y, float z) const;
 	void set_mat4(const char* name, const glm::mat4& mat) const;
 
 private:
+	struct Stage
+	{
+		uint32_t type;
+		std::string path;
+
+		// only while compiling
+		uint32_t shader;
+	};
+
+	void build();
+	bool load_sources(std::vector<std::string>& sources);
+	uint64_t get_cache_key(const std::vector<std::string>& sources) const;
+	void compile(const std::vector<std::string>& sources);
+	void reflect_uniforms() const;
+
+private:
+	// Transparent hash so lookups with a const char* / string_view do not allocate
+	struct StringHash
+	{
+		using is_transparent = void;
+
+		size_t operator()(std::string_view str) const
+		{
+			return std::hash<std::string_view>{}(str);
+		}
+	};
+
+	// filled in by wait(), which the const accessors may trigger
+	mutable std::unordered_map<std::string, int32_t, StringHash, std::equal_to<>> m_uniform_locations;
+
 	uint32_t m_program;
-	uint32_t m_vertex_shader;
-	uint32_t m_fragment_shader;
+
+	mutable bool m_pending;
+	mutable bool m_linked;
+	uint64_t m_cache_key;
+	uint32_t m_generation;
+
+	// deleted by wait(), which the const accessors may trigger
+	mutable std::vector<Stage> m_stages;
+	std::vector<std::string> m_defines;
+	std::vector<std::string> m_source_files;
 };
\ No newline at end of file
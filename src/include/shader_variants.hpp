@@ -0,0 +1,66 @@
+#pragma once
+
+#include "shader.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Permutation keywords of the lit shaders, combined into a bit mask. Each set bit is compiled in as a #define of
+// the same name.
+struct ShaderKeywords
+{
+	static constexpr uint32_t NONE = 0;
+	static constexpr uint32_t HAS_NORMAL_MAP = 1 << 0;
+	static constexpr uint32_t HAS_HEIGHT_MAP = 1 << 1;
+	static constexpr uint32_t ALPHA_TEST = 1 << 2;
+
+	static constexpr uint32_t COUNT = 3;
+
+	static const char* get_name(uint32_t bit_index);
+	static std::vector<std::string> get_defines(uint32_t keywords);
+};
+
+// The variants of one vertex / fragment shader pair, compiled the first time a keyword combination is asked for and
+// kept for the lifetime of the object. Returned shaders stay at the same address.
+//
+// A new variant compiles in the background (GL_KHR_parallel_shader_compile) : until it is ready, get returns the
+// ready variant with the most of the asked keywords (fewer features for a few frames rather than a stall), and
+// only blocks when no such variant exists. get_exact and wait_all are for callers that can not take a stand-in.
+class ShaderVariants
+{
+public:
+	ShaderVariants(const char* vs_path, const char* fs_path);
+
+	ShaderVariants(const ShaderVariants&) = delete;
+	ShaderVariants& operator=(const ShaderVariants&) = delete;
+
+	Shader& get(uint32_t keywords);
+
+	// The variant of exactly keywords, waiting for its compile when it is not ready yet
+	Shader& get_exact(uint32_t keywords);
+
+	// Waits for every variant created so far to finish compiling
+	void wait_all();
+
+	// Visits every ready variant, e.g. to set the per frame uniforms. Variants still compiling are skipped, get
+	// never hands them out.
+	void for_each(const std::function<void(Shader&)>& fn);
+
+	size_t get_variant_count() const;
+
+private:
+	// the variant of keywords, its compile started if it did not exist yet
+	Shader& create(uint32_t keywords);
+
+	// the ready variant whose keywords are the largest subset of keywords, nullptr if there is none
+	Shader* find_fallback(uint32_t keywords);
+
+	std::string m_vs_path;
+	std::string m_fs_path;
+
+	std::unordered_map<uint32_t, std::unique_ptr<Shader>> m_variants;
+};
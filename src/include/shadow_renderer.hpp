@@ -0,0 +1,96 @@
+#pragma once
+
+#include "shader_variants.hpp"
+#include "render_queue.hpp"
+#include "bounds.hpp"
+#include "frustum.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+
+struct ShadowStats
+{
+	uint32_t cascade_count;
+
+	// cascades drawn this frame, and cascades whose previous contents were still valid
+	uint32_t rendered_cascades;
+	uint32_t cached_cascades;
+
+	// items drawn over all the rendered cascades
+	uint32_t drawn_items;
+};
+
+// Cascaded shadow maps for a directional light, one layer of a depth array texture per cascade. The view frustum
+// up to the shadow distance is split with the practical scheme (a blend of logarithmic and uniform splits) and each
+// cascade is an orthographic projection around the bounding sphere of its slice. The sphere keeps the cascade size
+// constant as the camera turns, and its center is snapped to whole shadow map texels, so static shadows do not
+// shimmer. Each cascade only draws the casters inside its own volume, and a cascade whose matrix and scene are
+// unchanged since it was last drawn is not drawn again.
+class ShadowRenderer
+{
+public:
+	static constexpr uint32_t MAX_CASCADES = 4;
+	static constexpr uint32_t DEFAULT_RESOLUTION = 2048;
+
+	// out of the way of the material textures
+	static constexpr uint32_t TEXTURE_UNIT = 15;
+
+	ShadowRenderer(uint32_t resolution, uint32_t cascade_count);
+	~ShadowRenderer();
+
+	ShadowRenderer(const ShadowRenderer&) = delete;
+	ShadowRenderer& operator=(const ShadowRenderer&) = delete;
+
+	void set_resolution(uint32_t resolution);
+	void set_cascade_count(uint32_t cascade_count);
+
+	// Fits the cascades to the camera (perspective with fov_y in radians), light_direction points from the light
+	// into the scene. Casters are taken from the whole of scene_bounds along the light.
+	void update(const glm::mat4& view_mat, float fov_y, float aspect, float near_plane, float shadow_distance, float split_lambda,
+		const glm::vec3& light_direction, const Bounds& scene_bounds);
+
+	// Draws the cascades that are out of date, scene_hash tells whether the casters changed
+	void render(RenderQueue& queue, uint64_t scene_hash);
+
+	// Forces every cascade to be drawn again on the next render
+	void invalidate();
+
+	// Waits for the depth shader variants created so far to finish compiling
+	void wait_shaders();
+
+	void bind() const;
+	void set_uniforms(Shader& shader) const;
+
+	uint32_t get_texture() const;
+	uint32_t get_resolution() const;
+	uint32_t get_cascade_count() const;
+	const ShadowStats& get_stats() const;
+
+private:
+	void create_targets();
+	void destroy_targets();
+
+private:
+	// depth_vertex / depth_fragment, opaque and alpha tested
+	ShaderVariants m_depth_shaders;
+
+	uint32_t m_resolution;
+	uint32_t m_cascade_count;
+
+	uint32_t m_texture;
+	uint32_t m_fbo;
+
+	glm::mat4 m_light_space_matrices[MAX_CASCADES];
+	Frustum m_frustums[MAX_CASCADES];
+
+	// far view depth of each cascade
+	float m_splits[MAX_CASCADES];
+
+	// what each layer holds, compared against the current frame to skip it
+	glm::mat4 m_cached_matrices[MAX_CASCADES];
+	bool m_cached[MAX_CASCADES];
+	uint64_t m_cached_scene_hash;
+
+	ShadowStats m_stats;
+};
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Image decoded by a worker, waiting to be uploaded from the GL thread
+struct DecodedImage
+{
+	uint32_t texture_id;
+	uint64_t ticket;
+	bool gamma;
+	std::string path;
+
+	int width;
+	int height;
+	int num_components;
+	unsigned char* data;
+};
+
+// Decodes textures with stb on a pool of worker threads and uploads the results on the GL thread through a
+// ring of persistently mapped PBOs. Textures are created up front with a 1x1 placeholder, so their ids can be
+// used for drawing right away and the real image replaces the placeholder once it is uploaded.
+class TextureLoader
+{
+public:
+	static TextureLoader& get();
+
+	TextureLoader(const TextureLoader&) = delete;
+	TextureLoader& operator=(const TextureLoader&) = delete;
+
+	// Must be called from the GL thread
+	uint32_t load(const std::string& path, bool gamma, const uint8_t placeholder[4]);
+
+	// Decodes path again into an existing texture, which keeps its current image until the new one is uploaded
+	// (or for good if the decode fails)
+	void reload(uint32_t texture_id, const std::string& path, bool gamma);
+
+	// Drops every load and reload of texture_id queued so far, decoded or not. Call from the GL thread before
+	// deleting the texture, whose name GL may hand out again.
+	void cancel(uint32_t texture_id);
+
+	// Uploads finished decodes, call once per frame from the GL thread. Never blocks on the GPU.
+	void upload_pending(uint32_t max_uploads = 4);
+
+	// Blocks until every queued texture has been decoded and uploaded
+	void wait_idle();
+
+	uint32_t get_pending_count();
+
+	// Joins the workers and releases the PBO ring. Call before the GL context is destroyed.
+	void shutdown();
+
+private:
+	TextureLoader();
+	~TextureLoader();
+
+	void worker_loop();
+	void queue_request(uint32_t texture_id, const std::string& path, bool gamma);
+
+	// true when cancel was called for the texture after the request was queued, call with m_mutex held
+	bool is_cancelled(uint32_t texture_id, uint64_t ticket) const;
+
+	void create_pbo_ring();
+	bool upload(DecodedImage& image);
+
+private:
+	static constexpr uint32_t PBO_SLOT_COUNT = 4;
+	static constexpr size_t PBO_SLOT_SIZE = 16 * 1024 * 1024;
+
+	// Max decoded images held in memory, workers wait for the GL thread when it is full
+	static constexpr size_t MAX_DECODED_IMAGES = 8;
+
+	struct DecodeRequest
+	{
+		uint32_t texture_id;
+		uint64_t ticket;
+		bool gamma;
+		std::string path;
+	};
+
+	std::vector<std::thread> m_workers;
+
+	std::mutex m_mutex;
+	std::condition_variable m_request_cv;
+	std::condition_variable m_space_cv;
+
+	std::deque<DecodeRequest> m_requests;
+	std::deque<DecodedImage> m_decoded;
+	uint32_t m_pending_count;
+	bool m_stop;
+
+	// requests are numbered in order, those of a texture below its entry here were cancelled
+	uint64_t m_next_ticket;
+	std::unordered_map<uint32_t, uint64_t> m_cancelled_before;
+
+	uint32_t m_pbo;
+	uint8_t* m_pbo_mapped;
+	GLsync m_pbo_fences[PBO_SLOT_COUNT];
+	uint32_t m_pbo_slot;
+
+	float m_max_anisotropy;
+};
@@ -7,13 +7,20 @@
 
 #include <glm/glm.hpp>
 
+#include <cstdint>
+
 struct GLFWwindow;
 
 class UIManager
 {
 public:
+	static constexpr uint32_t CAPTURE_FRAME_COUNT = 120;
+
 	UIManager(GLFWwindow* windo);
 
+	// Per scope CPU / GPU times, draw counts and rolling histograms of the latest resolved profiler frame
+	void draw_profiler();
+
 	void present();
 
 public:
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "bounds.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct Vertex
+{
+	glm::vec3 position;
+	glm::vec3 normal;
+	glm::vec2 tex_coords;
+	glm::vec3 tangent;
+	glm::vec3 bitangent;
+};
+
+enum class VertexFormat
+{
+	// Vertex as is, 56 bytes
+	Full,
+	// Float position, octahedral normal / tangent + bitangent sign, half float UVs, 24 bytes
+	Packed,
+	// Packed, with positions quantized to 16 bit relative to the mesh bounds, 20 bytes
+	PackedQuantized,
+};
+
+// normal : octahedral snorm16 x 2, tangent : octahedral snorm10 x 2 + bitangent sign (GL_INT_2_10_10_10_REV),
+// tex_coords : half x 2
+struct PackedVertex
+{
+	float position[3];
+	uint32_t normal;
+	uint32_t tangent;
+	uint32_t tex_coords;
+};
+
+// position : unorm16 x 3 (+ padding) in the mesh bounds, the rest as PackedVertex
+struct QuantizedVertex
+{
+	uint16_t position[4];
+	uint32_t normal;
+	uint32_t tangent;
+	uint32_t tex_coords;
+};
+
+static_assert(sizeof(PackedVertex) == 24 && sizeof(QuantizedVertex) == 20, "packed vertex layouts must stay tightly packed");
+
+// Vertex layout policies, each one names the vertex type stored on the GPU, converts a Vertex into it and sets up
+// the matching attributes (same locations as Vertex, see test_packed_vertex.glsl for the decode side).
+struct FullVertexPolicy
+{
+	using GpuVertex = Vertex;
+	static constexpr VertexFormat FORMAT = VertexFormat::Full;
+
+	static GpuVertex pack(const Vertex& vertex, const Bounds& bounds);
+	static void setup_attributes(uint32_t vao);
+};
+
+struct PackedVertexPolicy
+{
+	using GpuVertex = PackedVertex;
+	static constexpr VertexFormat FORMAT = VertexFormat::Packed;
+
+	static GpuVertex pack(const Vertex& vertex, const Bounds& bounds);
+	static void setup_attributes(uint32_t vao);
+};
+
+struct QuantizedVertexPolicy
+{
+	using GpuVertex = QuantizedVertex;
+	static constexpr VertexFormat FORMAT = VertexFormat::PackedQuantized;
+
+	static GpuVertex pack(const Vertex& vertex, const Bounds& bounds);
+	static void setup_attributes(uint32_t vao);
+
+	// Maps the [0, 1] quantized positions back into mesh space, folded into the object transform. The scale is
+	// uniform so that mat3(model_mat) still transforms normals correctly.
+	static glm::mat4 get_dequantize_mat(const Bounds& bounds);
+};
+
+uint32_t get_vertex_size(VertexFormat format);
+
+// "full", "packed" or "quantized", names the mesh cache of each format
+const char* get_vertex_format_name(VertexFormat format);
+
+// Replaces packed with count vertices in the GPU layout of format, done once when a mesh is cooked
+void pack_vertices(VertexFormat format, const Vertex* vertices, size_t count, const Bounds& bounds, std::vector<uint8_t>& packed);
+
+// Position of a vertex stored in the GPU layout of format, in the space the object transform applies to (the unit
+// grid for quantized positions)
+glm::vec3 get_vertex_position(VertexFormat format, const uint8_t* vertex);
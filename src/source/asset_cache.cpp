@@ -0,0 +1,140 @@
+#include "../include/asset_cache.hpp"
+#include "../include/model.hpp"
+#include "../include/texture_loader.hpp"
+
+#include <glad/glad.h>
+
+#include <filesystem>
+
+AssetCache& AssetCache::get()
+{
+	static AssetCache asset_cache;
+	return asset_cache;
+}
+
+AssetCache::AssetCache()
+	: m_stats{}
+{
+}
+
+uint32_t AssetCache::acquire_texture(const std::string& path, bool gamma, const uint8_t placeholder[4])
+{
+	// the same image can be loaded as sRGB (color) and linear (data), those are different GL textures
+	const std::string key = get_canonical_path(path) + (gamma ? "|srgb" : "|linear");
+
+	auto it = m_textures.find(key);
+	if (it != m_textures.end())
+	{
+		m_stats.texture_hits++;
+		it->second.ref_count++;
+
+		return it->second.texture_id;
+	}
+
+	m_stats.texture_misses++;
+
+	uint32_t texture_id = TextureLoader::get().load(path, gamma, placeholder);
+	m_textures[key] = { texture_id, 1 };
+	m_texture_keys[texture_id] = key;
+
+	return texture_id;
+}
+
+void AssetCache::release_texture(uint32_t texture_id)
+{
+	auto key_it = m_texture_keys.find(texture_id);
+	if (key_it == m_texture_keys.end())
+	{
+		return;
+	}
+
+	auto it = m_textures.find(key_it->second);
+	if (--it->second.ref_count == 0)
+	{
+		// a decode still queued would otherwise upload into the deleted (or recycled) name
+		TextureLoader::get().cancel(texture_id);
+		glDeleteTextures(1, &texture_id);
+
+		m_textures.erase(it);
+		m_texture_keys.erase(key_it);
+	}
+}
+
+std::shared_ptr<Model> AssetCache::acquire_model(const std::string& path, VertexFormat format)
+{
+	const std::string key = get_canonical_path(path) + '|' + std::to_string(static_cast<int>(format));
+
+	auto it = m_models.find(key);
+	if (it != m_models.end())
+	{
+		if (std::shared_ptr<Model> model = it->second.lock())
+		{
+			m_stats.model_hits++;
+			return model;
+		}
+	}
+
+	m_stats.model_misses++;
+
+	std::shared_ptr<Model> model = std::make_shared<Model>(path.c_str(), format);
+	m_models[key] = model;
+
+	return model;
+}
+
+bool AssetCache::reload_texture(const std::string& path)
+{
+	const std::string canonical_path = get_canonical_path(path);
+
+	bool found = false;
+	for (bool gamma : { true, false })
+	{
+		auto it = m_textures.find(canonical_path + (gamma ? "|srgb" : "|linear"));
+		if (it != m_textures.end())
+		{
+			TextureLoader::get().reload(it->second.texture_id, canonical_path, gamma);
+			found = true;
+		}
+	}
+
+	return found;
+}
+
+uint32_t AssetCache::reload_models(const std::string& path)
+{
+	const std::string directory = std::filesystem::path(get_canonical_path(path)).parent_path().generic_string();
+
+	uint32_t reloaded = 0;
+	for (auto& [key, weak_model] : m_models)
+	{
+		std::shared_ptr<Model> model = weak_model.lock();
+		if (model && get_canonical_path(model->get_directory()) == directory && model->reload())
+		{
+			reloaded++;
+		}
+	}
+
+	return reloaded;
+}
+
+const AssetCacheStats& AssetCache::get_stats() const
+{
+	return m_stats;
+}
+
+size_t AssetCache::get_texture_count() const
+{
+	return m_textures.size();
+}
+
+std::string AssetCache::get_canonical_path(const std::string& path)
+{
+	std::error_code error;
+	std::filesystem::path canonical_path = std::filesystem::weakly_canonical(path, error);
+	if (error)
+	{
+		canonical_path = std::filesystem::path(path).lexically_normal();
+	}
+
+	return canonical_path.generic_string();
+}
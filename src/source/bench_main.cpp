@@ -0,0 +1,314 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../include/benchmark.hpp"
+#include "../include/camera.hpp"
+#include "../include/camera_path.hpp"
+#include "../include/capture_target.hpp"
+#include "../include/headless_context.hpp"
+#include "../include/profiler.hpp"
+#include "../include/renderer.hpp"
+#include "../include/texture_loader.hpp"
+
+// GLEngine_bench [--camera path.json] [--frames N] [--warmup N] [--size WxH] [--headless] [--output results.json]
+//                [--baseline baseline.json] [--tolerance 0.05]
+struct BenchOptions
+{
+	BenchOptions();
+
+	// recorded with the record button of the app, one orbit around the atrium without one
+	std::string camera_path;
+
+	// the path is spread over frame_count frames whatever its duration, so every run renders the same views
+	uint32_t frame_count;
+	uint32_t warmup_frames;
+
+	uint32_t width;
+	uint32_t height;
+	bool headless;
+
+	std::string output_path;
+	std::string baseline_path;
+	float tolerance;
+};
+
+bool parse_bench_options(int argc, char** argv, BenchOptions& options);
+GLFWwindow* create_bench_window(uint32_t width, uint32_t height);
+
+int main(int argc, char** argv)
+{
+	BenchOptions options;
+	if (!parse_bench_options(argc, argv, options))
+	{
+		return -1;
+	}
+
+	CameraPath camera_path;
+	if (options.camera_path.empty())
+	{
+		camera_path = CameraPath::make_orbit(glm::vec3(0.0f, 15.0f, 0.0f), 40.0f, 5.0f, 10.0f, 16);
+	}
+	else if (!camera_path.load(options.camera_path))
+	{
+		return -1;
+	}
+
+	std::unique_ptr<HeadlessContext> headless_context;
+	GLFWwindow* window = nullptr;
+
+	if (options.headless)
+	{
+		headless_context = std::make_unique<HeadlessContext>();
+		if (!headless_context->is_valid())
+		{
+			return -1;
+		}
+	}
+	else
+	{
+		window = create_bench_window(options.width, options.height);
+		if (!window)
+		{
+			return -1;
+		}
+	}
+
+	std::vector<BenchmarkFrame> frames(options.frame_count, BenchmarkFrame{ 0.0f, -1.0f, 0, 0 });
+	double peak_render_target_mb = 0.0;
+
+	// scoped so every GL object is released while the context is still alive
+	{
+		Renderer renderer(options.width, options.height);
+
+		std::unique_ptr<CaptureTarget> capture;
+		if (options.headless)
+		{
+			capture = std::make_unique<CaptureTarget>(options.width, options.height);
+		}
+
+		const uint32_t output_framebuffer = capture ? capture->get_framebuffer() : 0;
+
+		// streaming textures would make the first frames cheaper than the rest
+		TextureLoader::get().wait_idle();
+
+		// and stand-in shader variants would make them draw with fewer features
+		Profiler& profiler = Profiler::get();
+		Camera camera;
+		camera_path.apply(0.0f, camera);
+
+		profiler.begin_frame();
+		renderer.warm_up(camera, options.width, options.height, output_framebuffer);
+		profiler.end_frame();
+
+		const uint64_t first_frame = profiler.get_frame_index() + options.warmup_frames;
+
+		// GPU times and draw counts come from the profiler, FRAME_LATENCY frames after the frame itself
+		auto collect_profile = [&]()
+		{
+			const std::vector<ProfileScopeResult>& results = profiler.get_results();
+			const uint64_t frame_index = profiler.get_results_frame_index();
+
+			if (results.empty() || frame_index < first_frame || frame_index >= first_frame + options.frame_count)
+			{
+				return;
+			}
+
+			BenchmarkFrame& frame = frames[frame_index - first_frame];
+			frame.gpu_ms = results[0].gpu_ms;
+
+			for (const ProfileScopeResult& result : results)
+			{
+				frame.draw_calls += result.draw_calls;
+				frame.triangles += result.triangles;
+			}
+		};
+
+		const uint32_t total_frames = options.warmup_frames + options.frame_count;
+
+		for (uint32_t i = 0; i < total_frames; i++)
+		{
+			const auto frame_start = std::chrono::steady_clock::now();
+
+			profiler.begin_frame();
+			collect_profile();
+
+			if (window)
+			{
+				glfwPollEvents();
+			}
+
+			// warmup frames stay at the start of the path
+			const uint32_t path_frame = i < options.warmup_frames ? 0 : i - options.warmup_frames;
+			const float path_time = path_frame * camera_path.get_duration() / options.frame_count;
+			camera_path.apply(path_time, camera);
+			renderer.set_time(path_time);
+
+			renderer.render_frame(camera, options.width, options.height, output_framebuffer, nullptr);
+
+			if (window)
+			{
+				glfwSwapBuffers(window);
+			}
+			else
+			{
+				glFlush();
+			}
+
+			profiler.end_frame();
+
+			const float cpu_ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - frame_start).count();
+			if (i >= options.warmup_frames)
+			{
+				frames[i - options.warmup_frames].cpu_ms = cpu_ms;
+				peak_render_target_mb = std::max(peak_render_target_mb, renderer.get_graph_stats().physical_bytes / (1024.0 * 1024.0));
+			}
+		}
+
+		// resolve the frames still in flight
+		glFinish();
+		for (uint32_t i = 0; i < Profiler::FRAME_LATENCY; i++)
+		{
+			profiler.begin_frame();
+			collect_profile();
+			profiler.end_frame();
+		}
+	}
+
+	TextureLoader::get().shutdown();
+
+	if (window)
+	{
+		glfwTerminate();
+	}
+
+	BenchmarkSummary summary = Benchmark::summarize(frames);
+	summary.peak_render_target_mb = peak_render_target_mb;
+
+	std::printf("%u frames, cpu p50 / p95 / p99 %.3f / %.3f / %.3f ms, gpu p50 / p95 / p99 %.3f / %.3f / %.3f ms\n", summary.frame_count,
+		summary.cpu_ms.p50, summary.cpu_ms.p95, summary.cpu_ms.p99, summary.gpu_ms.p50, summary.gpu_ms.p95, summary.gpu_ms.p99);
+
+	if (!Benchmark::save(summary, options.output_path))
+	{
+		return -1;
+	}
+
+	if (!options.baseline_path.empty())
+	{
+		BenchmarkSummary baseline{};
+		if (!Benchmark::load(options.baseline_path, baseline))
+		{
+			return -1;
+		}
+
+		if (!Benchmark::compare(summary, baseline, options.tolerance))
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+BenchOptions::BenchOptions()
+	: frame_count(600), warmup_frames(60), width(1920), height(1080), headless(false), output_path("bench_results.json"), tolerance(0.05f)
+{
+}
+
+bool parse_bench_options(int argc, char** argv, BenchOptions& options)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		const bool has_value = i + 1 < argc;
+
+		if (std::strcmp(argv[i], "--camera") == 0 && has_value)
+		{
+			options.camera_path = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--frames") == 0 && has_value)
+		{
+			options.frame_count = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		}
+		else if (std::strcmp(argv[i], "--warmup") == 0 && has_value)
+		{
+			options.warmup_frames = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		}
+		else if (std::strcmp(argv[i], "--size") == 0 && has_value)
+		{
+			if (std::sscanf(argv[++i], "%ux%u", &options.width, &options.height) != 2 || options.width == 0 || options.height == 0)
+			{
+				std::cout << "Invalid size " << argv[i] << ", expected WIDTHxHEIGHT\n";
+				return false;
+			}
+		}
+		else if (std::strcmp(argv[i], "--headless") == 0)
+		{
+			options.headless = true;
+		}
+		else if (std::strcmp(argv[i], "--output") == 0 && has_value)
+		{
+			options.output_path = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--baseline") == 0 && has_value)
+		{
+			options.baseline_path = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--tolerance") == 0 && has_value)
+		{
+			options.tolerance = std::strtof(argv[++i], nullptr);
+		}
+		else
+		{
+			std::cout << "Unknown option " << argv[i] << "\n";
+			return false;
+		}
+	}
+
+	if (options.frame_count == 0)
+	{
+		std::cout << "Nothing to benchmark with 0 frames\n";
+		return false;
+	}
+
+	return true;
+}
+
+GLFWwindow* create_bench_window(uint32_t width, uint32_t height)
+{
+	glfwInit();
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+
+	GLFWwindow* window = glfwCreateWindow(width, height, "GLEngine_bench", nullptr, nullptr);
+	if (!window)
+	{
+		std::cout << "Failed to create GLFW window";
+		glfwTerminate();
+		return nullptr;
+	}
+
+	glfwMakeContextCurrent(window);
+
+	// frame times have to measure the frame, not the display
+	glfwSwapInterval(0);
+
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+	{
+		std::cout << "Failed to initialize GLAD";
+		glfwTerminate();
+		return nullptr;
+	}
+
+	return window;
+}
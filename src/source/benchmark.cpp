@@ -0,0 +1,203 @@
+#include "../include/benchmark.hpp"
+
+#include <nlohmann/json.hpp>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+	BenchmarkPercentiles get_percentiles(std::vector<float> values)
+	{
+		BenchmarkPercentiles percentiles{};
+		if (values.empty())
+		{
+			return percentiles;
+		}
+
+		std::sort(values.begin(), values.end());
+
+		// nearest rank
+		auto percentile = [&](float p)
+		{
+			const size_t rank = static_cast<size_t>(std::ceil(p * values.size()));
+			return values[std::clamp<size_t>(rank, 1, values.size()) - 1];
+		};
+
+		double sum = 0.0;
+		for (float value : values)
+		{
+			sum += value;
+		}
+
+		percentiles.mean = static_cast<float>(sum / values.size());
+		percentiles.p50 = percentile(0.50f);
+		percentiles.p95 = percentile(0.95f);
+		percentiles.p99 = percentile(0.99f);
+		percentiles.max = values.back();
+
+		return percentiles;
+	}
+
+	nlohmann::json to_json(const BenchmarkPercentiles& percentiles)
+	{
+		return { { "mean", percentiles.mean }, { "p50", percentiles.p50 }, { "p95", percentiles.p95 }, { "p99", percentiles.p99 }, { "max", percentiles.max } };
+	}
+
+	BenchmarkPercentiles from_json(const nlohmann::json& json)
+	{
+		BenchmarkPercentiles percentiles{};
+		percentiles.mean = json.value("mean", 0.0f);
+		percentiles.p50 = json.value("p50", 0.0f);
+		percentiles.p95 = json.value("p95", 0.0f);
+		percentiles.p99 = json.value("p99", 0.0f);
+		percentiles.max = json.value("max", 0.0f);
+
+		return percentiles;
+	}
+
+	bool compare_metric(const char* name, float value, float baseline, float tolerance)
+	{
+		const float change = baseline > 0.0f ? (value - baseline) / baseline : 0.0f;
+		const bool regressed = change > tolerance;
+
+		std::printf("%-12s %9.3f ms  baseline %9.3f ms  %+7.2f %%%s\n", name, value, baseline, change * 100.0f, regressed ? "  REGRESSION" : "");
+		return !regressed;
+	}
+}
+
+BenchmarkSummary Benchmark::summarize(const std::vector<BenchmarkFrame>& frames)
+{
+	std::vector<float> cpu_ms;
+	std::vector<float> gpu_ms;
+	double draw_calls = 0.0;
+	double triangles = 0.0;
+
+	for (const BenchmarkFrame& frame : frames)
+	{
+		cpu_ms.push_back(frame.cpu_ms);
+		if (frame.gpu_ms >= 0.0f)
+		{
+			gpu_ms.push_back(frame.gpu_ms);
+		}
+
+		draw_calls += frame.draw_calls;
+		triangles += static_cast<double>(frame.triangles);
+	}
+
+	BenchmarkSummary summary{};
+	summary.frame_count = static_cast<uint32_t>(frames.size());
+	summary.cpu_ms = get_percentiles(cpu_ms);
+	summary.gpu_ms = get_percentiles(gpu_ms);
+
+	if (!frames.empty())
+	{
+		summary.draw_calls = static_cast<float>(draw_calls / frames.size());
+		summary.triangles = static_cast<float>(triangles / frames.size());
+	}
+
+	summary.peak_memory_mb = get_peak_memory_mb();
+
+	return summary;
+}
+
+bool Benchmark::save(const BenchmarkSummary& summary, const std::string& path)
+{
+	const nlohmann::json json =
+	{
+		{ "frame_count", summary.frame_count },
+		{ "cpu_ms", to_json(summary.cpu_ms) },
+		{ "gpu_ms", to_json(summary.gpu_ms) },
+		{ "draw_calls", summary.draw_calls },
+		{ "triangles", summary.triangles },
+		{ "peak_memory_mb", summary.peak_memory_mb },
+		{ "peak_render_target_mb", summary.peak_render_target_mb }
+	};
+
+	std::ofstream file(path);
+	if (!file)
+	{
+		std::cout << "Failed to write benchmark results " << path << "\n";
+		return false;
+	}
+
+	file << json.dump(1, '\t');
+	return true;
+}
+
+bool Benchmark::load(const std::string& path, BenchmarkSummary& summary)
+{
+	std::ifstream file(path);
+	if (!file)
+	{
+		std::cout << "Failed to open benchmark results " << path << "\n";
+		return false;
+	}
+
+	const nlohmann::json json = nlohmann::json::parse(file, nullptr, false);
+	if (json.is_discarded() || !json.contains("cpu_ms") || !json.contains("gpu_ms"))
+	{
+		std::cout << "Benchmark results " << path << " are not valid\n";
+		return false;
+	}
+
+	summary = {};
+	summary.frame_count = json.value("frame_count", 0u);
+	summary.cpu_ms = from_json(json["cpu_ms"]);
+	summary.gpu_ms = from_json(json["gpu_ms"]);
+	summary.draw_calls = json.value("draw_calls", 0.0f);
+	summary.triangles = json.value("triangles", 0.0f);
+	summary.peak_memory_mb = json.value("peak_memory_mb", 0.0);
+	summary.peak_render_target_mb = json.value("peak_render_target_mb", 0.0);
+
+	return true;
+}
+
+bool Benchmark::compare(const BenchmarkSummary& summary, const BenchmarkSummary& baseline, float tolerance)
+{
+	bool passed = true;
+
+	passed &= compare_metric("cpu p50", summary.cpu_ms.p50, baseline.cpu_ms.p50, tolerance);
+	passed &= compare_metric("cpu p95", summary.cpu_ms.p95, baseline.cpu_ms.p95, tolerance);
+	passed &= compare_metric("cpu p99", summary.cpu_ms.p99, baseline.cpu_ms.p99, tolerance);
+	passed &= compare_metric("gpu p50", summary.gpu_ms.p50, baseline.gpu_ms.p50, tolerance);
+	passed &= compare_metric("gpu p95", summary.gpu_ms.p95, baseline.gpu_ms.p95, tolerance);
+	passed &= compare_metric("gpu p99", summary.gpu_ms.p99, baseline.gpu_ms.p99, tolerance);
+
+	// not timings, only reported
+	std::printf("draw calls   %9.1f     baseline %9.1f\n", summary.draw_calls, baseline.draw_calls);
+	std::printf("triangles    %9.0f     baseline %9.0f\n", summary.triangles, baseline.triangles);
+	std::printf("peak memory  %9.1f MB  baseline %9.1f MB\n", summary.peak_memory_mb, baseline.peak_memory_mb);
+
+	return passed;
+}
+
+double Benchmark::get_peak_memory_mb()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters{};
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+	{
+		return counters.PeakWorkingSetSize / (1024.0 * 1024.0);
+	}
+
+	return 0.0;
+#else
+	// ru_maxrss is in kilobytes on Linux
+	rusage usage{};
+	getrusage(RUSAGE_SELF, &usage);
+
+	return usage.ru_maxrss / 1024.0;
+#endif
+}
@@ -0,0 +1,277 @@
+#include "../include/bloom_renderer.hpp"
+#include "../include/profiler.hpp"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <iostream>
+
+BloomRenderer::BloomRenderer(uint32_t width, uint32_t height, uint32_t mip_count, uint32_t format)
+	: m_downsample_shader("../shaders/offscreen_vertex.glsl", "../shaders/bloom_downsample_fragment.glsl"),
+	  m_upsample_shader("../shaders/offscreen_vertex.glsl", "../shaders/bloom_upsample_fragment.glsl"),
+	  m_gaussian_shader("../shaders/offscreen_vertex.glsl", "../shaders/gaussian_blur_fragment.glsl"),
+	  m_uniform_generation(0), m_width(width), m_height(height), m_mip_count(mip_count), m_format(format), m_mip_texture(0), m_gaussian_fbos{}, m_gaussian_textures{}
+{
+	resolve_uniforms();
+	create_targets();
+}
+
+BloomRenderer::~BloomRenderer()
+{
+	destroy_targets();
+}
+
+void BloomRenderer::resize(uint32_t width, uint32_t height)
+{
+	if (width == m_width && height == m_height)
+	{
+		return;
+	}
+
+	m_width = width;
+	m_height = height;
+
+	destroy_targets();
+	create_targets();
+}
+
+void BloomRenderer::set_mip_count(uint32_t mip_count)
+{
+	if (mip_count == m_mip_count)
+	{
+		return;
+	}
+
+	m_mip_count = mip_count;
+
+	destroy_targets();
+	create_targets();
+}
+
+uint32_t BloomRenderer::get_mip_count() const
+{
+	return m_mip_count;
+}
+
+void BloomRenderer::set_format(uint32_t format)
+{
+	if (format == m_format)
+	{
+		return;
+	}
+
+	m_format = format;
+
+	destroy_targets();
+	create_targets();
+}
+
+uint32_t BloomRenderer::get_format() const
+{
+	return m_format;
+}
+
+uint32_t BloomRenderer::render(uint32_t bright_texture, float spread, uint32_t quad_vao)
+{
+	resolve_uniforms();
+
+	m_mip_chain_timer.begin();
+
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_BLEND);
+	glBindVertexArray(quad_vao);
+	glActiveTexture(GL_TEXTURE0);
+
+	// down : bright pass -> level 0 -> ... -> level n - 1
+	m_downsample_shader.use();
+	m_downsample_shader.set(m_downsample_spread, spread);
+
+	for (uint32_t i = 0; i < m_mip_count; i++)
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, m_mip_fbos[i]);
+		glViewport(0, 0, m_mip_sizes[i].x, m_mip_sizes[i].y);
+		glBindTexture(GL_TEXTURE_2D, i == 0 ? bright_texture : m_mip_views[i - 1]);
+
+		glDrawArrays(GL_TRIANGLES, 0, 6);
+	}
+
+	// up : level n - 1 -> ... -> level 0, each level's downsampled content is no longer needed once the level
+	// below it exists, so it is simply overwritten
+	m_upsample_shader.use();
+	m_upsample_shader.set(m_upsample_spread, spread);
+
+	for (uint32_t i = m_mip_count - 1; i > 0; i--)
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, m_mip_fbos[i - 1]);
+		glViewport(0, 0, m_mip_sizes[i - 1].x, m_mip_sizes[i - 1].y);
+		glBindTexture(GL_TEXTURE_2D, m_mip_views[i]);
+
+		glDrawArrays(GL_TRIANGLES, 0, 6);
+	}
+
+	glViewport(0, 0, m_width, m_height);
+
+	m_mip_chain_timer.end();
+
+	Profiler::get().add_draws(m_mip_count * 2 - 1, (m_mip_count * 2 - 1) * 2);
+
+	return m_mip_views[0];
+}
+
+uint32_t BloomRenderer::render_gaussian(uint32_t bright_texture, float spread, uint32_t quad_vao, uint32_t passes)
+{
+	resolve_uniforms();
+
+	m_gaussian_timer.begin();
+
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_BLEND);
+	glBindVertexArray(quad_vao);
+	glActiveTexture(GL_TEXTURE0);
+
+	bool horizontal = true;
+	bool first_iteration = true;
+
+	m_gaussian_shader.use();
+	m_gaussian_shader.set(m_gaussian_spread, spread);
+
+	for (uint32_t i = 0; i < passes; i++)
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, m_gaussian_fbos[horizontal]);
+		m_gaussian_shader.set(m_gaussian_horizontal, horizontal);
+		glBindTexture(GL_TEXTURE_2D, first_iteration ? bright_texture : m_gaussian_textures[!horizontal]);
+
+		glDrawArrays(GL_TRIANGLES, 0, 6);
+
+		horizontal = !horizontal;
+		first_iteration = false;
+	}
+
+	m_gaussian_timer.end();
+
+	Profiler::get().add_draws(passes, passes * 2);
+
+	return m_gaussian_textures[!horizontal];
+}
+
+uint32_t BloomRenderer::get_output_texture(bool gaussian, uint32_t passes) const
+{
+	if (gaussian)
+	{
+		// the ping-pong ends in target 1 after an odd number of passes
+		return m_gaussian_textures[passes % 2];
+	}
+
+	return m_mip_views[0];
+}
+
+glm::ivec2 BloomRenderer::get_output_size(bool gaussian) const
+{
+	return gaussian ? glm::ivec2(m_width, m_height) : m_mip_sizes[0];
+}
+
+float BloomRenderer::get_mip_chain_ms() const
+{
+	return m_mip_chain_timer.get_ms();
+}
+
+float BloomRenderer::get_gaussian_ms() const
+{
+	return m_gaussian_timer.get_ms();
+}
+
+void BloomRenderer::resolve_uniforms()
+{
+	// generations only grow, so their sum changes whenever one of the shaders was hot reloaded
+	const uint32_t generation = m_downsample_shader.get_generation() + m_upsample_shader.get_generation() + m_gaussian_shader.get_generation() + 1;
+	if (generation == m_uniform_generation)
+	{
+		return;
+	}
+
+	m_downsample_spread = m_downsample_shader.get_uniform<float>("spread");
+	m_upsample_spread = m_upsample_shader.get_uniform<float>("spread");
+	m_gaussian_horizontal = m_gaussian_shader.get_uniform<bool>("horizontal");
+	m_gaussian_spread = m_gaussian_shader.get_uniform<float>("spread");
+
+	m_uniform_generation = generation;
+}
+
+void BloomRenderer::create_targets()
+{
+	// level 0 is half resolution, and no level may go below 1x1
+	uint32_t max_mip_count = 1;
+	while (max_mip_count < MAX_MIP_COUNT && std::max(m_width, m_height) >> (max_mip_count + 1) > 0)
+	{
+		max_mip_count++;
+	}
+
+	m_mip_count = std::clamp(m_mip_count, 1u, max_mip_count);
+
+	m_mip_sizes.clear();
+	for (uint32_t i = 0; i < m_mip_count; i++)
+	{
+		m_mip_sizes.emplace_back(std::max(m_width >> (i + 1), 1u), std::max(m_height >> (i + 1), 1u));
+	}
+
+	glCreateTextures(GL_TEXTURE_2D, 1, &m_mip_texture);
+	glTextureStorage2D(m_mip_texture, m_mip_count, m_format, m_mip_sizes[0].x, m_mip_sizes[0].y);
+
+	m_mip_views.resize(m_mip_count);
+	m_mip_fbos.resize(m_mip_count);
+
+	glGenTextures(m_mip_count, m_mip_views.data());
+	glCreateFramebuffers(m_mip_count, m_mip_fbos.data());
+
+	for (uint32_t i = 0; i < m_mip_count; i++)
+	{
+		glTextureView(m_mip_views[i], GL_TEXTURE_2D, m_mip_texture, m_format, i, 1, 0, 1);
+
+		glTextureParameteri(m_mip_views[i], GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTextureParameteri(m_mip_views[i], GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTextureParameteri(m_mip_views[i], GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTextureParameteri(m_mip_views[i], GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+		glNamedFramebufferTexture(m_mip_fbos[i], GL_COLOR_ATTACHMENT0, m_mip_texture, i);
+
+		if (glCheckNamedFramebufferStatus(m_mip_fbos[i], GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		{
+			std::cout << "Bloom mip framebuffer " << i << " not complete!\n";
+		}
+	}
+
+	// full resolution ping-pong targets of the gaussian path
+	glCreateTextures(GL_TEXTURE_2D, 2, m_gaussian_textures);
+	glCreateFramebuffers(2, m_gaussian_fbos);
+
+	for (int i = 0; i < 2; i++)
+	{
+		glTextureStorage2D(m_gaussian_textures[i], 1, m_format, m_width, m_height);
+
+		glTextureParameteri(m_gaussian_textures[i], GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTextureParameteri(m_gaussian_textures[i], GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTextureParameteri(m_gaussian_textures[i], GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTextureParameteri(m_gaussian_textures[i], GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+		glNamedFramebufferTexture(m_gaussian_fbos[i], GL_COLOR_ATTACHMENT0, m_gaussian_textures[i], 0);
+
+		if (glCheckNamedFramebufferStatus(m_gaussian_fbos[i], GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		{
+			std::cout << "Bloom framebuffer not complete!\n";
+		}
+	}
+}
+
+void BloomRenderer::destroy_targets()
+{
+	glDeleteFramebuffers(static_cast<int32_t>(m_mip_fbos.size()), m_mip_fbos.data());
+	glDeleteTextures(static_cast<int32_t>(m_mip_views.size()), m_mip_views.data());
+	glDeleteTextures(1, &m_mip_texture);
+
+	m_mip_fbos.clear();
+	m_mip_views.clear();
+	m_mip_texture = 0;
+
+	glDeleteFramebuffers(2, m_gaussian_fbos);
+	glDeleteTextures(2, m_gaussian_textures);
+}
@@ -0,0 +1,149 @@
+#include "../include/camera_path.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+bool CameraPath::load(const std::string& path)
+{
+	std::ifstream file(path);
+	if (!file)
+	{
+		std::cout << "Failed to open camera path " << path << "\n";
+		return false;
+	}
+
+	const nlohmann::json json = nlohmann::json::parse(file, nullptr, false);
+	if (json.is_discarded() || !json.contains("keyframes") || !json["keyframes"].is_array())
+	{
+		std::cout << "Camera path " << path << " is not valid\n";
+		return false;
+	}
+
+	m_keyframes.clear();
+	for (const nlohmann::json& entry : json["keyframes"])
+	{
+		const nlohmann::json& position = entry.value("position", nlohmann::json::array());
+		if (position.size() != 3)
+		{
+			std::cout << "Camera path " << path << " has a keyframe without a position\n";
+			return false;
+		}
+
+		CameraKeyframe keyframe{};
+		keyframe.time = entry.value("time", 0.0f);
+		keyframe.position = glm::vec3(position[0].get<float>(), position[1].get<float>(), position[2].get<float>());
+		keyframe.yaw = entry.value("yaw", -90.0f);
+		keyframe.pitch = entry.value("pitch", 0.0f);
+
+		m_keyframes.push_back(keyframe);
+	}
+
+	std::stable_sort(m_keyframes.begin(), m_keyframes.end(), [](const CameraKeyframe& a, const CameraKeyframe& b) { return a.time < b.time; });
+
+	return true;
+}
+
+bool CameraPath::save(const std::string& path) const
+{
+	nlohmann::json keyframes = nlohmann::json::array();
+	for (const CameraKeyframe& keyframe : m_keyframes)
+	{
+		keyframes.push_back({ { "time", keyframe.time }, { "position", { keyframe.position.x, keyframe.position.y, keyframe.position.z } },
+			{ "yaw", keyframe.yaw }, { "pitch", keyframe.pitch } });
+	}
+
+	std::ofstream file(path);
+	if (!file)
+	{
+		std::cout << "Failed to write camera path " << path << "\n";
+		return false;
+	}
+
+	file << nlohmann::json{ { "keyframes", keyframes } }.dump(1, '\t');
+	return true;
+}
+
+void CameraPath::add_keyframe(const CameraKeyframe& keyframe)
+{
+	m_keyframes.push_back(keyframe);
+}
+
+void CameraPath::clear()
+{
+	m_keyframes.clear();
+}
+
+void CameraPath::apply(float time, Camera& camera) const
+{
+	if (m_keyframes.empty())
+	{
+		return;
+	}
+
+	// first keyframe after time
+	auto next = std::upper_bound(m_keyframes.begin(), m_keyframes.end(), time, [](float t, const CameraKeyframe& keyframe) { return t < keyframe.time; });
+
+	CameraKeyframe keyframe{};
+	if (next == m_keyframes.begin())
+	{
+		keyframe = m_keyframes.front();
+	}
+	else if (next == m_keyframes.end())
+	{
+		keyframe = m_keyframes.back();
+	}
+	else
+	{
+		const CameraKeyframe& a = *(next - 1);
+		const CameraKeyframe& b = *next;
+		const float t = b.time > a.time ? (time - a.time) / (b.time - a.time) : 0.0f;
+
+		keyframe.position = glm::mix(a.position, b.position, t);
+		keyframe.yaw = a.yaw + (b.yaw - a.yaw) * t;
+		keyframe.pitch = a.pitch + (b.pitch - a.pitch) * t;
+	}
+
+	camera.m_position = keyframe.position;
+	camera.m_yaw = keyframe.yaw;
+	camera.m_pitch = keyframe.pitch;
+	camera.update_vectors();
+}
+
+float CameraPath::get_duration() const
+{
+	return m_keyframes.empty() ? 0.0f : m_keyframes.back().time;
+}
+
+bool CameraPath::is_empty() const
+{
+	return m_keyframes.empty();
+}
+
+CameraPath CameraPath::make_orbit(const glm::vec3& center, float radius, float height, float duration, uint32_t keyframe_count)
+{
+	CameraPath path;
+	keyframe_count = std::max(keyframe_count, 2u);
+
+	for (uint32_t i = 0; i < keyframe_count; i++)
+	{
+		const float t = i / static_cast<float>(keyframe_count - 1);
+		const float angle = t * 2.0f * 3.14159265f;
+
+		CameraKeyframe keyframe{};
+		keyframe.time = t * duration;
+		keyframe.position = center + glm::vec3(std::cos(angle) * radius, height, std::sin(angle) * radius);
+
+		// looking back at the center, the yaw grows with the angle and is left unwrapped
+		const glm::vec3 direction = glm::normalize(center - keyframe.position);
+		keyframe.yaw = glm::degrees(angle) + 180.0f;
+		keyframe.pitch = glm::degrees(std::asin(direction.y));
+
+		path.add_keyframe(keyframe);
+	}
+
+	return path;
+}
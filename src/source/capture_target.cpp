@@ -0,0 +1,50 @@
+#include "../include/capture_target.hpp"
+
+#include <glad/glad.h>
+#include <stb_image_write.h>
+
+#include <iostream>
+
+CaptureTarget::CaptureTarget(uint32_t width, uint32_t height)
+	: m_width(width), m_height(height), m_framebuffer(0), m_texture(0)
+{
+	glCreateTextures(GL_TEXTURE_2D, 1, &m_texture);
+	glTextureStorage2D(m_texture, 1, GL_RGBA8, width, height);
+
+	glCreateFramebuffers(1, &m_framebuffer);
+	glNamedFramebufferTexture(m_framebuffer, GL_COLOR_ATTACHMENT0, m_texture, 0);
+
+	if (glCheckNamedFramebufferStatus(m_framebuffer, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "Capture framebuffer not complete!\n";
+	}
+}
+
+CaptureTarget::~CaptureTarget()
+{
+	glDeleteFramebuffers(1, &m_framebuffer);
+	glDeleteTextures(1, &m_texture);
+}
+
+uint32_t CaptureTarget::get_framebuffer() const
+{
+	return m_framebuffer;
+}
+
+bool CaptureTarget::save_png(const std::string& path)
+{
+	m_pixels.resize(static_cast<size_t>(m_width) * m_height * 4);
+
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glGetTextureImage(m_texture, 0, GL_RGBA, GL_UNSIGNED_BYTE, static_cast<int32_t>(m_pixels.size()), m_pixels.data());
+
+	// GL rows start at the bottom
+	stbi_flip_vertically_on_write(1);
+	if (!stbi_write_png(path.c_str(), m_width, m_height, 4, m_pixels.data(), m_width * 4))
+	{
+		std::cout << "Failed to write " << path << "\n";
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,249 @@
+#include "../include/clustered_lighting.hpp"
+
+#include <glad/glad.h>
+
+#if defined(__SSE__) || defined(_M_X64) || defined(_M_IX86)
+#define CLUSTER_SSE
+#include <xmmintrin.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	// Orphans and refills buffer, never with an empty store so binding it stays valid
+	template <typename T>
+	void upload(uint32_t buffer, const std::vector<T>& data)
+	{
+		static const T EMPTY{};
+
+		if (data.empty())
+		{
+			glNamedBufferData(buffer, sizeof(T), &EMPTY, GL_STREAM_DRAW);
+			return;
+		}
+
+		glNamedBufferData(buffer, sizeof(T) * data.size(), data.data(), GL_STREAM_DRAW);
+	}
+
+	uint16_t to_tile(float ndc, uint32_t tile_count)
+	{
+		const float tile = std::floor((ndc * 0.5f + 0.5f) * tile_count);
+		return static_cast<uint16_t>(std::clamp(tile, 0.0f, static_cast<float>(tile_count - 1)));
+	}
+}
+
+ClusteredLighting::ClusteredLighting()
+	: m_light_buffer(0), m_cluster_buffer(0), m_light_index_buffer(0), m_tile_size(1.0f), m_z_scale(0.0f), m_z_bias(0.0f), m_stats{}
+{
+	glCreateBuffers(1, &m_light_buffer);
+	glCreateBuffers(1, &m_cluster_buffer);
+	glCreateBuffers(1, &m_light_index_buffer);
+}
+
+ClusteredLighting::~ClusteredLighting()
+{
+	glDeleteBuffers(1, &m_light_buffer);
+	glDeleteBuffers(1, &m_cluster_buffer);
+	glDeleteBuffers(1, &m_light_index_buffer);
+}
+
+void ClusteredLighting::build(const std::vector<PointLight>& lights, const glm::mat4& view_mat, const glm::mat4& projection_mat, float near_plane, float far_plane,
+	uint32_t width, uint32_t height)
+{
+	m_stats = {};
+	m_stats.light_count = static_cast<uint32_t>(lights.size());
+
+	m_tile_size = glm::vec2(static_cast<float>(width) / CLUSTER_X, static_cast<float>(height) / CLUSTER_Y);
+
+	// slice = log(depth / near) / log(far / near) * CLUSTER_Z, as scale * log(depth) + bias
+	const float log_depth_range = std::log(far_plane / near_plane);
+	m_z_scale = CLUSTER_Z / log_depth_range;
+	m_z_bias = -(CLUSTER_Z * std::log(near_plane)) / log_depth_range;
+
+	transform_lights(lights, view_mat);
+
+	const float projection_x = projection_mat[0][0];
+	const float projection_y = projection_mat[1][1];
+
+	// cluster range of every light, and how many lights each cluster gets
+	m_light_clusters.clear();
+	m_cursors.assign(CLUSTER_COUNT, 0);
+
+	for (uint32_t i = 0; i < lights.size(); i++)
+	{
+		const float radius = lights[i].radius;
+		const float depth = -m_view_z[i];
+
+		const float min_depth = depth - radius;
+		const float max_depth = depth + radius;
+		if (max_depth <= near_plane || min_depth >= far_plane)
+		{
+			continue;
+		}
+
+		LightClusters clusters{};
+		clusters.light = i;
+		clusters.min_z = static_cast<uint16_t>(get_slice(std::max(min_depth, near_plane)));
+		clusters.max_z = static_cast<uint16_t>(get_slice(std::min(max_depth, far_plane)));
+
+		if (min_depth <= near_plane)
+		{
+			// the bounds reach behind the near plane, where the projection flips : keep the whole screen
+			clusters.min_x = 0;
+			clusters.max_x = CLUSTER_X - 1;
+			clusters.min_y = 0;
+			clusters.max_y = CLUSTER_Y - 1;
+		}
+		else
+		{
+			// the screen rect of the view space box around the light, whose extremes are at its corners
+			const float min_x = m_view_x[i] - radius;
+			const float max_x = m_view_x[i] + radius;
+			const float min_y = m_view_y[i] - radius;
+			const float max_y = m_view_y[i] + radius;
+
+			const float min_ndc_x = projection_x * std::min(min_x / min_depth, min_x / max_depth);
+			const float max_ndc_x = projection_x * std::max(max_x / min_depth, max_x / max_depth);
+			const float min_ndc_y = projection_y * std::min(min_y / min_depth, min_y / max_depth);
+			const float max_ndc_y = projection_y * std::max(max_y / min_depth, max_y / max_depth);
+
+			if (max_ndc_x < -1.0f || min_ndc_x > 1.0f || max_ndc_y < -1.0f || min_ndc_y > 1.0f)
+			{
+				continue;
+			}
+
+			clusters.min_x = to_tile(min_ndc_x, CLUSTER_X);
+			clusters.max_x = to_tile(max_ndc_x, CLUSTER_X);
+			clusters.min_y = to_tile(min_ndc_y, CLUSTER_Y);
+			clusters.max_y = to_tile(max_ndc_y, CLUSTER_Y);
+		}
+
+		for (uint32_t z = clusters.min_z; z <= clusters.max_z; z++)
+		{
+			for (uint32_t y = clusters.min_y; y <= clusters.max_y; y++)
+			{
+				for (uint32_t x = clusters.min_x; x <= clusters.max_x; x++)
+				{
+					m_cursors[x + CLUSTER_X * (y + CLUSTER_Y * z)]++;
+				}
+			}
+		}
+
+		m_light_clusters.push_back(clusters);
+	}
+
+	// prefix sum into ranges, then fill the lists in light order
+	m_clusters.resize(CLUSTER_COUNT);
+
+	uint32_t offset = 0;
+	for (uint32_t i = 0; i < CLUSTER_COUNT; i++)
+	{
+		m_clusters[i] = glm::uvec2(offset, m_cursors[i]);
+		m_stats.max_lights_per_cluster = std::max(m_stats.max_lights_per_cluster, m_cursors[i]);
+
+		offset += m_cursors[i];
+		m_cursors[i] = m_clusters[i].x;
+	}
+
+	m_light_indices.resize(offset);
+
+	for (const LightClusters& clusters : m_light_clusters)
+	{
+		for (uint32_t z = clusters.min_z; z <= clusters.max_z; z++)
+		{
+			for (uint32_t y = clusters.min_y; y <= clusters.max_y; y++)
+			{
+				for (uint32_t x = clusters.min_x; x <= clusters.max_x; x++)
+				{
+					m_light_indices[m_cursors[x + CLUSTER_X * (y + CLUSTER_Y * z)]++] = clusters.light;
+				}
+			}
+		}
+	}
+
+	m_stats.visible_light_count = static_cast<uint32_t>(m_light_clusters.size());
+	m_stats.light_index_count = offset;
+
+	upload(m_light_buffer, lights);
+	upload(m_cluster_buffer, m_clusters);
+	upload(m_light_index_buffer, m_light_indices);
+}
+
+void ClusteredLighting::bind() const
+{
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIGHT_BUFFER_BINDING, m_light_buffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTER_BUFFER_BINDING, m_cluster_buffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIGHT_INDEX_BUFFER_BINDING, m_light_index_buffer);
+}
+
+void ClusteredLighting::set_uniforms(Shader& shader) const
+{
+	shader.set_vec2f("cluster_tile_size", m_tile_size);
+	shader.set_float("cluster_z_scale", m_z_scale);
+	shader.set_float("cluster_z_bias", m_z_bias);
+}
+
+const ClusteredLightingStats& ClusteredLighting::get_stats() const
+{
+	return m_stats;
+}
+
+void ClusteredLighting::transform_lights(const std::vector<PointLight>& lights, const glm::mat4& view_mat)
+{
+	const size_t count = lights.size();
+
+	m_view_x.resize(count);
+	m_view_y.resize(count);
+	m_view_z.resize(count);
+
+	size_t scalar_begin = 0;
+
+#ifdef CLUSTER_SSE
+	// rows of the (column major) matrix, broadcast
+	__m128 row_x[4];
+	__m128 row_y[4];
+	__m128 row_z[4];
+
+	for (int column = 0; column < 4; column++)
+	{
+		row_x[column] = _mm_set1_ps(view_mat[column][0]);
+		row_y[column] = _mm_set1_ps(view_mat[column][1]);
+		row_z[column] = _mm_set1_ps(view_mat[column][2]);
+	}
+
+	const size_t simd_end = count & ~size_t(3);
+	for (size_t i = 0; i < simd_end; i += 4)
+	{
+		const __m128 x = _mm_set_ps(lights[i + 3].position.x, lights[i + 2].position.x, lights[i + 1].position.x, lights[i].position.x);
+		const __m128 y = _mm_set_ps(lights[i + 3].position.y, lights[i + 2].position.y, lights[i + 1].position.y, lights[i].position.y);
+		const __m128 z = _mm_set_ps(lights[i + 3].position.z, lights[i + 2].position.z, lights[i + 1].position.z, lights[i].position.z);
+
+		const __m128 view_x = _mm_add_ps(_mm_add_ps(_mm_mul_ps(row_x[0], x), _mm_mul_ps(row_x[1], y)), _mm_add_ps(_mm_mul_ps(row_x[2], z), row_x[3]));
+		const __m128 view_y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(row_y[0], x), _mm_mul_ps(row_y[1], y)), _mm_add_ps(_mm_mul_ps(row_y[2], z), row_y[3]));
+		const __m128 view_z = _mm_add_ps(_mm_add_ps(_mm_mul_ps(row_z[0], x), _mm_mul_ps(row_z[1], y)), _mm_add_ps(_mm_mul_ps(row_z[2], z), row_z[3]));
+
+		_mm_storeu_ps(&m_view_x[i], view_x);
+		_mm_storeu_ps(&m_view_y[i], view_y);
+		_mm_storeu_ps(&m_view_z[i], view_z);
+	}
+
+	scalar_begin = simd_end;
+#endif
+
+	for (size_t i = scalar_begin; i < count; i++)
+	{
+		const glm::vec4 view_position = view_mat * glm::vec4(lights[i].position, 1.0f);
+
+		m_view_x[i] = view_position.x;
+		m_view_y[i] = view_position.y;
+		m_view_z[i] = view_position.z;
+	}
+}
+
+uint32_t ClusteredLighting::get_slice(float depth) const
+{
+	const float slice = std::floor(std::log(depth) * m_z_scale + m_z_bias);
+	return static_cast<uint32_t>(std::clamp(slice, 0.0f, static_cast<float>(CLUSTER_Z - 1)));
+}
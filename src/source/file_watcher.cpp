@@ -0,0 +1,226 @@
+#include "../include/file_watcher.hpp"
+
+#include <iostream>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+FileWatcher::FileWatcher(const std::vector<std::string>& directories)
+	: m_directories(directories), m_stop(false), m_last_change(std::chrono::steady_clock::now())
+#ifdef __linux__
+	  , m_inotify(-1)
+#endif
+{
+#ifdef __linux__
+	m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (m_inotify >= 0)
+	{
+		for (const std::string& directory : m_directories)
+		{
+			add_watches(directory);
+		}
+
+		m_thread = std::thread(&FileWatcher::inotify_loop, this);
+		return;
+	}
+
+	std::cout << "inotify unavailable, polling for file changes every " << POLL_INTERVAL_MS << " ms\n";
+#endif
+
+	// the first scan only records the current write times
+	scan(false);
+	m_thread = std::thread(&FileWatcher::poll_loop, this);
+}
+
+FileWatcher::~FileWatcher()
+{
+	m_stop = true;
+
+	if (m_thread.joinable())
+	{
+		m_thread.join();
+	}
+
+#ifdef __linux__
+	if (m_inotify >= 0)
+	{
+		close(m_inotify);
+	}
+#endif
+}
+
+std::vector<std::string> FileWatcher::take_changes()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (m_changes.empty() || std::chrono::steady_clock::now() - m_last_change < std::chrono::milliseconds(SETTLE_MS))
+	{
+		return {};
+	}
+
+	std::vector<std::string> changes(m_changes.begin(), m_changes.end());
+	m_changes.clear();
+
+	return changes;
+}
+
+bool FileWatcher::is_using_inotify() const
+{
+#ifdef __linux__
+	return m_inotify >= 0;
+#else
+	return false;
+#endif
+}
+
+void FileWatcher::add_change(const std::filesystem::path& path)
+{
+	std::error_code error;
+	std::filesystem::path canonical_path = std::filesystem::weakly_canonical(path, error);
+	if (error)
+	{
+		canonical_path = path.lexically_normal();
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_changes.insert(canonical_path.generic_string());
+	m_last_change = std::chrono::steady_clock::now();
+}
+
+void FileWatcher::poll_loop()
+{
+	while (!m_stop)
+	{
+		// sleep in small steps so the destructor does not wait for a whole interval
+		for (uint32_t slept = 0; slept < POLL_INTERVAL_MS && !m_stop; slept += 50)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		}
+
+		scan(true);
+	}
+}
+
+void FileWatcher::scan(bool record_changes)
+{
+	for (const std::string& directory : m_directories)
+	{
+		std::error_code error;
+		std::filesystem::recursive_directory_iterator it(directory, error);
+		if (error)
+		{
+			continue;
+		}
+
+		for (; it != std::filesystem::recursive_directory_iterator(); it.increment(error))
+		{
+			if (error || !it->is_regular_file(error))
+			{
+				continue;
+			}
+
+			const std::filesystem::file_time_type write_time = it->last_write_time(error);
+			if (error)
+			{
+				continue;
+			}
+
+			auto [entry, inserted] = m_write_times.try_emplace(it->path().generic_string(), write_time);
+			if (!inserted && entry->second == write_time)
+			{
+				continue;
+			}
+
+			entry->second = write_time;
+
+			if (record_changes)
+			{
+				add_change(it->path());
+			}
+		}
+	}
+}
+
+#ifdef __linux__
+void FileWatcher::inotify_loop()
+{
+	alignas(inotify_event) char buffer[16 * 1024];
+
+	while (!m_stop)
+	{
+		// wake up regularly to notice m_stop
+		pollfd descriptor{ m_inotify, POLLIN, 0 };
+		if (poll(&descriptor, 1, 100) <= 0)
+		{
+			continue;
+		}
+
+		const ssize_t length = read(m_inotify, buffer, sizeof(buffer));
+		if (length <= 0)
+		{
+			continue;
+		}
+
+		for (ssize_t offset = 0; offset < length;)
+		{
+			const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+			offset += sizeof(inotify_event) + event->len;
+
+			auto it = m_watch_directories.find(event->wd);
+			if (it == m_watch_directories.end() || event->len == 0)
+			{
+				continue;
+			}
+
+			const std::filesystem::path path = it->second / event->name;
+
+			if (event->mask & IN_ISDIR)
+			{
+				// new directories are watched as well, their files show up through the new watch
+				if (event->mask & (IN_CREATE | IN_MOVED_TO))
+				{
+					add_watches(path);
+				}
+
+				continue;
+			}
+
+			// IN_CLOSE_WRITE rather than IN_MODIFY, so a file is reported once it is completely written
+			if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+			{
+				add_change(path);
+			}
+		}
+	}
+}
+
+void FileWatcher::add_watches(const std::filesystem::path& directory)
+{
+	const uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE;
+
+	int watch = inotify_add_watch(m_inotify, directory.c_str(), mask);
+	if (watch < 0)
+	{
+		std::cout << "Failed to watch directory : " << directory.generic_string() << '\n';
+		return;
+	}
+
+	m_watch_directories[watch] = directory;
+
+	std::error_code error;
+	for (std::filesystem::recursive_directory_iterator it(directory, error), end; !error && it != end; it.increment(error))
+	{
+		if (it->is_directory(error))
+		{
+			watch = inotify_add_watch(m_inotify, it->path().c_str(), mask);
+			if (watch >= 0)
+			{
+				m_watch_directories[watch] = it->path();
+			}
+		}
+	}
+}
+#endif
@@ -0,0 +1,215 @@
+#include "../include/frustum.hpp"
+
+#if defined(__SSE__) || defined(_M_X64) || defined(_M_IX86)
+#define FRUSTUM_SSE
+#include <xmmintrin.h>
+#endif
+
+#include <cmath>
+
+Frustum Frustum::from_matrix(const glm::mat4& view_projection)
+{
+	// rows of the (column major) matrix
+	glm::vec4 rows[4];
+	for (int i = 0; i < 4; i++)
+	{
+		rows[i] = glm::vec4(view_projection[0][i], view_projection[1][i], view_projection[2][i], view_projection[3][i]);
+	}
+
+	Frustum frustum{};
+	frustum.planes[0] = rows[3] + rows[0]; // left
+	frustum.planes[1] = rows[3] - rows[0]; // right
+	frustum.planes[2] = rows[3] + rows[1]; // bottom
+	frustum.planes[3] = rows[3] - rows[1]; // top
+	frustum.planes[4] = rows[3] + rows[2]; // near
+	frustum.planes[5] = rows[3] - rows[2]; // far
+
+	for (glm::vec4& plane : frustum.planes)
+	{
+		plane = plane / glm::length(glm::vec3(plane));
+	}
+
+	return frustum;
+}
+
+FrustumCuller::FrustumCuller()
+	: m_count(0)
+{
+}
+
+void FrustumCuller::clear()
+{
+	m_count = 0;
+
+	m_center_x.clear();
+	m_center_y.clear();
+	m_center_z.clear();
+	m_extent_x.clear();
+	m_extent_y.clear();
+	m_extent_z.clear();
+
+	m_sphere_x.clear();
+	m_sphere_y.clear();
+	m_sphere_z.clear();
+	m_sphere_radius.clear();
+
+	m_visible.clear();
+}
+
+uint32_t FrustumCuller::add(const Bounds& bounds, const BoundingSphere& sphere, const glm::mat4& transform)
+{
+	// box : transform the center, and take the extent through the absolute rotation / scale (Arvo)
+	const glm::vec3 center = (bounds.min + bounds.max) * 0.5f;
+	const glm::vec3 extent = (bounds.max - bounds.min) * 0.5f;
+
+	const glm::vec3 world_center = glm::vec3(transform * glm::vec4(center, 1.0f));
+	glm::vec3 world_extent(0.0f);
+	for (int i = 0; i < 3; i++)
+	{
+		world_extent[i] = glm::abs(transform[0][i]) * extent.x + glm::abs(transform[1][i]) * extent.y + glm::abs(transform[2][i]) * extent.z;
+	}
+
+	m_center_x.push_back(world_center.x);
+	m_center_y.push_back(world_center.y);
+	m_center_z.push_back(world_center.z);
+	m_extent_x.push_back(world_extent.x);
+	m_extent_y.push_back(world_extent.y);
+	m_extent_z.push_back(world_extent.z);
+
+	// sphere : scale the radius by the largest axis scale so it stays conservative under non uniform scale
+	const glm::vec3 world_sphere_center = glm::vec3(transform * glm::vec4(sphere.center, 1.0f));
+	const float max_scale = glm::max(glm::max(glm::length(glm::vec3(transform[0])), glm::length(glm::vec3(transform[1]))), glm::length(glm::vec3(transform[2])));
+
+	m_sphere_x.push_back(world_sphere_center.x);
+	m_sphere_y.push_back(world_sphere_center.y);
+	m_sphere_z.push_back(world_sphere_center.z);
+	m_sphere_radius.push_back(sphere.radius * max_scale);
+
+	m_visible.push_back(1);
+
+	return m_count++;
+}
+
+void FrustumCuller::cull(const Frustum& frustum)
+{
+	uint32_t scalar_begin = 0;
+
+#ifdef FRUSTUM_SSE
+	__m128 plane_x[6];
+	__m128 plane_y[6];
+	__m128 plane_z[6];
+	__m128 plane_w[6];
+	__m128 abs_plane_x[6];
+	__m128 abs_plane_y[6];
+	__m128 abs_plane_z[6];
+
+	for (int p = 0; p < 6; p++)
+	{
+		const glm::vec4& plane = frustum.planes[p];
+
+		plane_x[p] = _mm_set1_ps(plane.x);
+		plane_y[p] = _mm_set1_ps(plane.y);
+		plane_z[p] = _mm_set1_ps(plane.z);
+		plane_w[p] = _mm_set1_ps(plane.w);
+		abs_plane_x[p] = _mm_set1_ps(std::abs(plane.x));
+		abs_plane_y[p] = _mm_set1_ps(std::abs(plane.y));
+		abs_plane_z[p] = _mm_set1_ps(std::abs(plane.z));
+	}
+
+	const __m128 zero = _mm_setzero_ps();
+	const uint32_t simd_end = m_count & ~3u;
+
+	for (uint32_t i = 0; i < simd_end; i += 4)
+	{
+		const __m128 center_x = _mm_loadu_ps(&m_center_x[i]);
+		const __m128 center_y = _mm_loadu_ps(&m_center_y[i]);
+		const __m128 center_z = _mm_loadu_ps(&m_center_z[i]);
+		const __m128 extent_x = _mm_loadu_ps(&m_extent_x[i]);
+		const __m128 extent_y = _mm_loadu_ps(&m_extent_y[i]);
+		const __m128 extent_z = _mm_loadu_ps(&m_extent_z[i]);
+
+		const __m128 sphere_x = _mm_loadu_ps(&m_sphere_x[i]);
+		const __m128 sphere_y = _mm_loadu_ps(&m_sphere_y[i]);
+		const __m128 sphere_z = _mm_loadu_ps(&m_sphere_z[i]);
+		const __m128 sphere_radius = _mm_loadu_ps(&m_sphere_radius[i]);
+
+		__m128 outside = _mm_setzero_ps();
+
+		for (int p = 0; p < 6; p++)
+		{
+			// box : signed distance of the center plus the projected extent
+			__m128 box_distance = _mm_add_ps(_mm_mul_ps(plane_x[p], center_x), plane_w[p]);
+			box_distance = _mm_add_ps(box_distance, _mm_mul_ps(plane_y[p], center_y));
+			box_distance = _mm_add_ps(box_distance, _mm_mul_ps(plane_z[p], center_z));
+			box_distance = _mm_add_ps(box_distance, _mm_mul_ps(abs_plane_x[p], extent_x));
+			box_distance = _mm_add_ps(box_distance, _mm_mul_ps(abs_plane_y[p], extent_y));
+			box_distance = _mm_add_ps(box_distance, _mm_mul_ps(abs_plane_z[p], extent_z));
+
+			__m128 sphere_distance = _mm_add_ps(_mm_mul_ps(plane_x[p], sphere_x), plane_w[p]);
+			sphere_distance = _mm_add_ps(sphere_distance, _mm_mul_ps(plane_y[p], sphere_y));
+			sphere_distance = _mm_add_ps(sphere_distance, _mm_mul_ps(plane_z[p], sphere_z));
+			sphere_distance = _mm_add_ps(sphere_distance, sphere_radius);
+
+			outside = _mm_or_ps(outside, _mm_or_ps(_mm_cmplt_ps(box_distance, zero), _mm_cmplt_ps(sphere_distance, zero)));
+		}
+
+		const int outside_mask = _mm_movemask_ps(outside);
+		for (uint32_t lane = 0; lane < 4; lane++)
+		{
+			m_visible[i + lane] = (outside_mask >> lane) & 1 ? 0 : 1;
+		}
+	}
+
+	scalar_begin = simd_end;
+#endif
+
+	// the tail that does not fill a full register (or everything without SSE)
+	cull_scalar(frustum, scalar_begin, m_count);
+}
+
+bool FrustumCuller::is_visible(uint32_t index) const
+{
+	return m_visible[index] != 0;
+}
+
+uint32_t FrustumCuller::get_count() const
+{
+	return m_count;
+}
+
+glm::vec4 FrustumCuller::get_world_sphere(uint32_t index) const
+{
+	return glm::vec4(m_sphere_x[index], m_sphere_y[index], m_sphere_z[index], m_sphere_radius[index]);
+}
+
+Bounds FrustumCuller::get_world_bounds(uint32_t index) const
+{
+	const glm::vec3 center(m_center_x[index], m_center_y[index], m_center_z[index]);
+	const glm::vec3 extent(m_extent_x[index], m_extent_y[index], m_extent_z[index]);
+
+	return { center - extent, center + extent };
+}
+
+void FrustumCuller::cull_scalar(const Frustum& frustum, uint32_t begin, uint32_t end)
+{
+	for (uint32_t i = begin; i < end; i++)
+	{
+		bool outside = false;
+
+		for (const glm::vec4& plane : frustum.planes)
+		{
+			const float box_distance = plane.x * m_center_x[i] + plane.y * m_center_y[i] + plane.z * m_center_z[i] + plane.w +
+				std::abs(plane.x) * m_extent_x[i] + std::abs(plane.y) * m_extent_y[i] + std::abs(plane.z) * m_extent_z[i];
+
+			const float sphere_distance = plane.x * m_sphere_x[i] + plane.y * m_sphere_y[i] + plane.z * m_sphere_z[i] + plane.w + m_sphere_radius[i];
+
+			if (box_distance < 0.0f || sphere_distance < 0.0f)
+			{
+				outside = true;
+				break;
+			}
+		}
+
+		m_visible[i] = outside ? 0 : 1;
+	}
+}
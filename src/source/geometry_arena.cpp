@@ -0,0 +1,333 @@
+#include "../include/geometry_arena.hpp"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+
+static constexpr uint32_t INITIAL_VERTEX_CAPACITY = 256 * 1024;
+static constexpr uint32_t INITIAL_INDEX_CAPACITY = 1024 * 1024;
+
+GeometryArena& GeometryArena::get(VertexFormat format)
+{
+	switch (format)
+	{
+	case VertexFormat::Packed:
+	{
+		static GeometryArena packed_arena(sizeof(PackedVertex), PackedVertexPolicy::setup_attributes);
+		return packed_arena;
+	}
+	case VertexFormat::PackedQuantized:
+	{
+		static GeometryArena quantized_arena(sizeof(QuantizedVertex), QuantizedVertexPolicy::setup_attributes);
+		return quantized_arena;
+	}
+	default:
+	{
+		static GeometryArena full_arena(sizeof(Vertex), FullVertexPolicy::setup_attributes);
+		return full_arena;
+	}
+	}
+}
+
+GeometryArena::GeometryArena(uint32_t vertex_size, void (*setup_attributes)(uint32_t vao))
+	: m_vertex_size(vertex_size), m_vertex_capacity(0), m_index_capacity(0), m_vao(0), m_vbo(0), m_ebo(0)
+{
+	glCreateVertexArrays(1, &m_vao);
+	setup_attributes(m_vao);
+
+	create_buffers(INITIAL_VERTEX_CAPACITY, INITIAL_INDEX_CAPACITY);
+
+	m_free_vertices[0] = m_vertex_capacity;
+	m_free_indices[0] = m_index_capacity;
+}
+
+uint32_t GeometryArena::allocate(const void* vertices, uint32_t vertex_count, const uint32_t* indices, uint32_t index_count)
+{
+	Allocation allocation{};
+	allocation.vertex_count = vertex_count;
+	allocation.index_count = index_count;
+	allocation.live = true;
+
+	if (!allocate_range(m_free_vertices, vertex_count, allocation.vertex_offset))
+	{
+		grow(m_vertex_capacity + vertex_count, m_index_capacity);
+		allocate_range(m_free_vertices, vertex_count, allocation.vertex_offset);
+	}
+
+	if (!allocate_range(m_free_indices, index_count, allocation.index_offset))
+	{
+		grow(m_vertex_capacity, m_index_capacity + index_count);
+		allocate_range(m_free_indices, index_count, allocation.index_offset);
+	}
+
+	glNamedBufferSubData(m_vbo, m_vertex_size * allocation.vertex_offset, m_vertex_size * vertex_count, vertices);
+	glNamedBufferSubData(m_ebo, sizeof(uint32_t) * allocation.index_offset, sizeof(uint32_t) * index_count, indices);
+
+	uint32_t handle;
+	if (!m_free_handles.empty())
+	{
+		handle = m_free_handles.back();
+		m_free_handles.pop_back();
+		m_allocations[handle] = allocation;
+	}
+	else
+	{
+		handle = static_cast<uint32_t>(m_allocations.size());
+		m_allocations.push_back(allocation);
+	}
+
+	return handle;
+}
+
+void GeometryArena::free(uint32_t handle)
+{
+	if (handle >= m_allocations.size() || !m_allocations[handle].live)
+	{
+		return;
+	}
+
+	Allocation& allocation = m_allocations[handle];
+	free_range(m_free_vertices, allocation.vertex_offset, allocation.vertex_count);
+	free_range(m_free_indices, allocation.index_offset, allocation.index_count);
+
+	allocation.live = false;
+	m_free_handles.push_back(handle);
+}
+
+void GeometryArena::compact()
+{
+	const uint32_t old_vbo = m_vbo;
+	const uint32_t old_ebo = m_ebo;
+
+	create_buffers(m_vertex_capacity, m_index_capacity);
+
+	// pack allocations in their current order, copying into fresh buffers since the ranges may overlap in place
+	std::vector<uint32_t> handles;
+	for (uint32_t i = 0; i < m_allocations.size(); i++)
+	{
+		if (m_allocations[i].live)
+		{
+			handles.push_back(i);
+		}
+	}
+
+	std::sort(handles.begin(), handles.end(), [&](uint32_t a, uint32_t b)
+	{
+		return m_allocations[a].vertex_offset < m_allocations[b].vertex_offset;
+	});
+
+	uint32_t vertex_offset = 0;
+	uint32_t index_offset = 0;
+
+	for (uint32_t handle : handles)
+	{
+		Allocation& allocation = m_allocations[handle];
+
+		glCopyNamedBufferSubData(old_vbo, m_vbo, m_vertex_size * allocation.vertex_offset, m_vertex_size * vertex_offset, m_vertex_size * allocation.vertex_count);
+		glCopyNamedBufferSubData(old_ebo, m_ebo, sizeof(uint32_t) * allocation.index_offset, sizeof(uint32_t) * index_offset, sizeof(uint32_t) * allocation.index_count);
+
+		// indices are relative to the base vertex, so they move without being rewritten
+		allocation.vertex_offset = vertex_offset;
+		allocation.index_offset = index_offset;
+
+		vertex_offset += allocation.vertex_count;
+		index_offset += allocation.index_count;
+	}
+
+	glDeleteBuffers(1, &old_vbo);
+	glDeleteBuffers(1, &old_ebo);
+
+	m_free_vertices.clear();
+	m_free_indices.clear();
+
+	if (vertex_offset < m_vertex_capacity)
+	{
+		m_free_vertices[vertex_offset] = m_vertex_capacity - vertex_offset;
+	}
+
+	if (index_offset < m_index_capacity)
+	{
+		m_free_indices[index_offset] = m_index_capacity - index_offset;
+	}
+}
+
+void GeometryArena::compact_if_fragmented(float threshold)
+{
+	const GeometryArenaStats stats = get_stats();
+
+	// free space that is not part of the tail range is wasted until compaction
+	uint32_t vertex_holes = m_vertex_capacity - stats.vertices_used;
+	if (!m_free_vertices.empty())
+	{
+		auto tail = std::prev(m_free_vertices.end());
+		if (tail->first + tail->second == m_vertex_capacity)
+		{
+			vertex_holes -= tail->second;
+		}
+	}
+
+	uint32_t index_holes = m_index_capacity - stats.indices_used;
+	if (!m_free_indices.empty())
+	{
+		auto tail = std::prev(m_free_indices.end());
+		if (tail->first + tail->second == m_index_capacity)
+		{
+			index_holes -= tail->second;
+		}
+	}
+
+	if (vertex_holes > stats.vertices_used * threshold || index_holes > stats.indices_used * threshold)
+	{
+		compact();
+	}
+}
+
+uint32_t GeometryArena::get_base_vertex(uint32_t handle) const
+{
+	return m_allocations[handle].vertex_offset;
+}
+
+uint32_t GeometryArena::get_first_index(uint32_t handle) const
+{
+	return m_allocations[handle].index_offset;
+}
+
+uint32_t GeometryArena::get_index_count(uint32_t handle) const
+{
+	return m_allocations[handle].index_count;
+}
+
+uint32_t GeometryArena::get_vao() const
+{
+	return m_vao;
+}
+
+GeometryArenaStats GeometryArena::get_stats() const
+{
+	GeometryArenaStats stats{};
+	stats.allocation_count = static_cast<uint32_t>(m_allocations.size() - m_free_handles.size());
+	stats.vertex_capacity = m_vertex_capacity;
+	stats.index_capacity = m_index_capacity;
+	stats.vertices_used = m_vertex_capacity;
+	stats.indices_used = m_index_capacity;
+
+	for (const auto& [offset, count] : m_free_vertices)
+	{
+		stats.vertices_used -= count;
+	}
+
+	for (const auto& [offset, count] : m_free_indices)
+	{
+		stats.indices_used -= count;
+	}
+
+	return stats;
+}
+
+void GeometryArena::create_buffers(uint32_t vertex_capacity, uint32_t index_capacity)
+{
+	glCreateBuffers(1, &m_vbo);
+	glNamedBufferData(m_vbo, m_vertex_size * vertex_capacity, nullptr, GL_STATIC_DRAW);
+
+	glCreateBuffers(1, &m_ebo);
+	glNamedBufferData(m_ebo, sizeof(uint32_t) * index_capacity, nullptr, GL_STATIC_DRAW);
+
+	glVertexArrayVertexBuffer(m_vao, 0, m_vbo, 0, m_vertex_size);
+	glVertexArrayElementBuffer(m_vao, m_ebo);
+
+	m_vertex_capacity = vertex_capacity;
+	m_index_capacity = index_capacity;
+}
+
+void GeometryArena::grow(uint32_t min_vertex_capacity, uint32_t min_index_capacity)
+{
+	const uint32_t old_vbo = m_vbo;
+	const uint32_t old_ebo = m_ebo;
+	const uint32_t old_vertex_capacity = m_vertex_capacity;
+	const uint32_t old_index_capacity = m_index_capacity;
+
+	uint32_t vertex_capacity = old_vertex_capacity;
+	while (vertex_capacity < min_vertex_capacity)
+	{
+		vertex_capacity *= 2;
+	}
+
+	uint32_t index_capacity = old_index_capacity;
+	while (index_capacity < min_index_capacity)
+	{
+		index_capacity *= 2;
+	}
+
+	create_buffers(vertex_capacity, index_capacity);
+
+	glCopyNamedBufferSubData(old_vbo, m_vbo, 0, 0, m_vertex_size * old_vertex_capacity);
+	glCopyNamedBufferSubData(old_ebo, m_ebo, 0, 0, sizeof(uint32_t) * old_index_capacity);
+
+	glDeleteBuffers(1, &old_vbo);
+	glDeleteBuffers(1, &old_ebo);
+
+	if (vertex_capacity > old_vertex_capacity)
+	{
+		free_range(m_free_vertices, old_vertex_capacity, vertex_capacity - old_vertex_capacity);
+	}
+
+	if (index_capacity > old_index_capacity)
+	{
+		free_range(m_free_indices, old_index_capacity, index_capacity - old_index_capacity);
+	}
+}
+
+bool GeometryArena::allocate_range(std::map<uint32_t, uint32_t>& free_ranges, uint32_t count, uint32_t& offset)
+{
+	// first fit
+	for (auto it = free_ranges.begin(); it != free_ranges.end(); ++it)
+	{
+		if (it->second < count)
+		{
+			continue;
+		}
+
+		offset = it->first;
+
+		const uint32_t remaining = it->second - count;
+		free_ranges.erase(it);
+
+		if (remaining > 0)
+		{
+			free_ranges[offset + count] = remaining;
+		}
+
+		return true;
+	}
+
+	return false;
+}
+
+void GeometryArena::free_range(std::map<uint32_t, uint32_t>& free_ranges, uint32_t offset, uint32_t count)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	auto it = free_ranges.emplace(offset, count).first;
+
+	// merge with the following range
+	auto next = std::next(it);
+	if (next != free_ranges.end() && it->first + it->second == next->first)
+	{
+		it->second += next->second;
+		free_ranges.erase(next);
+	}
+
+	// merge with the preceding range
+	if (it != free_ranges.begin())
+	{
+		auto previous = std::prev(it);
+		if (previous->first + previous->second == it->first)
+		{
+			previous->second += it->second;
+			free_ranges.erase(it);
+		}
+	}
+}
@@ -0,0 +1,54 @@
+#include "../include/gpu_counter.hpp"
+
+#include <glad/glad.h>
+
+GpuCounter::GpuCounter(uint32_t target)
+	: m_target(target), m_pending{}, m_current(0), m_value(0)
+{
+	glCreateQueries(m_target, QUERY_COUNT, m_queries);
+}
+
+GpuCounter::~GpuCounter()
+{
+	glDeleteQueries(QUERY_COUNT, m_queries);
+}
+
+void GpuCounter::begin()
+{
+	// collect every finished query, oldest first so m_value ends up with the newest result
+	for (uint32_t i = 0; i < QUERY_COUNT; i++)
+	{
+		const uint32_t index = (m_current + i) % QUERY_COUNT;
+		if (!m_pending[index])
+		{
+			continue;
+		}
+
+		int32_t available = 0;
+		glGetQueryObjectiv(m_queries[index], GL_QUERY_RESULT_AVAILABLE, &available);
+
+		// the query about to be reused has to be read even if that means waiting
+		if (!available && index != m_current)
+		{
+			continue;
+		}
+
+		glGetQueryObjectui64v(m_queries[index], GL_QUERY_RESULT, &m_value);
+		m_pending[index] = false;
+	}
+
+	glBeginQuery(m_target, m_queries[m_current]);
+}
+
+void GpuCounter::end()
+{
+	glEndQuery(m_target);
+
+	m_pending[m_current] = true;
+	m_current = (m_current + 1) % QUERY_COUNT;
+}
+
+uint64_t GpuCounter::get_value() const
+{
+	return m_value;
+}
@@ -0,0 +1,24 @@
+#include "../include/gpu_timer.hpp"
+
+#include <glad/glad.h>
+
+GpuTimer::GpuTimer()
+	: m_counter(GL_TIME_ELAPSED)
+{
+}
+
+void GpuTimer::begin()
+{
+	m_counter.begin();
+}
+
+void GpuTimer::end()
+{
+	m_counter.end();
+}
+
+float GpuTimer::get_ms() const
+{
+	// the query counts nanoseconds
+	return static_cast<float>(m_counter.get_value() * 1e-6);
+}
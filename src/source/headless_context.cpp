@@ -0,0 +1,140 @@
+#include "../include/headless_context.hpp"
+
+#include <glad/glad.h>
+
+#ifdef GLENGINE_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#include <iostream>
+
+#ifdef GLENGINE_EGL
+
+HeadlessContext::HeadlessContext()
+	: m_display(nullptr), m_context(nullptr), m_valid(false)
+{
+	// the surfaceless platform needs no X / Wayland server, the default display is the fallback for other drivers
+	EGLDisplay display = EGL_NO_DISPLAY;
+
+	auto get_platform_display = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+	if (get_platform_display)
+	{
+		display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+	}
+
+	if (display == EGL_NO_DISPLAY)
+	{
+		display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	}
+
+	EGLint major = 0;
+	EGLint minor = 0;
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor))
+	{
+		std::cout << "Failed to initialize EGL\n";
+		return;
+	}
+
+	m_display = display;
+
+	if (!eglBindAPI(EGL_OPENGL_API))
+	{
+		std::cout << "EGL has no desktop OpenGL\n";
+		return;
+	}
+
+	const EGLint config_attributes[] =
+	{
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_NONE
+	};
+
+	EGLConfig config = nullptr;
+	EGLint config_count = 0;
+	if (!eglChooseConfig(display, config_attributes, &config, 1, &config_count) || config_count == 0)
+	{
+		std::cout << "No EGL config for desktop OpenGL\n";
+		return;
+	}
+
+	// 4.6 like the windowed context, llvmpipe on older Mesa only goes up to 4.5
+	EGLContext context = EGL_NO_CONTEXT;
+	for (EGLint context_minor : { 6, 5 })
+	{
+		const EGLint context_attributes[] =
+		{
+			EGL_CONTEXT_MAJOR_VERSION, 4,
+			EGL_CONTEXT_MINOR_VERSION, context_minor,
+			EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+			EGL_NONE
+		};
+
+		context = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attributes);
+		if (context != EGL_NO_CONTEXT)
+		{
+			break;
+		}
+	}
+
+	if (context == EGL_NO_CONTEXT)
+	{
+		std::cout << "Failed to create an OpenGL 4.5+ EGL context\n";
+		return;
+	}
+
+	m_context = context;
+
+	// no surface at all (EGL_KHR_surfaceless_context)
+	if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+	{
+		std::cout << "Failed to make the EGL context current without a surface\n";
+		return;
+	}
+
+	if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(eglGetProcAddress)))
+	{
+		std::cout << "Failed to initialize GLAD";
+		return;
+	}
+
+	std::cout << "Headless context : " << glGetString(GL_RENDERER) << ", " << glGetString(GL_VERSION) << "\n";
+	m_valid = true;
+}
+
+HeadlessContext::~HeadlessContext()
+{
+	if (!m_display)
+	{
+		return;
+	}
+
+	eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+
+	if (m_context)
+	{
+		eglDestroyContext(m_display, m_context);
+	}
+
+	eglTerminate(m_display);
+}
+
+#else
+
+HeadlessContext::HeadlessContext()
+	: m_display(nullptr), m_context(nullptr), m_valid(false)
+{
+	std::cout << "Headless mode needs EGL, which this build was made without\n";
+}
+
+HeadlessContext::~HeadlessContext()
+{
+}
+
+#endif
+
+bool HeadlessContext::is_valid() const
+{
+	return m_valid;
+}
@@ -0,0 +1,154 @@
+#include "../include/hot_reload.hpp"
+#include "../include/asset_cache.hpp"
+#include "../include/shader.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <iostream>
+#include <set>
+
+namespace
+{
+	std::string get_extension(const std::string& path)
+	{
+		std::string extension = std::filesystem::path(path).extension().string();
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+		return extension;
+	}
+}
+
+HotReload& HotReload::get()
+{
+	static HotReload hot_reload;
+	return hot_reload;
+}
+
+HotReload::HotReload()
+	: m_stats{}
+{
+}
+
+void HotReload::start(const std::vector<std::string>& directories)
+{
+	m_watcher = std::make_unique<FileWatcher>(directories);
+}
+
+void HotReload::stop()
+{
+	m_watcher.reset();
+}
+
+bool HotReload::is_running() const
+{
+	return m_watcher != nullptr;
+}
+
+void HotReload::register_shader(Shader* shader)
+{
+	m_shaders.push_back(shader);
+}
+
+void HotReload::unregister_shader(Shader* shader)
+{
+	m_shaders.erase(std::remove(m_shaders.begin(), m_shaders.end(), shader), m_shaders.end());
+}
+
+void HotReload::apply()
+{
+	if (!m_watcher)
+	{
+		return;
+	}
+
+	const std::vector<std::string> changes = m_watcher->take_changes();
+	if (changes.empty())
+	{
+		return;
+	}
+
+	std::vector<Shader*> changed_shaders;
+	std::set<std::string> model_directories;
+
+	for (const std::string& path : changes)
+	{
+		if (is_generated(path))
+		{
+			continue;
+		}
+
+		if (is_image(path))
+		{
+			if (AssetCache::get().reload_texture(path))
+			{
+				std::cout << "Reloading texture " << path << '\n';
+				m_stats.texture_reloads++;
+			}
+
+			continue;
+		}
+
+		bool used_by_shader = false;
+		for (Shader* shader : m_shaders)
+		{
+			const std::vector<std::string>& source_files = shader->get_source_files();
+			const bool uses_file = std::any_of(source_files.begin(), source_files.end(), [&](const std::string& source_file)
+			{
+				return AssetCache::get_canonical_path(source_file) == path;
+			});
+
+			if (uses_file)
+			{
+				used_by_shader = true;
+
+				if (std::find(changed_shaders.begin(), changed_shaders.end(), shader) == changed_shaders.end())
+				{
+					changed_shaders.push_back(shader);
+				}
+			}
+		}
+
+		// anything else is assumed to be part of a model (.gltf, .bin, .obj, ...), each directory is reloaded once
+		// per batch even if several of its files changed
+		if (!used_by_shader && model_directories.insert(std::filesystem::path(path).parent_path().generic_string()).second)
+		{
+			const uint32_t reloaded = AssetCache::get().reload_models(path);
+			if (reloaded > 0)
+			{
+				std::cout << "Reloaded " << reloaded << " model(s) for " << path << '\n';
+				m_stats.model_reloads += reloaded;
+			}
+		}
+	}
+
+	for (Shader* shader : changed_shaders)
+	{
+		if (shader->reload())
+		{
+			m_stats.shader_reloads++;
+		}
+		else
+		{
+			std::cout << "Shader reload failed, keeping the previous program\n";
+			m_stats.shader_failures++;
+		}
+	}
+}
+
+const HotReloadStats& HotReload::get_stats() const
+{
+	return m_stats;
+}
+
+bool HotReload::is_image(const std::string& path)
+{
+	const std::string extension = get_extension(path);
+	return extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".tga" || extension == ".bmp" || extension == ".hdr";
+}
+
+bool HotReload::is_generated(const std::string& path)
+{
+	const std::string extension = get_extension(path);
+	return extension == ".meshcache" || extension == ".tmp" || extension == ".glprogram";
+}
@@ -0,0 +1,45 @@
+#include "../include/image_compare.hpp"
+
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+ImageDifference compare_rgba8(const uint8_t* image, const uint8_t* reference, size_t pixel_count)
+{
+	ImageDifference difference{};
+	if (pixel_count == 0)
+	{
+		difference.psnr = std::numeric_limits<float>::infinity();
+		return difference;
+	}
+
+	uint64_t error_sum = 0;
+	uint64_t squared_error_sum = 0;
+	size_t differing_pixels = 0;
+
+	for (size_t i = 0; i < pixel_count; i++)
+	{
+		uint32_t pixel_error = 0;
+
+		for (size_t channel = 0; channel < 3; channel++)
+		{
+			const uint32_t error = static_cast<uint32_t>(std::abs(image[i * 4 + channel] - reference[i * 4 + channel]));
+
+			error_sum += error;
+			squared_error_sum += error * error;
+			pixel_error = error > pixel_error ? error : pixel_error;
+		}
+
+		difference.max_error = pixel_error > difference.max_error ? pixel_error : difference.max_error;
+		differing_pixels += pixel_error > 1 ? 1 : 0;
+	}
+
+	const double sample_count = static_cast<double>(pixel_count) * 3.0;
+	const double mean_squared_error = squared_error_sum / sample_count;
+
+	difference.mean_error = static_cast<float>(error_sum / sample_count);
+	difference.psnr = mean_squared_error > 0.0 ? static_cast<float>(10.0 * std::log10(255.0 * 255.0 / mean_squared_error)) : std::numeric_limits<float>::infinity();
+	difference.differing_ratio = static_cast<float>(differing_pixels / static_cast<double>(pixel_count));
+
+	return difference;
+}
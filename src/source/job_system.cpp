@@ -0,0 +1,117 @@
+#include "../include/job_system.hpp"
+
+#include <algorithm>
+
+JobSystem& JobSystem::get()
+{
+	static JobSystem job_system;
+	return job_system;
+}
+
+JobSystem::JobSystem()
+	: m_stop(false)
+{
+	// the calling thread helps while it waits, so one core is left to it, and a quarter of the cores to the texture
+	// decode workers streaming in the background
+	const uint32_t core_count = std::max(2u, std::thread::hardware_concurrency());
+	const uint32_t worker_count = std::max(1u, core_count - std::max(1u, core_count / 4) - 1);
+	for (uint32_t i = 0; i < worker_count; i++)
+	{
+		m_workers.emplace_back(&JobSystem::worker_loop, this);
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+
+	m_job_cv.notify_all();
+
+	for (std::thread& worker : m_workers)
+	{
+		if (worker.joinable())
+		{
+			worker.join();
+		}
+	}
+}
+
+void JobSystem::submit(std::function<void()> job, JobCounter& counter)
+{
+	counter.pending++;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_jobs.push_back({ std::move(job), &counter });
+	}
+
+	m_job_cv.notify_one();
+}
+
+void JobSystem::wait(JobCounter& counter)
+{
+	while (counter.pending > 0)
+	{
+		if (run_one())
+		{
+			continue;
+		}
+
+		// nothing left to help with, the last jobs are running on the workers
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_done_cv.wait(lock, [&]() { return counter.pending == 0 || !m_jobs.empty(); });
+	}
+}
+
+uint32_t JobSystem::get_thread_count() const
+{
+	return static_cast<uint32_t>(m_workers.size()) + 1;
+}
+
+void JobSystem::worker_loop()
+{
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_job_cv.wait(lock, [&]() { return m_stop || !m_jobs.empty(); });
+
+			if (m_stop)
+			{
+				return;
+			}
+		}
+
+		run_one();
+	}
+}
+
+bool JobSystem::run_one()
+{
+	Job job;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_jobs.empty())
+		{
+			return false;
+		}
+
+		job = std::move(m_jobs.front());
+		m_jobs.pop_front();
+	}
+
+	job.fn();
+
+	{
+		// under the lock, so a waiter can not miss the notification between its check and its wait
+		std::lock_guard<std::mutex> lock(m_mutex);
+		job.counter->pending--;
+	}
+
+	m_done_cv.notify_all();
+
+	return true;
+}
@@ -5,13 +5,27 @@
 
 #include <stb_image.h>
 
+#include <algorithm>
 #include <iostream>
 #include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <string>
 
 #include "../include/ui_manager.hpp"
-#include "../include/shader.hpp"
 #include "../include/camera.hpp"
+#include "../include/camera_path.hpp"
 #include "../include/model.hpp"
+#include "../include/texture_loader.hpp"
+#include "../include/asset_cache.hpp"
+#include "../include/program_cache.hpp"
+#include "../include/hot_reload.hpp"
+#include "../include/renderer.hpp"
+#include "../include/profiler.hpp"
+#include "../include/headless_context.hpp"
+#include "../include/capture_target.hpp"
 
 static constexpr int SCREEN_WIDTH = 1920;
 static constexpr int SCREEN_HEIGHT = 1080;
@@ -28,258 +42,454 @@ static bool g_first_mouse = true;
 static bool g_use_mouse = true;
 Camera g_camera = Camera();
 
+// camera path recording for GLEngine_bench, toggled from the Scene Control window
+static constexpr float RECORD_INTERVAL = 0.1f;
+static constexpr const char* RECORD_PATH = "camera_path.json";
+
+static CameraPath g_recorded_path;
+static bool g_recording = false;
+static float g_recording_time = 0.0f;
+static float g_last_keyframe_time = 0.0f;
+
+// Headless run : GLEngine --headless [--frames N] [--size WxH] [--delta seconds] [--camera path.json] [--output dir]
+// [--occlusion off|gpu|cpu] [--objects N]
+struct HeadlessOptions
+{
+	HeadlessOptions();
+
+	uint32_t frame_count;
+	uint32_t width;
+	uint32_t height;
+
+	// fixed time step, so the same frame always sees the same camera
+	float delta_time;
+
+	// camera path to follow, one orbit around the atrium over the run without one
+	std::string camera_path;
+	std::string output_directory;
+
+	// the software rasterized culling by default, compute can be slow on software GL
+	OcclusionMode occlusion;
+
+	// cube entities scattered over the scene
+	int object_count;
+};
+
 GLFWwindow* create_window(const char *window_title, int width, int height);
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void process_input(GLFWwindow* window);
 void process_mouse(GLFWwindow* window, double xpos, double ypos);
 void process_scroll(GLFWwindow* window, double xoffset, double yoffset);
 
-struct OffscreenRT
+bool parse_headless_options(int argc, char** argv, HeadlessOptions& options);
+int run_headless(const HeadlessOptions& options);
+void draw_scene_ui(Renderer& renderer);
+void record_camera();
+
+int main(int argc, char** argv)
 {
-	OffscreenRT();
+	// Cook mode : GLEngine --cook <model paths...> builds the mesh caches offline, without opening a window
+	if (argc > 1 && std::strcmp(argv[1], "--cook") == 0)
+	{
+		int result = 0;
+		for (int i = 2; i < argc; i++)
+		{
+			if (!Model::cook(argv[i]))
+			{
+				result = -1;
+			}
+		}
 
-	uint32_t fbo;
-	uint32_t color_attachments[2];
-	uint32_t depth_attachment;
+		return result;
+	}
 
-	uint32_t vao;
-	uint32_t vbo;
-};
+	if (argc > 1 && std::strcmp(argv[1], "--headless") == 0)
+	{
+		HeadlessOptions options;
+		if (!parse_headless_options(argc, argv, options))
+		{
+			return -1;
+		}
 
-struct GameObject
-{
-	std::unique_ptr<Model> model;
-	glm::mat4 transform_mat{};
-};
+		return run_headless(options);
+	}
 
-int main()
-{
 	GLFWwindow* window = create_window("GLEngine", SCREEN_WIDTH, SCREEN_HEIGHT);
-	UIManager ui_manager(window);
 
-	// Frame buffers for applying gaussian blur on bloom image (horizontal and vertical)
-	uint32_t bloom_fbo[2];
-	uint32_t bloom_buffer[2];
+	// scoped so every GL object (and the ImGui backend) is released while the context is still alive
+	{
+		UIManager ui_manager(window);
+
+		Renderer renderer(SCREEN_WIDTH, SCREEN_HEIGHT);
 
-	glGenFramebuffers(2, bloom_fbo);
-	glGenTextures(2, bloom_buffer);
+		// edits to shaders, textures and models are picked up while running
+		HotReload::get().start({ "../shaders", "../assets" });
 
-	for (int i = 0; i < 2; i++)
-	{
-		glBindFramebuffer(GL_FRAMEBUFFER, bloom_fbo[i]);
-		glBindTexture(GL_TEXTURE_2D, bloom_buffer[i]);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, SCREEN_WIDTH, SCREEN_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
-
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, bloom_buffer[i], 0);
-	
-		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		while (!glfwWindowShouldClose(window))
 		{
-			std::cout << "Bloom framebuffer not complete!";
-		}
-	}
+			g_current_frame_time = g_clock.now();
+			g_delta_time = static_cast<float>((g_current_frame_time - g_previous_frame_time).count() * 1e-9);
+			g_previous_frame_time = g_current_frame_time;
+
+			Profiler::get().begin_frame();
+			const uint32_t update_scope = Profiler::get().begin_scope("update", false);
+
+			glfwPollEvents();
+			process_input(window);
+			record_camera();
+
+			// swap in rebuilt shaders / assets before anything of this frame uses them
+			HotReload::get().apply();
 
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-	// Frame resources
-	GameObject sponza;
-	sponza.model = std::make_unique<Model>("../assets/models/sponza/glTF/Sponza.gltf");
-	sponza.transform_mat = glm::mat4(1.0f);
+			TextureLoader::get().upload_pending();
+
+			// every target follows the window size, nothing to draw while minimized
+			int width = 0;
+			int height = 0;
+			glfwGetFramebufferSize(window, &width, &height);
+
+			if (width == 0 || height == 0)
+			{
+				Profiler::get().end_scope(update_scope);
+				Profiler::get().end_frame();
+				continue;
+			}
 
-	GameObject light_source;
-	light_source.model = std::make_unique<Model>("../assets/models/cube/Cube.gltf");
-	light_source.transform_mat = glm::mat4(1.0f);
+			{
+				ImGui_ImplOpenGL3_NewFrame();
+				ImGui_ImplGlfw_NewFrame();
+				ImGui::NewFrame();
 
-	GameObject cube;
-	cube.model = std::make_unique<Model>("../assets/models/cube/Cube.gltf");
-	cube.transform_mat = glm::mat4(1.0f);
+				draw_scene_ui(renderer);
+				ui_manager.draw_profiler();
 
-	Shader light_shader("../shaders/light_vertex.glsl", "../shaders/light_fragment.glsl");
-	Shader shader("../shaders/test_vertex.glsl", "../shaders/test_fragment.glsl");
-	Shader offscreen_fb_shader("../shaders/offscreen_vertex.glsl", "../shaders/offscreen_fragment.glsl");
-	Shader blur_shader("../shaders/offscreen_vertex.glsl", "../shaders/gaussian_blur_fragment.glsl");
+				ImGui::Render();
+			}
 
-	OffscreenRT offscreen_rt{};
+			Profiler::get().end_scope(update_scope);
 
-	glm::mat4 view_mat = g_camera.get_view_mat();
-	glm::mat4 projection_mat = glm::perspective(glm::radians(45.0f), SCREEN_WIDTH / (float)SCREEN_HEIGHT, 0.1f, 1000.0f);
+			renderer.set_time(static_cast<float>(glfwGetTime()));
+			renderer.render_frame(g_camera, width, height, 0, [&]() { ui_manager.present(); });
 
-	glm::vec3 light_position = glm::vec3(0.0f, 10.0f, 0.0f);
-	glm::vec3 light_color = glm::vec3(1.0f);
-	float height_scale = 0.01f;
+			{
+				ProfileScope scope("swap", false);
+				glfwSwapBuffers(window);
+			}
 
-	ImVec4 clear_color = ImVec4(0.1f, 0.6f, 0.8f, 1.0f);
+			Profiler::get().end_frame();
+		}
 
-	glm::vec3 cube_position = glm::vec3(0.0f, 10.0f, 1.0f);
-	glm::vec3 cube_scale = glm::vec3(1.0f);
-	glm::vec3 cube_color = glm::vec3(1.0f);
+		HotReload::get().stop();
+	}
 
-	float exposure = 1.0f;
-	float bloom_intensity = 0.0f;
-	float light_intensity = 1.0f;
+	TextureLoader::get().shutdown();
 
-	bool horizontal = true;
-	bool first_iteration = true;
-	int amount = 100;
-	float spread = 0.0f;
+	glfwTerminate();
+	return 0;
+}
 
+HeadlessOptions::HeadlessOptions()
+	: frame_count(60), width(SCREEN_WIDTH), height(SCREEN_HEIGHT), delta_time(1.0f / 60.0f), output_directory("frames"), occlusion(OcclusionMode::Cpu),
+	  object_count(0)
+{
+}
 
-	while (!glfwWindowShouldClose(window))
+bool parse_headless_options(int argc, char** argv, HeadlessOptions& options)
+{
+	for (int i = 2; i < argc; i++)
 	{
-		g_current_frame_time = g_clock.now();
-		g_delta_time = static_cast<float>((g_current_frame_time - g_previous_frame_time).count() * 1e-9);
-		g_previous_frame_time = g_current_frame_time;
-
-		glfwPollEvents();
-		process_input(window);
-		
-		glBindFramebuffer(GL_FRAMEBUFFER, offscreen_rt.fbo);
-
-		glEnable(GL_FRAMEBUFFER_SRGB);
-		glEnable(GL_DEPTH_TEST);
-		glDepthFunc(GL_LESS);
-		glEnable(GL_BLEND);
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-		glEnable(GL_CULL_FACE);
-		glCullFace(GL_BACK);
-		glClearColor(clear_color.x * clear_color.w, clear_color.y * clear_color.w, clear_color.z * clear_color.w, clear_color.w);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		const bool has_value = i + 1 < argc;
 
+		if (std::strcmp(argv[i], "--frames") == 0 && has_value)
 		{
-			ImGui_ImplOpenGL3_NewFrame();
-			ImGui_ImplGlfw_NewFrame();
-			ImGui::NewFrame();
-
-			ImGui::Begin("Scene Control");
-			ImGui::ColorEdit3("clear_color", (float*)&clear_color);
-			ImGui::SliderFloat("camera_speed", &g_camera.m_movement_speed, 0.0f, 1000.0f);
-			ImGui::SliderFloat("height_scale", &height_scale, 0.0f, 1.0f);
-			ImGui::End();
-
-			
-			ImGui::Begin("Light Settings");
-			ImGui::SliderFloat3("light_position", &light_position[0], -150.0f, 150.0f);
-			ImGui::SliderFloat3("light_color", &light_color[0], 0.0f, 5.0f);
-			ImGui::SliderFloat("light_intensity", &light_intensity, 0.0f, 100.0f);
-			ImGui::SliderFloat("bloom_intensity", &bloom_intensity, 0.0f, 100.0f);
-			ImGui::SliderFloat("exposure", &exposure, 0.0f, 10.0f);
-			ImGui::SliderFloat("spread", &spread, 0.0f, 10.0f);
-			ImGui::End();
-
-			ImGui::Begin("Game Objects");
-			ImGui::SliderFloat3("cube_position", &cube_position[0], -100.0f, 100.0f);
-			ImGui::SliderFloat3("cube_scale", &cube_scale[0], 1.0f, 10.0f);
-			ImGui::SliderFloat3("cube_color", &cube_color[0], 0.0f, 5.0f);
-			ImGui::End();
-
-			ImGui::Render();
+			options.frame_count = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
 		}
-	
-
-		view_mat = g_camera.get_view_mat();
-
-		// draw scene
-		
-		// draw light sources
+		else if (std::strcmp(argv[i], "--size") == 0 && has_value)
 		{
-			light_source.transform_mat = glm::mat4(1.0f);
-			light_source.transform_mat = glm::translate(light_source.transform_mat, light_position);
-			light_source.transform_mat = glm::scale(light_source.transform_mat, glm::vec3(1.0f));
-
-			light_shader.use();
-			light_shader.set_mat4("model_mat", light_source.transform_mat);
-			light_shader.set_mat4("view_mat", view_mat);
-			light_shader.set_mat4("projection_mat", projection_mat);
-			light_shader.set_vec3f("light_color", light_color);
-			light_shader.set_float("light_intensity", light_intensity);
-
-			light_source.model->draw(light_shader);
+			if (std::sscanf(argv[++i], "%ux%u", &options.width, &options.height) != 2 || options.width == 0 || options.height == 0)
+			{
+				std::cout << "Invalid size " << argv[i] << ", expected WIDTHxHEIGHT\n";
+				return false;
+			}
 		}
-
-		// draw other models for scene
+		else if (std::strcmp(argv[i], "--delta") == 0 && has_value)
+		{
+			options.delta_time = std::strtof(argv[++i], nullptr);
+		}
+		else if (std::strcmp(argv[i], "--camera") == 0 && has_value)
 		{
-			sponza.transform_mat = glm::mat4(1.0f);
-
-			sponza.transform_mat = glm::scale(sponza.transform_mat, glm::vec3(0.05f));
-			shader.use();
-			shader.set_mat4("model_mat", sponza.transform_mat);
-			shader.set_mat4("view_mat", view_mat);
-			shader.set_mat4("projection_mat", projection_mat);
-			shader.set_vec3f("light_pos", light_position);
-			shader.set_vec3f("camera_pos", g_camera.m_position);
-			shader.set_vec3f("light_color", light_color);
-			shader.set_float("height_scale", height_scale);
-			shader.set_float("light_intensity", light_intensity);
-
-			sponza.model->draw(shader);
-
-			light_shader.use();
-			cube.transform_mat = glm::mat4(1.0f);
-			cube.transform_mat = glm::translate(cube.transform_mat, cube_position);
-			cube.transform_mat = glm::rotate(cube.transform_mat, glm::radians(90.0f), glm::vec3(0.0f, 1.f, 0.0f));
-			cube.transform_mat = glm::scale(cube.transform_mat, cube_scale);
-			light_shader.set_mat4("model_mat", cube.transform_mat);
-			light_shader.set_vec3f("light_color", cube_color);
-			light_shader.set_float("light_intensity", light_intensity);
-			cube.model->draw(light_shader);
+			options.camera_path = argv[++i];
 		}
-		
-		// apply gaussian blur
-		horizontal = true;
-		first_iteration = true;
-		blur_shader.use();
-		for (int i = 0; i < amount; i++)
+		else if (std::strcmp(argv[i], "--output") == 0 && has_value)
+		{
+			options.output_directory = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--occlusion") == 0 && has_value)
+		{
+			const char* mode = argv[++i];
+			if (std::strcmp(mode, "off") == 0)
+			{
+				options.occlusion = OcclusionMode::Off;
+			}
+			else if (std::strcmp(mode, "gpu") == 0)
+			{
+				options.occlusion = OcclusionMode::Gpu;
+			}
+			else if (std::strcmp(mode, "cpu") == 0)
+			{
+				options.occlusion = OcclusionMode::Cpu;
+			}
+			else
+			{
+				std::cout << "Invalid occlusion mode " << mode << ", expected off, gpu or cpu\n";
+				return false;
+			}
+		}
+		else if (std::strcmp(argv[i], "--objects") == 0 && has_value)
+		{
+			options.object_count = std::clamp(static_cast<int>(std::strtol(argv[++i], nullptr, 10)), 0, Renderer::MAX_OBJECTS);
+		}
+		else
+		{
+			std::cout << "Unknown headless option " << argv[i] << "\n";
+			return false;
+		}
+	}
+
+	return true;
+}
+
+int run_headless(const HeadlessOptions& options)
+{
+	CameraPath camera_path;
+	if (options.camera_path.empty())
+	{
+		camera_path = CameraPath::make_orbit(glm::vec3(0.0f, 15.0f, 0.0f), 40.0f, 5.0f, options.frame_count * options.delta_time, 16);
+	}
+	else if (!camera_path.load(options.camera_path))
+	{
+		return -1;
+	}
+
+	HeadlessContext context;
+	if (!context.is_valid())
+	{
+		return -1;
+	}
+
+	std::error_code error;
+	std::filesystem::create_directories(options.output_directory, error);
+
+	int result = 0;
+
+	// scoped so every GL object is released while the context is still alive
+	{
+		Renderer renderer(options.width, options.height);
+		CaptureTarget capture(options.width, options.height);
+
+		renderer.get_settings().occlusion_culling = static_cast<int>(options.occlusion);
+		renderer.get_settings().object_count = options.object_count;
+
+		// textures stream in over several frames in the windowed app, here every frame has to see all of them
+		TextureLoader::get().wait_idle();
+
+		// and so do the shader variants, which would otherwise stand in for each other while compiling
+		Camera camera;
+		camera_path.apply(0.0f, camera);
+		renderer.set_time(0.0f);
+
+		Profiler::get().begin_frame();
+		renderer.warm_up(camera, options.width, options.height, capture.get_framebuffer());
+		Profiler::get().end_frame();
+
+		for (uint32_t frame = 0; frame < options.frame_count; frame++)
 		{
-			glBindFramebuffer(GL_FRAMEBUFFER, bloom_fbo[horizontal]);
-			blur_shader.set_bool("horizontal", horizontal);
-			blur_shader.set_float("spread", spread);
-			glBindTexture(GL_TEXTURE_2D, first_iteration ? offscreen_rt.color_attachments[1] : bloom_buffer[!horizontal]);
+			Profiler::get().begin_frame();
 
-			glBindVertexArray(offscreen_rt.vao);
-			glDrawArrays(GL_TRIANGLES, 0, 6);
+			camera_path.apply(frame * options.delta_time, camera);
+			renderer.set_time(frame * options.delta_time);
+			renderer.render_frame(camera, options.width, options.height, capture.get_framebuffer(), nullptr);
 
-			horizontal = !horizontal;
-	
-			if (first_iteration)
+			char file_name[32];
+			std::snprintf(file_name, sizeof(file_name), "frame_%04u.png", frame);
+
+			if (!capture.save_png((std::filesystem::path(options.output_directory) / file_name).string()))
 			{
-				first_iteration = false;
+				result = -1;
 			}
+
+			Profiler::get().end_frame();
 		}
 
-		// render to default FBO
+		std::cout << "Wrote " << options.frame_count << " frames to " << options.output_directory << "\n";
+	}
 
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	TextureLoader::get().shutdown();
 
-		glDisable(GL_DEPTH_TEST);
-		glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT);
+	return result;
+}
 
-		
-		offscreen_fb_shader.use();
-		offscreen_fb_shader.set_float("exposure", exposure);
-		offscreen_fb_shader.set_float("bloom_intensity", bloom_intensity);
+void draw_scene_ui(Renderer& renderer)
+{
+	RenderSettings& settings = renderer.get_settings();
 
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, offscreen_rt.color_attachments[0]);
-		offscreen_fb_shader.set_int("offscreen_texture_sampler", 0);
+	ImGui::Begin("Scene Control");
+	ImGui::ColorEdit3("clear_color", &settings.clear_color[0]);
+	ImGui::SliderFloat("camera_speed", &g_camera.m_movement_speed, 0.0f, 1000.0f);
+	ImGui::SliderFloat("height_scale", &settings.height_scale, 0.0f, 1.0f);
+	ImGui::Checkbox("frustum_culling", &settings.frustum_culling);
+	ImGui::Checkbox("depth_prepass", &settings.depth_prepass);
+
+	const SceneInvocationStats invocation_stats = renderer.get_invocation_stats();
+	ImGui::Text("fragment invocations : %llu color + %llu prepass (%llu color without prepass)",
+		static_cast<unsigned long long>(invocation_stats.color), static_cast<unsigned long long>(invocation_stats.prepass),
+		static_cast<unsigned long long>(invocation_stats.color_without_prepass));
+
+	if (settings.depth_prepass && invocation_stats.color_without_prepass > 0)
+	{
+		ImGui::Text("color pass invocations saved : %.1f%%", 100.0 * (1.0 - static_cast<double>(invocation_stats.color) / invocation_stats.color_without_prepass));
+	}
 
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, bloom_buffer[!horizontal]);
-		offscreen_fb_shader.set_int("bloom_texture_sampler", 1);
-	
-		glBindVertexArray(offscreen_rt.vao);
-		glDrawArrays(GL_TRIANGLES, 0, 6);
+	const char* const occlusion_names[] = { "off", "gpu (hi-z)", "cpu (software)" };
+	ImGui::Combo("occlusion_culling", &settings.occlusion_culling, occlusion_names, 3);
 
-		ui_manager.present();
+	const OcclusionStats& occlusion_stats = renderer.get_occlusion_stats();
+	ImGui::Text("occluded items : %u / %u", occlusion_stats.occluded_items, occlusion_stats.tested_items);
 
-		glfwSwapBuffers(window);
+	if (settings.occlusion_culling == static_cast<int>(OcclusionMode::Cpu))
+	{
+		ImGui::Text("occluders : %u (%u triangles)", occlusion_stats.occluders, occlusion_stats.occluder_triangles);
 	}
+	ImGui::SliderFloat("lod_error_pixels", &settings.lod_error_pixels, 0.0f, 8.0f);
 
-	glfwTerminate();
-	return 0;
+	if (ImGui::Button(g_recording ? "stop recording" : "record camera path"))
+	{
+		if (g_recording)
+		{
+			g_recorded_path.save(RECORD_PATH);
+			std::cout << "Saved camera path " << RECORD_PATH << "\n";
+		}
+		else
+		{
+			g_recorded_path.clear();
+			g_recording_time = 0.0f;
+			g_last_keyframe_time = -RECORD_INTERVAL;
+		}
+
+		g_recording = !g_recording;
+	}
+
+	const AssetCacheStats& asset_stats = AssetCache::get().get_stats();
+	ImGui::Text("textures : %zu (hits %llu, misses %llu)", AssetCache::get().get_texture_count(),
+		static_cast<unsigned long long>(asset_stats.texture_hits), static_cast<unsigned long long>(asset_stats.texture_misses));
+	ImGui::Text("models : hits %llu, misses %llu",
+		static_cast<unsigned long long>(asset_stats.model_hits), static_cast<unsigned long long>(asset_stats.model_misses));
+
+	const ProgramCacheStats& program_stats = ProgramCache::get().get_stats();
+	ImGui::Text("program binaries : hits %u, misses %u (%u rejected)", program_stats.hits, program_stats.misses, program_stats.rejected);
+	ImGui::Text("scene shader variants : %zu", renderer.get_scene_shader_variant_count());
+
+	const HotReloadStats& reload_stats = HotReload::get().get_stats();
+	ImGui::Text("hot reloads : %u shaders (%u failed), %u textures, %u models", reload_stats.shader_reloads, reload_stats.shader_failures,
+		reload_stats.texture_reloads, reload_stats.model_reloads);
+
+	// stats of the previous frame's flush
+	const RenderQueueStats& queue_stats = renderer.get_queue_stats();
+	ImGui::Text("meshes culled : %u / %u", queue_stats.culled_items, queue_stats.submitted_items);
+	ImGui::Text("triangles : %llu (full detail %llu)",
+		static_cast<unsigned long long>(queue_stats.triangles), static_cast<unsigned long long>(queue_stats.full_detail_triangles));
+	ImGui::Text("draw calls : %u (%u commands), state changes saved : %u", queue_stats.draw_calls, queue_stats.draw_commands, queue_stats.get_saved_state_changes());
+	if (queue_stats.second_phase_draw_calls > 0)
+	{
+		ImGui::Text("occlusion second phase draw calls : %u", queue_stats.second_phase_draw_calls);
+	}
+	ImGui::Text("binds (shader / material / texture / vao) : %u / %u / %u / %u",
+		queue_stats.shader_binds, queue_stats.material_binds, queue_stats.texture_binds, queue_stats.vao_binds);
+
+	const RenderGraphStats& graph_stats = renderer.get_graph_stats();
+	ImGui::Text("render passes : %u (%u culled)", graph_stats.pass_count, graph_stats.culled_pass_count);
+	ImGui::Text("render targets : %u in %u textures, %.1f / %.1f MB", graph_stats.transient_count, graph_stats.physical_count,
+		graph_stats.transient_bytes / (1024.0 * 1024.0), graph_stats.physical_bytes / (1024.0 * 1024.0));
+	ImGui::End();
+
+	ImGui::Begin("Light Settings");
+	ImGui::SliderFloat3("light_position", &settings.light_position[0], -150.0f, 150.0f);
+	ImGui::SliderFloat3("light_color", &settings.light_color[0], 0.0f, 5.0f);
+	ImGui::SliderFloat("light_intensity", &settings.light_intensity, 0.0f, 100.0f);
+	ImGui::SliderInt("point_light_count", &settings.point_light_count, 0, Renderer::MAX_POINT_LIGHTS);
+	ImGui::SliderFloat("point_light_radius", &settings.point_light_radius, 0.5f, 50.0f);
+	ImGui::SliderFloat("point_light_intensity", &settings.point_light_intensity, 0.0f, 50.0f);
+	ImGui::Checkbox("animate_point_lights", &settings.animate_point_lights);
+
+	const ClusteredLightingStats& light_stats = renderer.get_light_stats();
+	ImGui::Text("point lights : %u / %u visible, %u cluster entries, at most %u per cluster", light_stats.visible_light_count,
+		light_stats.light_count, light_stats.light_index_count, light_stats.max_lights_per_cluster);
+
+	ImGui::SliderFloat3("sun_direction", &settings.sun_direction[0], -1.0f, 1.0f);
+	ImGui::SliderFloat3("sun_color", &settings.sun_color[0], 0.0f, 5.0f);
+	ImGui::SliderFloat("sun_intensity", &settings.sun_intensity, 0.0f, 20.0f);
+	ImGui::Checkbox("shadows", &settings.shadows);
+	ImGui::SliderInt("shadow_cascade_count", &settings.shadow_cascade_count, 1, static_cast<int>(ShadowRenderer::MAX_CASCADES));
+	ImGui::SliderFloat("shadow_distance", &settings.shadow_distance, 10.0f, 500.0f);
+	ImGui::SliderFloat("shadow_split_lambda", &settings.shadow_split_lambda, 0.0f, 1.0f);
+
+	// powers of two only, each change reallocates the cascades
+	const int shadow_resolutions[] = { 1024, 2048, 4096 };
+	const char* const shadow_resolution_names[] = { "1024", "2048", "4096" };
+	int shadow_resolution_index = static_cast<int>(std::find(std::begin(shadow_resolutions), std::end(shadow_resolutions), settings.shadow_resolution) - std::begin(shadow_resolutions));
+	if (ImGui::Combo("shadow_resolution", &shadow_resolution_index, shadow_resolution_names, 3))
+	{
+		settings.shadow_resolution = shadow_resolutions[shadow_resolution_index];
+	}
+
+	const ShadowStats& shadow_stats = renderer.get_shadow_stats();
+	ImGui::Text("shadow cascades : %u drawn, %u cached, %u casters drawn", shadow_stats.rendered_cascades, shadow_stats.cached_cascades, shadow_stats.drawn_items);
+	ImGui::SliderFloat("bloom_intensity", &settings.bloom_intensity, 0.0f, 100.0f);
+	ImGui::SliderFloat("exposure", &settings.exposure, 0.0f, 10.0f);
+	ImGui::SliderFloat("spread", &settings.spread, 0.0f, 10.0f);
+	ImGui::SliderInt("bloom_mip_count", &settings.bloom_mip_count, 1, static_cast<int>(BloomRenderer::MAX_MIP_COUNT));
+	ImGui::Checkbox("gaussian_bloom", &settings.gaussian_bloom);
+	ImGui::Checkbox("compare_bloom", &settings.compare_bloom);
+
+	const BloomRenderer& bloom_renderer = renderer.get_bloom_renderer();
+	ImGui::Text("bloom GPU time (mip chain / gaussian) : %.3f / %.3f ms", bloom_renderer.get_mip_chain_ms(), bloom_renderer.get_gaussian_ms());
+
+	const char* const precision_names[] = { HdrFormatPolicy::get_name(HdrPrecision::Full), HdrFormatPolicy::get_name(HdrPrecision::Half), HdrFormatPolicy::get_name(HdrPrecision::Packed) };
+	ImGui::Combo("hdr_precision", &settings.hdr_precision, precision_names, 3);
+	ImGui::Checkbox("half_res_bright", &settings.half_res_bright);
+	ImGui::Checkbox("validate_precision", &settings.validate_precision);
+
+	if (settings.validate_precision)
+	{
+		const ImageDifference& difference = renderer.get_precision_difference();
+		ImGui::Text("vs RGBA32F : max error %u, mean %.3f, PSNR %.1f dB, %.2f%% pixels off", difference.max_error,
+			difference.mean_error, difference.psnr, difference.differing_ratio * 100.0f);
+	}
+	ImGui::End();
+
+	ImGui::Begin("Game Objects");
+	ImGui::SliderFloat3("cube_position", &settings.cube_position[0], -100.0f, 100.0f);
+	ImGui::SliderFloat3("cube_scale", &settings.cube_scale[0], 1.0f, 10.0f);
+	ImGui::SliderFloat3("cube_color", &settings.cube_color[0], 0.0f, 5.0f);
+	ImGui::SliderInt("object_count", &settings.object_count, 0, Renderer::MAX_OBJECTS);
+	ImGui::Text("entities : %u", renderer.get_entity_count());
+	ImGui::End();
+}
+
+void record_camera()
+{
+	if (!g_recording)
+	{
+		return;
+	}
+
+	if (g_recording_time - g_last_keyframe_time >= RECORD_INTERVAL)
+	{
+		g_recorded_path.add_keyframe({ g_recording_time, g_camera.m_position, g_camera.m_yaw, g_camera.m_pitch });
+		g_last_keyframe_time = g_recording_time;
+	}
+
+	g_recording_time += g_delta_time;
 }
 
 GLFWwindow* create_window(const char* window_title, int width, int height)
@@ -287,7 +497,7 @@ GLFWwindow* create_window(const char* window_title, int width, int height)
 	// Initialize and configure GLFW
 	glfwInit();
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
 	GLFWwindow* window = glfwCreateWindow(width, height, window_title, nullptr, nullptr);
@@ -384,79 +594,3 @@ void process_scroll(GLFWwindow* window, double xoffset, double yoffset)
 {
 	g_camera.process_scroll(static_cast<float>(yoffset));
 }
-
-OffscreenRT::OffscreenRT()
-	: fbo(-1),  depth_attachment(-1)
-{
-	// set up offscreen vbo and vao
-	float fbo_vertices[] =
-	{
-	   -1.0f, 1.0f, 0.0f, 1.0f,
-	   -1.0f, -1.0f, 0.0f, 0.0f,
-		1.0f, -1.0f, 1.0f, 0.0f,
-
-	   -1.0f, 1.0f, 0.0f, 1.0f,
-		1.0f, -1.0f, 1.0f, 0.0f,
-		1.0f, 1.0f, 1.0f, 1.0f
-	};
-
-	glGenVertexArrays(1, &vao);
-	glBindVertexArray(vao);
-
-	glGenBuffers(1, &vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(fbo_vertices), fbo_vertices, GL_STATIC_DRAW);
-	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(float) * 4, nullptr);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(float) * 4, (void*)(sizeof(float) * 2));
-	glEnableVertexAttribArray(1);
-
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
-
-	// framebuffer
-	glGenFramebuffers(1, &fbo);
-	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-
-	// color attachment
-	glGenTextures(2, color_attachments);
-	for (int i = 0; i < 2; i++)
-	{
-		glBindTexture(GL_TEXTURE_2D, color_attachments[i]);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, SCREEN_WIDTH, SCREEN_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-		// attach color attachment to framebuffer
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, color_attachments[i], 0);
-	}
-
-	uint32_t attachments[2] =
-	{
-		GL_COLOR_ATTACHMENT0,
-		GL_COLOR_ATTACHMENT1
-	};
-
-	glDrawBuffers(2, attachments);
-
-	// depth attachment
-	glGenTextures(1, &depth_attachment);
-	glBindTexture(GL_TEXTURE_2D, depth_attachment);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, SCREEN_WIDTH, SCREEN_HEIGHT, 0, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, 0);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	// attach depth attachment to framebuffer
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, depth_attachment, 0);
-
-	// check if framebuffer is complete
-	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-	{
-		std::cout << "Framebuffer is not complete : " << glCheckFramebufferStatus(GL_FRAMEBUFFER) << "\n";
-	}
-
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-}
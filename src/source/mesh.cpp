@@ -1,88 +1,300 @@
 #include "../include/mesh.hpp"
+#include "../include/geometry_arena.hpp"
 
 #include <glad/glad.h>
 
-Mesh::Mesh(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, std::vector<Texture>& textures)
+#include <map>
+#include <unordered_map>
+
+// Fixed texture units per material slot, so a sampler uniform always points at the same unit and consecutive
+// meshes can keep the textures they share bound
+static constexpr uint32_t DIFFUSE_UNIT = 0;
+static constexpr uint32_t SPECULAR_UNIT = 1;
+static constexpr uint32_t NORMAL_UNIT = 2;
+static constexpr uint32_t HEIGHT_UNIT = 3;
+static constexpr uint32_t FIRST_EXTRA_UNIT = 4;
+
+// Freshly imported vertices are packed here, the mesh cache stores the packed stream so later loads skip this
+static std::vector<uint8_t> pack(VertexFormat format, const std::vector<Vertex>& vertices, const Bounds& bounds)
+{
+    std::vector<uint8_t> packed;
+    pack_vertices(format, vertices.data(), vertices.size(), bounds, packed);
+    return packed;
+}
+
+Mesh::Mesh(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, std::vector<Texture>& textures, const Bounds& bounds, const BoundingSphere& sphere,
+    const std::vector<MeshLod>& lods, VertexFormat format)
+    : Mesh(pack(format, vertices, bounds).data(), vertices.size(), indices.data(), indices.size(), textures, bounds, sphere, lods, format)
+{
+}
+
+Mesh::Mesh(const uint8_t* vertex_data, size_t vertex_count, const uint32_t* indices, size_t index_count, std::vector<Texture>& textures, const Bounds& bounds,
+    const BoundingSphere& sphere, const std::vector<MeshLod>& lods, VertexFormat format)
+    : m_sampler_program(0), m_material_id(0), m_shader_keywords(ShaderKeywords::NONE), m_alpha_test(false), m_format(format), m_lods(lods), m_bounds(bounds), m_sphere(sphere), m_draw_bounds(bounds), m_draw_sphere(sphere), m_dequantize_scale(1.0f),
+      m_allocation(GeometryArena::INVALID_HANDLE)
 {
-    m_vertices = vertices;
-    m_indices = indices;
     m_textures = textures;
 
-    setup_mesh();
+    if (m_lods.empty())
+    {
+        m_lods.push_back({ 0, static_cast<uint32_t>(index_count), 0.0f });
+    }
+
+    // quantized positions are stored relative to the bounds, bring the bounds into the same space
+    if (m_format == VertexFormat::PackedQuantized)
+    {
+        const glm::mat4 dequantize_mat = get_dequantize_mat();
+        const glm::mat4 quantize_mat = glm::inverse(dequantize_mat);
+        m_dequantize_scale = dequantize_mat[0][0];
+
+        m_draw_bounds.min = glm::vec3(quantize_mat * glm::vec4(m_bounds.min, 1.0f));
+        m_draw_bounds.max = glm::vec3(quantize_mat * glm::vec4(m_bounds.max, 1.0f));
+        m_draw_sphere.center = glm::vec3(quantize_mat * glm::vec4(m_sphere.center, 1.0f));
+        m_draw_sphere.radius = m_sphere.radius * quantize_mat[0][0];
+    }
+
+    // vertices and indices can come straight from a mapped mesh cache, they are not kept past the upload
+    setup_mesh(vertex_data, static_cast<uint32_t>(vertex_count), indices, static_cast<uint32_t>(index_count));
+    setup_occluder(vertex_data, indices);
+    setup_material();
 }
 
-void Mesh::draw(Shader& shader)
+void Mesh::release()
+{
+    GeometryArena::get(m_format).free(m_allocation);
+    m_allocation = GeometryArena::INVALID_HANDLE;
+}
+
+void Mesh::bind_samplers(Shader& shader)
+{
+    // resolve the sampler handles once per program rather than building and looking up names every draw
+    if (m_sampler_program != shader.get_program())
+    {
+        m_sampler_handles.clear();
+        for (const std::string& sampler_name : m_sampler_names)
+        {
+            m_sampler_handles.push_back(shader.get_uniform<int>(sampler_name));
+        }
+
+        m_sampler_program = shader.get_program();
+    }
+
+    for (uint32_t i = 0; i < m_sampler_handles.size(); i++)
+    {
+        shader.set(m_sampler_handles[i], static_cast<int>(m_texture_units[i]));
+    }
+}
+
+const std::vector<uint32_t>& Mesh::get_texture_units() const
+{
+    return m_texture_units;
+}
+
+uint32_t Mesh::get_material_id() const
+{
+    return m_material_id;
+}
+
+uint32_t Mesh::get_vao() const
+{
+    return GeometryArena::get(m_format).get_vao();
+}
+
+uint32_t Mesh::get_index_count(uint32_t lod) const
+{
+    return m_lods[lod].index_count;
+}
+
+uint32_t Mesh::get_first_index(uint32_t lod) const
+{
+    return GeometryArena::get(m_format).get_first_index(m_allocation) + m_lods[lod].index_offset;
+}
+
+uint32_t Mesh::get_base_vertex() const
+{
+    return GeometryArena::get(m_format).get_base_vertex(m_allocation);
+}
+
+uint32_t Mesh::get_lod_count() const
+{
+    return static_cast<uint32_t>(m_lods.size());
+}
+
+const MeshLod& Mesh::get_lod(uint32_t lod) const
+{
+    return m_lods[lod];
+}
+
+uint32_t Mesh::select_lod(float max_error) const
+{
+    const float max_mesh_error = max_error * m_dequantize_scale;
+
+    // errors grow with the LOD, so walk up while the next one is still acceptable
+    uint32_t lod = 0;
+    while (lod + 1 < m_lods.size() && m_lods[lod + 1].error <= max_mesh_error)
+    {
+        lod++;
+    }
+
+    return lod;
+}
+
+uint32_t Mesh::get_shader_keywords() const
+{
+    return m_shader_keywords;
+}
+
+void Mesh::set_alpha_test(bool alpha_test)
+{
+    m_alpha_test = alpha_test;
+    setup_material();
+}
+
+VertexFormat Mesh::get_format() const
+{
+    return m_format;
+}
+
+const std::vector<glm::vec3>& Mesh::get_occluder_positions() const
+{
+    return m_occluder_positions;
+}
+
+const std::vector<uint32_t>& Mesh::get_occluder_indices() const
+{
+    return m_occluder_indices;
+}
+
+const Bounds& Mesh::get_bounds() const
+{
+    return m_bounds;
+}
+
+const BoundingSphere& Mesh::get_sphere() const
+{
+    return m_sphere;
+}
+
+const Bounds& Mesh::get_draw_bounds() const
+{
+    return m_draw_bounds;
+}
+
+const BoundingSphere& Mesh::get_draw_sphere() const
+{
+    return m_draw_sphere;
+}
+
+glm::mat4 Mesh::get_dequantize_mat() const
+{
+    if (m_format == VertexFormat::PackedQuantized)
+    {
+        return QuantizedVertexPolicy::get_dequantize_mat(m_bounds);
+    }
+
+    return glm::mat4(1.0f);
+}
+
+void Mesh::setup_mesh(const uint8_t* vertex_data, uint32_t vertex_count, const uint32_t* indices, uint32_t index_count)
+{
+    m_allocation = GeometryArena::get(m_format).allocate(vertex_data, vertex_count, indices, index_count);
+}
+
+void Mesh::setup_occluder(const uint8_t* vertex_data, const uint32_t* indices)
+{
+    const MeshLod& lod = m_lods[select_lod(m_draw_sphere.radius * OCCLUDER_LOD_ERROR)];
+    const size_t vertex_size = get_vertex_size(m_format);
+
+    std::unordered_map<uint32_t, uint32_t> remap;
+    m_occluder_indices.reserve(lod.index_count);
+
+    for (uint32_t i = lod.index_offset; i < lod.index_offset + lod.index_count; i++)
+    {
+        auto [it, inserted] = remap.emplace(indices[i], static_cast<uint32_t>(m_occluder_positions.size()));
+        if (inserted)
+        {
+            m_occluder_positions.push_back(get_vertex_position(m_format, vertex_data + indices[i] * vertex_size));
+        }
+
+        m_occluder_indices.push_back(it->second);
+    }
+}
+
+void Mesh::setup_material()
 {
     uint32_t diffuse_num = 1;
     uint32_t specular_num = 1;
     uint32_t normal_num = 1;
     uint32_t height_num = 1;
+    uint32_t extra_unit = FIRST_EXTRA_UNIT;
+
+    m_sampler_names.clear();
+    m_texture_units.clear();
 
     for (uint32_t i = 0; i < m_textures.size(); i++)
     {
-        glActiveTexture(GL_TEXTURE0 + i);
-
         std::string number;
-        std::string texture_type = m_textures[i].type;
+        const std::string& texture_type = m_textures[i].type;
+        uint32_t unit = 0;
 
         if (texture_type == "texture_diffuse")
         {
+            unit = diffuse_num == 1 ? DIFFUSE_UNIT : extra_unit++;
             number = std::to_string(diffuse_num++);
         }
         else if (texture_type == "texture_specular")
         {
+            unit = specular_num == 1 ? SPECULAR_UNIT : extra_unit++;
             number = std::to_string(specular_num++);
         }
         else if (texture_type == "texture_normal")
         {
+            unit = normal_num == 1 ? NORMAL_UNIT : extra_unit++;
             number = std::to_string(normal_num++);
         }
         else if (texture_type == "texture_height")
         {
+            unit = height_num == 1 ? HEIGHT_UNIT : extra_unit++;
             number = std::to_string(height_num++);
         }
+        else
+        {
+            unit = extra_unit++;
+        }
 
-        shader.set_int(("material." + texture_type + number).c_str(), i);
+        m_sampler_names.push_back("material." + texture_type + number);
+        m_texture_units.push_back(unit);
+    }
 
-        glBindTexture(GL_TEXTURE_2D, m_textures[i].texture_id);
+    // cheapest shader variant for the textures the mesh actually has
+    m_shader_keywords = ShaderKeywords::NONE;
+    if (normal_num > 1)
+    {
+        m_shader_keywords |= ShaderKeywords::HAS_NORMAL_MAP;
+    }
+    if (height_num > 1)
+    {
+        m_shader_keywords |= ShaderKeywords::HAS_HEIGHT_MAP;
+    }
+    if (m_alpha_test)
+    {
+        m_shader_keywords |= ShaderKeywords::ALPHA_TEST;
     }
 
+    // dense id per distinct texture set, used to sort and batch draws by material
+    static std::map<std::vector<uint32_t>, uint32_t> material_ids;
 
-    glBindVertexArray(m_vao);
-    glDrawElements(GL_TRIANGLES, static_cast<uint32_t>(m_indices.size()), GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+    std::vector<uint32_t> texture_ids;
+    for (const Texture& texture : m_textures)
+    {
+        texture_ids.push_back(texture.texture_id);
+    }
 
-    glActiveTexture(GL_TEXTURE0);
+    auto it = material_ids.find(texture_ids);
+    if (it == material_ids.end())
+    {
+        it = material_ids.emplace(texture_ids, static_cast<uint32_t>(material_ids.size())).first;
+    }
 
+    m_material_id = it->second;
 }
-
-void Mesh::setup_mesh()
-{
-    glGenVertexArrays(1, &m_vao);
-    glGenBuffers(1, &m_vbo);
-    glGenBuffers(1, &m_ebo);
-
-    glBindVertexArray(m_vao);
-    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * m_vertices.size(), m_vertices.data(), GL_STATIC_DRAW);    
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint32_t) * m_indices.size(), m_indices.data(), GL_STATIC_DRAW);
-
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), nullptr);
-
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(offsetof(Vertex, normal)));
-
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(offsetof(Vertex, tex_coords)));
-
-    glEnableVertexAttribArray(3);
-    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(offsetof(Vertex, tangent)));
-    
-    glEnableVertexAttribArray(4);
-    glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(offsetof(Vertex, bitangent)));
-
-    glBindVertexArray(0);
-}
\ No newline at end of file
@@ -0,0 +1,599 @@
+#include "../include/mesh_cache.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	constexpr uint32_t MAGIC = 0x434d4c47; // "GLMC"
+	constexpr size_t ALIGNMENT = 16;
+
+	// MeshEntry::flags
+	constexpr uint32_t FLAG_ALPHA_TEST = 1 << 0;
+
+	struct FileHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t source_hash;
+		uint32_t import_flags;
+		uint32_t mesh_count;
+		uint32_t vertex_size;
+		uint32_t node_count;
+		uint32_t vertex_format;
+		uint32_t mesh_ref_count;
+	};
+
+	struct MeshEntry
+	{
+		uint64_t vertex_offset;
+		uint64_t index_offset;
+		uint64_t texture_offset;
+		uint32_t vertex_count;
+		uint32_t index_count;
+		uint32_t texture_count;
+		uint32_t flags;
+		float bounds_min[3];
+		float bounds_max[3];
+		float sphere[4];
+		uint32_t lod_count;
+		uint32_t padding_bounds;
+		MeshLod lods[Mesh::MAX_LODS];
+	};
+
+	struct NodeEntry
+	{
+		uint32_t parent;
+		uint32_t first_mesh_ref;
+		uint32_t mesh_ref_count;
+		uint32_t padding;
+		float transform[16];
+	};
+
+	size_t align_up(size_t value)
+	{
+		return (value + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+	}
+
+	void append(std::vector<uint8_t>& buffer, const void* data, size_t size)
+	{
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		buffer.insert(buffer.end(), bytes, bytes + size);
+	}
+
+	// Files the model loads next to itself : the buffers of a .gltf and the material libraries of an .obj. Images
+	// are left out, textures are loaded (and hot reloaded) on their own.
+	std::vector<std::string> find_dependencies(const std::string& path)
+	{
+		std::vector<std::string> dependencies;
+
+		std::ifstream file(path);
+		if (!file.is_open())
+		{
+			return dependencies;
+		}
+
+		const std::string directory = path.substr(0, path.find_last_of('/') + 1);
+		const std::string extension = std::filesystem::path(path).extension().string();
+
+		if (extension == ".gltf")
+		{
+			const std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+			const size_t buffers = text.find("\"buffers\"");
+			const size_t end = buffers == std::string::npos ? std::string::npos : text.find(']', buffers);
+
+			for (size_t key = text.find("\"uri\"", buffers); buffers != std::string::npos && key < end; key = text.find("\"uri\"", key + 5))
+			{
+				const size_t first = text.find('"', text.find(':', key) + 1);
+				const size_t last = text.find('"', first + 1);
+				if (first == std::string::npos || last == std::string::npos)
+				{
+					break;
+				}
+
+				// embedded buffers are part of the .gltf itself
+				const std::string uri = text.substr(first + 1, last - first - 1);
+				if (uri.compare(0, 5, "data:") != 0)
+				{
+					dependencies.push_back(directory + uri);
+				}
+			}
+		}
+		else if (extension == ".obj")
+		{
+			std::string line;
+			while (std::getline(file, line))
+			{
+				if (line.compare(0, 7, "mtllib ") == 0)
+				{
+					dependencies.push_back(directory + line.substr(7));
+				}
+			}
+		}
+
+		return dependencies;
+	}
+
+	void append_string(std::vector<uint8_t>& buffer, const std::string& str)
+	{
+		uint32_t length = static_cast<uint32_t>(str.size());
+		append(buffer, &length, sizeof(length));
+		append(buffer, str.data(), str.size());
+	}
+
+	// Returns false if the string would read past the end of the mapping
+	// whether [offset, offset + size) lies in a file of file_size bytes, written so a corrupt offset can not wrap
+	// around and pass
+	bool is_in_file(uint64_t offset, uint64_t size, size_t file_size)
+	{
+		return offset <= file_size && size <= file_size - offset;
+	}
+
+	bool read_string(const uint8_t* data, size_t size, size_t& offset, std::string& str)
+	{
+		uint32_t length = 0;
+		if (!is_in_file(offset, sizeof(length), size))
+		{
+			return false;
+		}
+
+		std::memcpy(&length, data + offset, sizeof(length));
+		offset += sizeof(length);
+
+		if (!is_in_file(offset, length, size))
+		{
+			return false;
+		}
+
+		str.assign(reinterpret_cast<const char*>(data + offset), length);
+		offset += length;
+
+		return true;
+	}
+}
+
+MeshCache::MeshCache(const std::string& cache_path, uint64_t source_hash, uint32_t import_flags, VertexFormat format)
+	: m_data(nullptr), m_size(0),
+#ifdef _WIN32
+	  m_file(INVALID_HANDLE_VALUE), m_mapping(nullptr)
+#else
+	  m_file(-1)
+#endif
+{
+	if (!map_file(cache_path))
+	{
+		return;
+	}
+
+	if (!parse(source_hash, import_flags, format))
+	{
+		m_meshes.clear();
+		m_nodes.clear();
+		m_mesh_refs.clear();
+		unmap_file();
+	}
+}
+
+MeshCache::~MeshCache()
+{
+	unmap_file();
+}
+
+bool MeshCache::is_valid() const
+{
+	return m_data != nullptr;
+}
+
+const std::vector<CachedMesh>& MeshCache::get_meshes() const
+{
+	return m_meshes;
+}
+
+const std::vector<NodeData>& MeshCache::get_nodes() const
+{
+	return m_nodes;
+}
+
+const std::vector<uint32_t>& MeshCache::get_mesh_refs() const
+{
+	return m_mesh_refs;
+}
+
+bool MeshCache::write(const std::string& cache_path, uint64_t source_hash, uint32_t import_flags, VertexFormat format, const std::vector<MeshData>& meshes,
+	const std::vector<NodeData>& nodes, const std::vector<uint32_t>& mesh_refs)
+{
+	FileHeader header{};
+	header.magic = MAGIC;
+	header.version = VERSION;
+	header.source_hash = source_hash;
+	header.import_flags = import_flags;
+	header.mesh_count = static_cast<uint32_t>(meshes.size());
+	header.vertex_size = get_vertex_size(format);
+	header.node_count = static_cast<uint32_t>(nodes.size());
+	header.vertex_format = static_cast<uint32_t>(format);
+	header.mesh_ref_count = static_cast<uint32_t>(mesh_refs.size());
+
+	std::vector<NodeEntry> node_entries(nodes.size());
+	for (size_t i = 0; i < nodes.size(); i++)
+	{
+		node_entries[i].parent = nodes[i].parent;
+		node_entries[i].first_mesh_ref = nodes[i].first_mesh_ref;
+		node_entries[i].mesh_ref_count = nodes[i].mesh_ref_count;
+		std::memcpy(node_entries[i].transform, &nodes[i].transform[0][0], sizeof(node_entries[i].transform));
+	}
+
+	// Lay out the mesh, node and mesh reference tables first, the vertex / index / texture blobs follow them
+	std::vector<MeshEntry> entries(meshes.size());
+	const size_t tables_size = sizeof(FileHeader) + sizeof(MeshEntry) * entries.size() + sizeof(NodeEntry) * node_entries.size() + sizeof(uint32_t) * mesh_refs.size();
+	size_t offset = align_up(tables_size);
+
+	std::vector<uint8_t> blob;
+	std::vector<uint8_t> packed_vertices;
+	for (size_t i = 0; i < meshes.size(); i++)
+	{
+		const MeshData& mesh = meshes[i];
+		MeshEntry& entry = entries[i];
+
+		pack_vertices(format, mesh.vertices.data(), mesh.vertices.size(), mesh.bounds, packed_vertices);
+
+		blob.resize(align_up(blob.size()));
+		entry.vertex_offset = offset + blob.size();
+		entry.vertex_count = static_cast<uint32_t>(mesh.vertices.size());
+		append(blob, packed_vertices.data(), packed_vertices.size());
+
+		blob.resize(align_up(blob.size()));
+		entry.index_offset = offset + blob.size();
+		entry.index_count = static_cast<uint32_t>(mesh.indices.size());
+		append(blob, mesh.indices.data(), sizeof(uint32_t) * mesh.indices.size());
+
+		for (int j = 0; j < 3; j++)
+		{
+			entry.bounds_min[j] = mesh.bounds.min[j];
+			entry.bounds_max[j] = mesh.bounds.max[j];
+			entry.sphere[j] = mesh.sphere.center[j];
+		}
+		entry.sphere[3] = mesh.sphere.radius;
+
+		entry.lod_count = static_cast<uint32_t>(std::min<size_t>(mesh.lods.size(), Mesh::MAX_LODS));
+		for (uint32_t j = 0; j < entry.lod_count; j++)
+		{
+			entry.lods[j] = mesh.lods[j];
+		}
+
+		entry.texture_offset = offset + blob.size();
+		entry.texture_count = static_cast<uint32_t>(mesh.textures.size());
+		entry.flags = mesh.alpha_test ? FLAG_ALPHA_TEST : 0;
+		for (const TextureRef& texture : mesh.textures)
+		{
+			append_string(blob, texture.type);
+			append_string(blob, texture.path);
+		}
+	}
+
+	// Write to a temporary file first so that a crash while cooking never leaves a truncated cache behind
+	const std::string temp_path = cache_path + ".tmp";
+	{
+		std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			std::cout << "Failed to open mesh cache for writing : " << temp_path << '\n';
+			return false;
+		}
+
+		std::vector<uint8_t> padding(offset - tables_size, 0);
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(entries.data()), sizeof(MeshEntry) * entries.size());
+		file.write(reinterpret_cast<const char*>(node_entries.data()), sizeof(NodeEntry) * node_entries.size());
+		file.write(reinterpret_cast<const char*>(mesh_refs.data()), sizeof(uint32_t) * mesh_refs.size());
+		file.write(reinterpret_cast<const char*>(padding.data()), padding.size());
+		file.write(reinterpret_cast<const char*>(blob.data()), blob.size());
+
+		if (!file.good())
+		{
+			std::cout << "Failed to write mesh cache : " << temp_path << '\n';
+			return false;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temp_path, cache_path, error);
+	if (error)
+	{
+		std::cout << "Failed to move mesh cache into place : " << cache_path << " (" << error.message() << ")\n";
+		std::filesystem::remove(temp_path, error);
+		return false;
+	}
+
+	return true;
+}
+
+std::string MeshCache::get_cache_path(const std::string& source_path, VertexFormat format)
+{
+	return source_path + '.' + get_vertex_format_name(format) + ".meshcache";
+}
+
+uint64_t MeshCache::hash_file(const std::string& path)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open())
+	{
+		return 0;
+	}
+
+	// 64 bit FNV-1a over the file contents
+	uint64_t hash = 0xcbf29ce484222325ull;
+
+	char buffer[64 * 1024];
+	while (file)
+	{
+		file.read(buffer, sizeof(buffer));
+		std::streamsize count = file.gcount();
+
+		for (std::streamsize i = 0; i < count; i++)
+		{
+			hash ^= static_cast<uint8_t>(buffer[i]);
+			hash *= 0x100000001b3ull;
+		}
+	}
+
+	return hash;
+}
+
+uint64_t MeshCache::hash_source(const std::string& path)
+{
+	uint64_t hash = hash_file(path);
+
+	// size and write time of each dependency, cheaper than hashing the (large) buffers and enough to catch a re-export
+	for (const std::string& dependency : find_dependencies(path))
+	{
+		// a missing dependency folds zeros, so the cache refreshes once it appears
+		std::error_code error;
+		uint64_t values[2] = { std::filesystem::file_size(dependency, error), 0 };
+		if (error)
+		{
+			values[0] = 0;
+		}
+		else
+		{
+			values[1] = static_cast<uint64_t>(std::filesystem::last_write_time(dependency, error).time_since_epoch().count());
+		}
+
+		for (uint64_t value : values)
+		{
+			hash ^= value;
+			hash *= 0x100000001b3ull;
+		}
+	}
+
+	return hash;
+}
+
+bool MeshCache::map_file(const std::string& cache_path)
+{
+#ifdef _WIN32
+	m_file = CreateFileA(cache_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (m_file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER file_size{};
+	if (!GetFileSizeEx(m_file, &file_size) || file_size.QuadPart == 0)
+	{
+		unmap_file();
+		return false;
+	}
+
+	m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!m_mapping)
+	{
+		unmap_file();
+		return false;
+	}
+
+	m_data = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+	m_size = static_cast<size_t>(file_size.QuadPart);
+#else
+	m_file = open(cache_path.c_str(), O_RDONLY);
+	if (m_file < 0)
+	{
+		return false;
+	}
+
+	struct stat file_stat{};
+	if (fstat(m_file, &file_stat) != 0 || file_stat.st_size == 0)
+	{
+		unmap_file();
+		return false;
+	}
+
+	void* data = mmap(nullptr, static_cast<size_t>(file_stat.st_size), PROT_READ, MAP_PRIVATE, m_file, 0);
+	if (data == MAP_FAILED)
+	{
+		unmap_file();
+		return false;
+	}
+
+	m_data = static_cast<const uint8_t*>(data);
+	m_size = static_cast<size_t>(file_stat.st_size);
+#endif
+
+	return m_data != nullptr;
+}
+
+bool MeshCache::parse(uint64_t source_hash, uint32_t import_flags, VertexFormat format)
+{
+	if (m_size < sizeof(FileHeader))
+	{
+		return false;
+	}
+
+	FileHeader header{};
+	std::memcpy(&header, m_data, sizeof(header));
+
+	const uint32_t vertex_size = get_vertex_size(format);
+	if (header.magic != MAGIC || header.version != VERSION || header.vertex_format != static_cast<uint32_t>(format) || header.vertex_size != vertex_size)
+	{
+		return false;
+	}
+
+	if (header.source_hash != source_hash || header.import_flags != import_flags)
+	{
+		return false;
+	}
+
+	if (sizeof(FileHeader) + sizeof(MeshEntry) * static_cast<size_t>(header.mesh_count) + sizeof(NodeEntry) * static_cast<size_t>(header.node_count) +
+		sizeof(uint32_t) * static_cast<size_t>(header.mesh_ref_count) > m_size)
+	{
+		return false;
+	}
+
+	const MeshEntry* entries = reinterpret_cast<const MeshEntry*>(m_data + sizeof(FileHeader));
+
+	m_meshes.reserve(header.mesh_count);
+	for (uint32_t i = 0; i < header.mesh_count; i++)
+	{
+		const MeshEntry& entry = entries[i];
+
+		if (!is_in_file(entry.vertex_offset, vertex_size * static_cast<uint64_t>(entry.vertex_count), m_size) ||
+			!is_in_file(entry.index_offset, sizeof(uint32_t) * static_cast<uint64_t>(entry.index_count), m_size))
+		{
+			return false;
+		}
+
+		CachedMesh mesh;
+		mesh.vertices = m_data + entry.vertex_offset;
+		mesh.vertex_count = entry.vertex_count;
+		mesh.indices = reinterpret_cast<const uint32_t*>(m_data + entry.index_offset);
+		mesh.index_count = entry.index_count;
+		mesh.bounds = { glm::vec3(entry.bounds_min[0], entry.bounds_min[1], entry.bounds_min[2]), glm::vec3(entry.bounds_max[0], entry.bounds_max[1], entry.bounds_max[2]) };
+		mesh.sphere = { glm::vec3(entry.sphere[0], entry.sphere[1], entry.sphere[2]), entry.sphere[3] };
+		mesh.alpha_test = (entry.flags & FLAG_ALPHA_TEST) != 0;
+
+		if (entry.lod_count > Mesh::MAX_LODS)
+		{
+			return false;
+		}
+
+		for (uint32_t j = 0; j < entry.lod_count; j++)
+		{
+			if (static_cast<uint64_t>(entry.lods[j].index_offset) + entry.lods[j].index_count > entry.index_count)
+			{
+				return false;
+			}
+
+			mesh.lods.push_back(entry.lods[j]);
+		}
+
+		size_t texture_offset = static_cast<size_t>(entry.texture_offset);
+		for (uint32_t j = 0; j < entry.texture_count; j++)
+		{
+			TextureRef texture;
+			if (!read_string(m_data, m_size, texture_offset, texture.type) || !read_string(m_data, m_size, texture_offset, texture.path))
+			{
+				return false;
+			}
+
+			mesh.textures.push_back(std::move(texture));
+		}
+
+		m_meshes.push_back(std::move(mesh));
+	}
+
+	// nodes must come after their parent and point into the mesh reference table, whose entries point at meshes of
+	// the file
+	const uint8_t* node_table = m_data + sizeof(FileHeader) + sizeof(MeshEntry) * static_cast<size_t>(header.mesh_count);
+
+	m_nodes.reserve(header.node_count);
+	for (uint32_t i = 0; i < header.node_count; i++)
+	{
+		NodeEntry entry{};
+		std::memcpy(&entry, node_table + sizeof(NodeEntry) * i, sizeof(entry));
+
+		if ((entry.parent != SceneGraph::NO_PARENT && entry.parent >= i) || static_cast<uint64_t>(entry.first_mesh_ref) + entry.mesh_ref_count > header.mesh_ref_count)
+		{
+			return false;
+		}
+
+		NodeData node;
+		node.parent = entry.parent;
+		node.first_mesh_ref = entry.first_mesh_ref;
+		node.mesh_ref_count = entry.mesh_ref_count;
+		std::memcpy(&node.transform[0][0], entry.transform, sizeof(entry.transform));
+
+		m_nodes.push_back(node);
+	}
+
+	const uint8_t* mesh_ref_table = node_table + sizeof(NodeEntry) * static_cast<size_t>(header.node_count);
+
+	m_mesh_refs.reserve(header.mesh_ref_count);
+	for (uint32_t i = 0; i < header.mesh_ref_count; i++)
+	{
+		uint32_t mesh_ref = 0;
+		std::memcpy(&mesh_ref, mesh_ref_table + sizeof(uint32_t) * i, sizeof(mesh_ref));
+
+		if (mesh_ref >= header.mesh_count)
+		{
+			return false;
+		}
+
+		m_mesh_refs.push_back(mesh_ref);
+	}
+
+	return true;
+}
+
+void MeshCache::unmap_file()
+{
+#ifdef _WIN32
+	if (m_data)
+	{
+		UnmapViewOfFile(m_data);
+	}
+
+	if (m_mapping)
+	{
+		CloseHandle(m_mapping);
+	}
+
+	if (m_file != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_file);
+	}
+
+	m_mapping = nullptr;
+	m_file = INVALID_HANDLE_VALUE;
+#else
+	if (m_data)
+	{
+		munmap(const_cast<uint8_t*>(m_data), m_size);
+	}
+
+	if (m_file >= 0)
+	{
+		close(m_file);
+	}
+
+	m_file = -1;
+#endif
+
+	m_data = nullptr;
+	m_size = 0;
+}
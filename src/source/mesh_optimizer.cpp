@@ -0,0 +1,115 @@
+#include "../include/mesh_optimizer.hpp"
+
+#include <meshoptimizer.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+MeshOptimizeStats MeshOptimizer::optimize(MeshData& mesh)
+{
+	MeshOptimizeStats stats{};
+	stats.vertex_count_before = static_cast<uint32_t>(mesh.vertices.size());
+	stats.before = analyze(mesh);
+
+	if (mesh.indices.empty() || mesh.vertices.empty())
+	{
+		stats.vertex_count_after = stats.vertex_count_before;
+		stats.after = stats.before;
+		return stats;
+	}
+
+	const size_t index_count = mesh.indices.size();
+
+	// merge bitwise identical vertices, assimp emits one vertex per face corner for some formats
+	std::vector<uint32_t> remap(mesh.vertices.size());
+	const size_t vertex_count = meshopt_generateVertexRemap(remap.data(), mesh.indices.data(), index_count, mesh.vertices.data(), mesh.vertices.size(), sizeof(Vertex));
+
+	std::vector<uint32_t> indices(index_count);
+	meshopt_remapIndexBuffer(indices.data(), mesh.indices.data(), index_count, remap.data());
+
+	std::vector<Vertex> vertices(vertex_count);
+	meshopt_remapVertexBuffer(vertices.data(), mesh.vertices.data(), mesh.vertices.size(), sizeof(Vertex), remap.data());
+
+	meshopt_optimizeVertexCache(mesh.indices.data(), indices.data(), index_count, vertex_count);
+
+	// positions are the first member of Vertex, so the vertex array doubles as the position stream
+	meshopt_optimizeOverdraw(indices.data(), mesh.indices.data(), index_count, &vertices[0].position.x, vertex_count, sizeof(Vertex), OVERDRAW_THRESHOLD);
+
+	mesh.vertices.resize(vertex_count);
+	meshopt_optimizeVertexFetch(mesh.vertices.data(), indices.data(), index_count, vertices.data(), vertex_count, sizeof(Vertex));
+	mesh.indices = std::move(indices);
+
+	stats.vertex_count_after = static_cast<uint32_t>(mesh.vertices.size());
+	stats.after = analyze(mesh);
+
+	return stats;
+}
+
+void MeshOptimizer::generate_lods(MeshData& mesh)
+{
+	const size_t base_index_count = mesh.indices.size();
+	mesh.lods.clear();
+	mesh.lods.push_back({ 0, static_cast<uint32_t>(base_index_count), 0.0f });
+
+	if (mesh.vertices.empty() || base_index_count < MIN_LOD_TRIANGLES * 3)
+	{
+		return;
+	}
+
+	const float* positions = &mesh.vertices[0].position.x;
+	const size_t vertex_count = mesh.vertices.size();
+
+	// simplify reports errors relative to the mesh extent
+	const float error_scale = meshopt_simplifyScale(positions, vertex_count, sizeof(Vertex));
+
+	const std::vector<uint32_t> base_indices(mesh.indices.begin(), mesh.indices.end());
+	std::vector<uint32_t> lod_indices(base_index_count);
+
+	size_t previous_index_count = base_index_count;
+	float previous_error = 0.0f;
+
+	for (uint32_t lod = 1; lod < Mesh::MAX_LODS; lod++)
+	{
+		const size_t target_index_count = (previous_index_count / 2) / 3 * 3;
+		if (target_index_count < MIN_LOD_TRIANGLES * 3)
+		{
+			break;
+		}
+
+		// every level starts from full detail so its error is measured against the original surface. Vertices on
+		// UV / normal seams are split in the vertex buffer, the simplifier keeps those seams from opening.
+		float error = 0.0f;
+		const size_t index_count = meshopt_simplify(lod_indices.data(), base_indices.data(), base_index_count, positions, vertex_count, sizeof(Vertex),
+			target_index_count, 1.0f, 0, &error);
+
+		if (index_count == 0 || index_count > previous_index_count * (1.0f - MIN_LOD_REDUCTION))
+		{
+			break;
+		}
+
+		meshopt_optimizeVertexCache(lod_indices.data(), lod_indices.data(), index_count, vertex_count);
+
+		// keep errors increasing with the LOD so selection can stop at the first level that is too coarse
+		previous_error = std::max(previous_error, error * error_scale);
+		mesh.lods.push_back({ static_cast<uint32_t>(mesh.indices.size()), static_cast<uint32_t>(index_count), previous_error });
+		mesh.indices.insert(mesh.indices.end(), lod_indices.begin(), lod_indices.begin() + index_count);
+
+		previous_index_count = index_count;
+	}
+}
+
+MeshEfficiency MeshOptimizer::analyze(const MeshData& mesh)
+{
+	if (mesh.indices.empty() || mesh.vertices.empty())
+	{
+		return {};
+	}
+
+	const meshopt_VertexCacheStatistics cache_stats = meshopt_analyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size(), VERTEX_CACHE_SIZE, 0, 0);
+	const meshopt_OverdrawStatistics overdraw_stats = meshopt_analyzeOverdraw(mesh.indices.data(), mesh.indices.size(), &mesh.vertices[0].position.x, mesh.vertices.size(), sizeof(Vertex));
+	const meshopt_VertexFetchStatistics fetch_stats = meshopt_analyzeVertexFetch(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size(), sizeof(Vertex));
+
+	return { cache_stats.acmr, cache_stats.atvr, overdraw_stats.overdraw, fetch_stats.overfetch };
+}
@@ -1,143 +1,341 @@
 #include "../include/model.hpp"
+#include "../include/asset_cache.hpp"
+#include "../include/render_queue.hpp"
+#include "../include/geometry_arena.hpp"
+#include "../include/mesh_optimizer.hpp"
 
-#include <stb_image.h>
 #include <glad/glad.h>
 
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include <cstring>
 #include <iostream>
-#include <GL/glext.h>
+#include <limits>
+#include <numeric>
 
-unsigned int texture_from_file(const char *path, const std::string &directory, bool gamma = true)
+// Textures decode asynchronously, until then they hold a 1x1 placeholder that keeps the mesh drawable
+static constexpr uint8_t PLACEHOLDER_DIFFUSE[4] = { 128, 128, 128, 255 };
+static constexpr uint8_t PLACEHOLDER_BLACK[4] = { 0, 0, 0, 255 };
+static constexpr uint8_t PLACEHOLDER_NORMAL[4] = { 128, 128, 255, 255 };
+
+unsigned int texture_from_file(const char *path, const std::string &directory, bool gamma, const uint8_t placeholder[4])
 {
     std::string filename = std::string(path);
     filename = directory + '/' + filename;
 
-    unsigned int texture_id;
-    glGenTextures(1, &texture_id);
+    return AssetCache::get().acquire_texture(filename, gamma, placeholder);
+}
 
-    int width, height, num_components;
-    unsigned char *data = stbi_load(filename.c_str(), &width, &height, &num_components, 0);
-    GLenum data_format = GL_RGB;
+// assimp matrices are row major
+static glm::mat4 to_mat4(const aiMatrix4x4& matrix)
+{
+    glm::mat4 result;
+    for (int row = 0; row < 4; row++)
+    {
+        for (int column = 0; column < 4; column++)
+        {
+            result[column][row] = matrix[row][column];
+        }
+    }
+
+    return result;
+}
 
-    if (data)
+// Changing these invalidates every mesh cache, since the flags are part of the cache key
+static constexpr uint32_t IMPORT_FLAGS = aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace | aiProcess_OptimizeMeshes;
+
+Model::Model(const char *path, VertexFormat format)
+    : m_path(path), m_format(format), m_reload_count(0)
+{
+    load_model(path);
+}
+
+Model::~Model()
+{
+    release_meshes(m_meshes);
+}
+
+bool Model::reload()
+{
+    std::vector<Mesh> previous_meshes = std::move(m_meshes);
+    std::vector<NodeData> previous_nodes = std::move(m_nodes);
+    std::vector<uint32_t> previous_mesh_refs = std::move(m_mesh_refs);
+    m_meshes.clear();
+    m_nodes.clear();
+    m_mesh_refs.clear();
+
+    // the source hash changed, so this re-imports and refreshes the mesh cache
+    load_model(m_path);
+
+    // a file caught half exported fails to import, keep drawing the old meshes until the next change
+    if (m_meshes.empty() && !previous_meshes.empty())
     {
-        GLenum format;
-        if (!gamma)
+        std::cout << "Failed to reload model, keeping the previous version : " << m_path << '\n';
+        m_meshes = std::move(previous_meshes);
+        m_nodes = std::move(previous_nodes);
+        m_mesh_refs = std::move(previous_mesh_refs);
+        build_node_graph();
+        return false;
+    }
+
+    release_meshes(previous_meshes);
+    m_reload_count++;
+    return true;
+}
+
+uint32_t Model::get_reload_count() const
+{
+    return m_reload_count;
+}
+
+const std::string& Model::get_directory() const
+{
+    return m_directory;
+}
+
+Bounds Model::get_bounds() const
+{
+    if (m_meshes.empty())
+    {
+        return { glm::vec3(0.0f), glm::vec3(0.0f) };
+    }
+
+    Bounds bounds = { glm::vec3(std::numeric_limits<float>::max()), glm::vec3(std::numeric_limits<float>::lowest()) };
+    for (uint32_t i = 0; i < m_nodes.size(); i++)
+    {
+        const NodeData& node = m_nodes[i];
+        for (uint32_t j = node.first_mesh_ref; j < node.first_mesh_ref + node.mesh_ref_count; j++)
         {
-            if (num_components == 1)
-            {
-                format = GL_RED;
-                data_format = GL_RED;
-            }
-            else if (num_components == 3)
-            {
-                format = GL_RGB;
-                data_format = GL_RGB;
-            }
-            else if (num_components == 4)
-            {
-                format = GL_RGBA;
-                data_format = GL_RGBA;
-            }
+            const Bounds mesh_bounds = transform_bounds(m_meshes[m_mesh_refs[j]].get_bounds(), m_node_graph.get_world(i));
+            bounds.min = glm::min(bounds.min, mesh_bounds.min);
+            bounds.max = glm::max(bounds.max, mesh_bounds.max);
         }
-        else
+    }
+
+    return bounds;
+}
+
+const SceneGraph& Model::get_node_graph() const
+{
+    return m_node_graph;
+}
+
+void Model::release_meshes(std::vector<Mesh>& meshes)
+{
+    for (Mesh& mesh : meshes)
+    {
+        mesh.release();
+
+        for (const Texture& texture : mesh.m_textures)
         {
-            if (num_components == 1)
-            {
-                data_format = GL_RED;
-                format = GL_RED;
-            }
-            else if (num_components == 3)
-            {
-                data_format = GL_RGB;
-                format = GL_SRGB;
-            }
-            else if (num_components == 4)
-            {
-                data_format = GL_RGBA;
-                format = GL_SRGB_ALPHA;
-            }
+            AssetCache::get().release_texture(texture.texture_id);
         }
-      
-        glBindTexture(GL_TEXTURE_2D, texture_id);
+    }
 
-        float aniso = 0.0f;
-        
-        glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &aniso);
-        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, aniso);
+    meshes.clear();
 
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, data_format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+    GeometryArena::get(m_format).compact_if_fragmented();
+}
 
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+void Model::build_node_graph()
+{
+    // meshes without a node (a cache without nodes, which is not expected) hang off an identity root
+    if (m_nodes.empty() && !m_meshes.empty())
+    {
+        m_mesh_refs.resize(m_meshes.size());
+        std::iota(m_mesh_refs.begin(), m_mesh_refs.end(), 0u);
 
-        stbi_image_free(data);
+        m_nodes.push_back({ SceneGraph::NO_PARENT, 0, static_cast<uint32_t>(m_mesh_refs.size()), glm::mat4(1.0f) });
     }
-    else
+
+    m_node_graph.clear();
+    m_node_graph.reserve(static_cast<uint32_t>(m_nodes.size()));
+
+    for (const NodeData& node : m_nodes)
     {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
+        m_node_graph.add_node(node.parent, node.transform);
     }
 
-    return texture_id;
+    m_node_graph.update();
 }
 
-Model::Model(const char *path)
+void Model::submit(RenderQueue& queue, Shader& shader, const glm::mat4& transform, const glm::vec3& color)
 {
-    load_model(path);
+    submit_meshes(queue, transform, color, [&](const Mesh&) -> Shader& { return shader; });
 }
 
-void Model::draw(Shader& shader)
+void Model::submit(RenderQueue& queue, ShaderVariants& shaders, const glm::mat4& transform, const glm::vec3& color)
 {
-    for (uint32_t i = 0; i < m_meshes.size(); i++)
+    submit_meshes(queue, transform, color, [&](const Mesh& mesh) -> Shader& { return shaders.get(mesh.get_shader_keywords()); });
+}
+
+void Model::submit_meshes(RenderQueue& queue, const glm::mat4& transform, const glm::vec3& color, const std::function<Shader&(const Mesh&)>& select_shader)
+{
+    for (uint32_t i = 0; i < m_nodes.size(); i++)
     {
-        m_meshes[i].draw(shader);
+        const NodeData& node = m_nodes[i];
+        if (node.mesh_ref_count == 0)
+        {
+            continue;
+        }
+
+        const glm::mat4 node_transform = transform * m_node_graph.get_world(i);
+
+        // quantized positions are relative to each mesh's bounds, so every mesh needs its own dequantizing transform
+        if (m_format == VertexFormat::PackedQuantized)
+        {
+            for (uint32_t j = node.first_mesh_ref; j < node.first_mesh_ref + node.mesh_ref_count; j++)
+            {
+                Mesh& mesh = m_meshes[m_mesh_refs[j]];
+                queue.submit(select_shader(mesh), mesh, queue.add_object(node_transform * mesh.get_dequantize_mat(), color));
+            }
+
+            continue;
+        }
+
+        // every mesh of the node shares one entry in the object buffer
+        const uint32_t object_index = queue.add_object(node_transform, color);
+
+        for (uint32_t j = node.first_mesh_ref; j < node.first_mesh_ref + node.mesh_ref_count; j++)
+        {
+            Mesh& mesh = m_meshes[m_mesh_refs[j]];
+            queue.submit(select_shader(mesh), mesh, object_index);
+        }
     }
 }
 
 void Model::load_model(const std::string& path)
 {
-    Assimp::Importer importer;
-    const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace | aiProcess_OptimizeMeshes);
+    m_directory = path.substr(0, path.find_last_of('/'));
 
-    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
+    const std::string cache_path = MeshCache::get_cache_path(path, m_format);
+    const uint64_t source_hash = MeshCache::hash_source(path);
+
+    MeshCache cache(cache_path, source_hash, IMPORT_FLAGS, m_format);
+    if (cache.is_valid())
     {
-        std::cout << "Cannot load model with path : " << path << '\n';
+        for (const CachedMesh& mesh : cache.get_meshes())
+        {
+            std::vector<Texture> textures = load_material_textures(mesh.textures);
+            m_meshes.emplace_back(mesh.vertices, mesh.vertex_count, mesh.indices, mesh.index_count, textures, mesh.bounds, mesh.sphere, mesh.lods, m_format);
+            m_meshes.back().set_alpha_test(mesh.alpha_test);
+        }
+
+        m_nodes = cache.get_nodes();
+        m_mesh_refs = cache.get_mesh_refs();
+        build_node_graph();
+
         return;
     }
 
-    m_directory = path.substr(0, path.find_last_of('/'));
+    // cache is missing or stale, import with assimp and write a fresh one for the next launch
+    std::vector<MeshData> meshes;
+    std::vector<NodeData> nodes;
+    std::vector<uint32_t> mesh_refs;
+    if (!import_model(path, meshes, nodes, mesh_refs))
+    {
+        return;
+    }
+
+    MeshCache::write(cache_path, source_hash, IMPORT_FLAGS, m_format, meshes, nodes, mesh_refs);
+
+    for (MeshData& mesh : meshes)
+    {
+        std::vector<Texture> textures = load_material_textures(mesh.textures);
+        m_meshes.emplace_back(mesh.vertices, mesh.indices, textures, mesh.bounds, mesh.sphere, mesh.lods, m_format);
+        m_meshes.back().set_alpha_test(mesh.alpha_test);
+    }
 
-    process_node(scene->mRootNode, scene);
+    m_nodes = std::move(nodes);
+    m_mesh_refs = std::move(mesh_refs);
+    build_node_graph();
 }
 
-void Model::process_node(aiNode *node, const aiScene* scene)
+bool Model::cook(const std::string& path)
 {
-    // process all meshes of node
-    for (uint32_t i = 0; i < node->mNumMeshes; i++)
+    std::vector<MeshData> meshes;
+    std::vector<NodeData> nodes;
+    std::vector<uint32_t> mesh_refs;
+    if (!import_model(path, meshes, nodes, mesh_refs))
     {
-        aiMesh *mesh = scene->mMeshes[node->mMeshes[i]];
-        m_meshes.push_back(process_mesh(mesh, scene));
+        return false;
+    }
+
+    // one cache per vertex format, whichever the model is loaded with finds its packed vertices
+    const uint64_t source_hash = MeshCache::hash_source(path);
+    for (VertexFormat format : { VertexFormat::Full, VertexFormat::Packed, VertexFormat::PackedQuantized })
+    {
+        const std::string cache_path = MeshCache::get_cache_path(path, format);
+        if (!MeshCache::write(cache_path, source_hash, IMPORT_FLAGS, format, meshes, nodes, mesh_refs))
+        {
+            return false;
+        }
+
+        std::cout << "Cooked " << path << " -> " << cache_path << " (" << meshes.size() << " meshes, " << nodes.size() << " nodes)\n";
+    }
+
+    return true;
+}
+
+bool Model::import_model(const std::string& path, std::vector<MeshData>& meshes, std::vector<NodeData>& nodes, std::vector<uint32_t>& mesh_refs)
+{
+    Assimp::Importer importer;
+    const aiScene* scene = importer.ReadFile(path, IMPORT_FLAGS);
+
+    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
+    {
+        std::cout << "Cannot load model with path : " << path << '\n';
+        return false;
+    }
+
+    // once per aiMesh, however many nodes instance it
+    meshes.reserve(scene->mNumMeshes);
+    for (uint32_t i = 0; i < scene->mNumMeshes; i++)
+    {
+        meshes.push_back(process_mesh(scene->mMeshes[i], scene));
+    }
+
+    process_node(scene->mRootNode, SceneGraph::NO_PARENT, nodes, mesh_refs);
+
+    for (uint32_t i = 0; i < meshes.size(); i++)
+    {
+        const MeshOptimizeStats stats = MeshOptimizer::optimize(meshes[i]);
+
+        std::cout << "Optimized mesh " << i << " : vertices " << stats.vertex_count_before << " -> " << stats.vertex_count_after
+            << ", ACMR " << stats.before.acmr << " -> " << stats.after.acmr
+            << ", ATVR " << stats.before.atvr << " -> " << stats.after.atvr
+            << ", overdraw " << stats.before.overdraw << " -> " << stats.after.overdraw << '\n';
+
+        MeshOptimizer::generate_lods(meshes[i]);
     }
 
+    return true;
+}
+
+void Model::process_node(aiNode *node, uint32_t parent, std::vector<NodeData>& nodes, std::vector<uint32_t>& mesh_refs)
+{
+    const uint32_t index = static_cast<uint32_t>(nodes.size());
+    nodes.push_back({ parent, static_cast<uint32_t>(mesh_refs.size()), node->mNumMeshes, to_mat4(node->mTransformation) });
+
+    // the node's meshes, as indices of scene->mMeshes (and so of the imported meshes)
+    mesh_refs.insert(mesh_refs.end(), node->mMeshes, node->mMeshes + node->mNumMeshes);
+
     // process all children of current node
     for (uint32_t i = 0; i < node->mNumChildren; i++)
     {
-        process_node(node->mChildren[i], scene);
+        process_node(node->mChildren[i], index, nodes, mesh_refs);
     }
 }
 
-Mesh Model::process_mesh(aiMesh *mesh, const aiScene *scene)
+MeshData Model::process_mesh(aiMesh *mesh, const aiScene *scene)
 {
-    std::vector<Vertex> vertices;
-    std::vector<uint32_t> indices;
-    std::vector<Texture> textures;
+    MeshData mesh_data;
+    mesh_data.alpha_test = false;
+    std::vector<Vertex>& vertices = mesh_data.vertices;
+    std::vector<uint32_t>& indices = mesh_data.indices;
+    std::vector<TextureRef>& textures = mesh_data.textures;
 
     for (uint32_t i = 0; i < mesh->mNumVertices; i++)
     {
@@ -182,6 +380,25 @@ Mesh Model::process_mesh(aiMesh *mesh, const aiScene *scene)
         vertices.push_back(vertex);
     }
 
+    // box from the position extremes, sphere around the box center with the distance to the farthest vertex
+    mesh_data.bounds = {};
+    mesh_data.sphere = {};
+    if (!vertices.empty())
+    {
+        mesh_data.bounds = { vertices[0].position, vertices[0].position };
+        for (const Vertex& vertex : vertices)
+        {
+            mesh_data.bounds.min = glm::min(mesh_data.bounds.min, vertex.position);
+            mesh_data.bounds.max = glm::max(mesh_data.bounds.max, vertex.position);
+        }
+
+        mesh_data.sphere.center = (mesh_data.bounds.min + mesh_data.bounds.max) * 0.5f;
+        for (const Vertex& vertex : vertices)
+        {
+            mesh_data.sphere.radius = glm::max(mesh_data.sphere.radius, glm::distance(mesh_data.sphere.center, vertex.position));
+        }
+    }
+
     for (uint32_t i = 0; i < mesh->mNumFaces; i++)
     {
         aiFace face = mesh->mFaces[i];
@@ -194,60 +411,81 @@ Mesh Model::process_mesh(aiMesh *mesh, const aiScene *scene)
     if (mesh->mMaterialIndex >= 0)
     {
         aiMaterial *material = scene->mMaterials[mesh->mMaterialIndex];
-        std::vector<Texture> diffuse_maps = load_material_texture(material, aiTextureType_DIFFUSE, "texture_diffuse");
+        std::vector<TextureRef> diffuse_maps = get_material_textures(material, aiTextureType_DIFFUSE, "texture_diffuse");
         textures.insert(textures.end(), diffuse_maps.begin(), diffuse_maps.end());
 
-        std::vector<Texture> specular_maps = load_material_texture(material, aiTextureType_SPECULAR, "texture_specular");
+        std::vector<TextureRef> specular_maps = get_material_textures(material, aiTextureType_SPECULAR, "texture_specular");
         textures.insert(textures.end(), specular_maps.begin(), specular_maps.end());
     
-        std::vector<Texture> normal_maps = load_material_texture(material, aiTextureType_NORMALS, "texture_normal");
+        std::vector<TextureRef> normal_maps = get_material_textures(material, aiTextureType_NORMALS, "texture_normal");
         textures.insert(textures.end(), normal_maps.begin(), normal_maps.end());
 
-        std::vector<Texture> height_maps = load_material_texture(material, aiTextureType_HEIGHT, "texture_height");
+        std::vector<TextureRef> height_maps = get_material_textures(material, aiTextureType_HEIGHT, "texture_height");
         textures.insert(textures.end(), height_maps.begin(), height_maps.end());
 
+        // glTF materials state their alpha mode ("$mat.gltf.alphaMode" is AI_MATKEY_GLTF_ALPHAMODE), other formats
+        // are treated as cutouts when they have an opacity map
+        aiString alpha_mode;
+        if (material->Get("$mat.gltf.alphaMode", 0, 0, alpha_mode) == AI_SUCCESS)
+        {
+            mesh_data.alpha_test = std::strcmp(alpha_mode.C_Str(), "OPAQUE") != 0;
+        }
+        else
+        {
+            mesh_data.alpha_test = material->GetTextureCount(aiTextureType_OPACITY) > 0;
+        }
     }
 
-    return Mesh(vertices, indices, textures);
+    return mesh_data;
 }
 
-std::vector<Texture> Model::load_material_texture(aiMaterial *material, aiTextureType type, const std::string& type_name)
+std::vector<TextureRef> Model::get_material_textures(aiMaterial *material, aiTextureType type, const std::string& type_name)
 {
-    std::vector<Texture> textures;
+    std::vector<TextureRef> textures;
 
     for (uint32_t i = 0; i < material->GetTextureCount(type); i++)
     {
         aiString str;
         material->GetTexture(type, i, &str);
 
-        bool already_added = false;
-        for (uint32_t j = 0; j < m_textures_loaded.size(); j++)
+        TextureRef texture;
+        texture.type = type_name;
+        texture.path = str.C_Str();
+        textures.push_back(texture);
+    }
+
+    return textures;
+}
+
+std::vector<Texture> Model::load_material_textures(const std::vector<TextureRef>& texture_refs)
+{
+    std::vector<Texture> textures;
+
+    for (uint32_t i = 0; i < texture_refs.size(); i++)
+    {
+        const TextureRef& texture_ref = texture_refs[i];
+
+        // duplicates across meshes and models are resolved by the asset cache
+        Texture texture;
+        if (texture_ref.type == "texture_normal")
         {
-            if (std::strcmp(m_textures_loaded[i].path.data(), str.C_Str()) == 0)
-            {
-                textures.push_back(m_textures_loaded[j]);
-                already_added = true;
-                break;
-            }
+            texture.texture_id = texture_from_file(texture_ref.path.c_str(), m_directory, false, PLACEHOLDER_NORMAL);
         }
-
-        if (already_added)
+        else if (texture_ref.type == "texture_height")
         {
-            continue;
+            texture.texture_id = texture_from_file(texture_ref.path.c_str(), m_directory, false, PLACEHOLDER_BLACK);
         }
-        
-        Texture texture;
-        if (type_name == "texture_normal" || type_name == "texture_height")
+        else if (texture_ref.type == "texture_specular")
         {
-            texture.texture_id = texture_from_file(str.C_Str(), m_directory, false);
+            texture.texture_id = texture_from_file(texture_ref.path.c_str(), m_directory, true, PLACEHOLDER_BLACK);
         }
         else
         {
-            texture.texture_id = texture_from_file(str.C_Str(), m_directory, true);
+            texture.texture_id = texture_from_file(texture_ref.path.c_str(), m_directory, true, PLACEHOLDER_DIFFUSE);
         }
 
-        texture.type = type_name;
-        texture.path = str.C_Str();
+        texture.type = texture_ref.type;
+        texture.path = texture_ref.path;
         textures.push_back(texture);
     }
 
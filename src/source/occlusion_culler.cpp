@@ -0,0 +1,384 @@
+#include "../include/occlusion_culler.hpp"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+	constexpr uint32_t PYRAMID_GROUP_SIZE = 8;
+	constexpr uint32_t CULL_GROUP_SIZE = 64;
+
+	uint32_t previous_power_of_two(uint32_t value)
+	{
+		uint32_t result = 1;
+		while (result * 2 <= value)
+		{
+			result *= 2;
+		}
+
+		return result;
+	}
+
+	// Edge function of a -> b at p, positive on the inner side of a counter clockwise triangle
+	float edge(const glm::vec2& a, const glm::vec2& b, const glm::vec2& p)
+	{
+		return (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x);
+	}
+}
+
+OcclusionCuller::OcclusionCuller()
+	: m_pyramid_shader("../shaders/hiz_pyramid.comp"), m_cull_shader("../shaders/occlusion_cull.comp"), m_mode(OcclusionMode::Off), m_view_projection(1.0f),
+	  m_depth_texture(0), m_pyramid(0), m_pyramid_width(0), m_pyramid_height(0), m_pyramid_levels(0), m_item_buffer(0), m_bounds_buffer(0),
+	  m_visibility_buffer(0), m_stats_buffers{}, m_stats_frame(0), m_item_count(0), m_command_count(0), m_tested(false), m_stats{}
+{
+	glCreateBuffers(1, &m_item_buffer);
+	glCreateBuffers(1, &m_bounds_buffer);
+	glCreateBuffers(1, &m_visibility_buffer);
+	glCreateBuffers(STATS_LATENCY, m_stats_buffers);
+
+	const uint32_t zero[2] = { 0, 0 };
+	for (uint32_t buffer : m_stats_buffers)
+	{
+		glNamedBufferData(buffer, sizeof(zero), zero, GL_DYNAMIC_READ);
+	}
+}
+
+OcclusionCuller::~OcclusionCuller()
+{
+	glDeleteTextures(1, &m_pyramid);
+
+	glDeleteBuffers(1, &m_item_buffer);
+	glDeleteBuffers(1, &m_bounds_buffer);
+	glDeleteBuffers(1, &m_visibility_buffer);
+	glDeleteBuffers(STATS_LATENCY, m_stats_buffers);
+}
+
+void OcclusionCuller::begin_frame(OcclusionMode mode, const glm::mat4& view_projection, uint32_t item_count, uint32_t depth_texture, uint32_t width, uint32_t height)
+{
+	if (mode != m_mode)
+	{
+		m_stats = {};
+	}
+
+	m_mode = mode;
+	m_view_projection = view_projection;
+	m_depth_texture = depth_texture;
+	m_tested = false;
+
+	if (mode == OcclusionMode::Cpu)
+	{
+		m_stats = {};
+		m_software_depth.assign(SOFTWARE_WIDTH * SOFTWARE_HEIGHT, 1.0f);
+		return;
+	}
+
+	if (mode != OcclusionMode::Gpu)
+	{
+		return;
+	}
+
+	create_pyramid(width, height);
+
+	// a different scene starts with everything visible, phase two sorts it out within the frame
+	if (item_count != m_item_count)
+	{
+		m_item_count = item_count;
+
+		const std::vector<uint32_t> visible(std::max(item_count, 1u), 1);
+		glNamedBufferData(m_visibility_buffer, sizeof(uint32_t) * visible.size(), visible.data(), GL_DYNAMIC_COPY);
+	}
+
+	read_stats();
+}
+
+OcclusionMode OcclusionCuller::get_mode() const
+{
+	return m_mode;
+}
+
+void OcclusionCuller::set_commands(uint32_t command_buffer, const std::vector<uint32_t>& items, const std::vector<Bounds>& bounds)
+{
+	m_command_count = static_cast<uint32_t>(items.size());
+
+	m_bounds_data.resize(bounds.size() * 2);
+	for (size_t i = 0; i < bounds.size(); i++)
+	{
+		m_bounds_data[i * 2] = glm::vec4(bounds[i].min, 0.0f);
+		m_bounds_data[i * 2 + 1] = glm::vec4(bounds[i].max, 0.0f);
+	}
+
+	if (items.empty())
+	{
+		return;
+	}
+
+	glNamedBufferData(m_item_buffer, sizeof(uint32_t) * items.size(), items.data(), GL_STREAM_DRAW);
+	glNamedBufferData(m_bounds_buffer, sizeof(glm::vec4) * m_bounds_data.size(), m_bounds_data.data(), GL_STREAM_DRAW);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMMAND_BUFFER_BINDING, command_buffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, ITEM_BUFFER_BINDING, m_item_buffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BOUNDS_BUFFER_BINDING, m_bounds_buffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, VISIBILITY_BUFFER_BINDING, m_visibility_buffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, STATS_BUFFER_BINDING, m_stats_buffers[m_stats_frame]);
+}
+
+bool OcclusionCuller::is_tested() const
+{
+	return m_tested;
+}
+
+void OcclusionCuller::apply_visibility()
+{
+	if (m_command_count == 0)
+	{
+		return;
+	}
+
+	m_cull_shader.use();
+	m_cull_shader.set_int("command_count", static_cast<int>(m_command_count));
+	m_cull_shader.set_bool("test_occlusion", false);
+	m_cull_shader.dispatch((m_command_count + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE);
+
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void OcclusionCuller::test()
+{
+	m_tested = true;
+
+	if (m_mode != OcclusionMode::Gpu || m_command_count == 0)
+	{
+		return;
+	}
+
+	build_pyramid();
+
+	m_cull_shader.use();
+	m_cull_shader.set_int("command_count", static_cast<int>(m_command_count));
+	m_cull_shader.set_bool("test_occlusion", true);
+	m_cull_shader.set_mat4("view_projection", m_view_projection);
+	m_cull_shader.set_int("pyramid_levels", static_cast<int>(m_pyramid_levels));
+
+	glBindTextureUnit(0, m_pyramid);
+	m_cull_shader.set_int("pyramid", 0);
+
+	m_cull_shader.dispatch((m_command_count + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE);
+
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void OcclusionCuller::add_occluder(const Mesh& mesh, const glm::mat4& model_mat)
+{
+	// model_mat applies to the positions as stored on the GPU, which the occluder positions are in
+	const glm::mat4 transform = m_view_projection * model_mat;
+
+	const std::vector<glm::vec3>& positions = mesh.get_occluder_positions();
+	const std::vector<uint32_t>& indices = mesh.get_occluder_indices();
+
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		rasterize_triangle(transform * glm::vec4(positions[indices[i]], 1.0f), transform * glm::vec4(positions[indices[i + 1]], 1.0f),
+			transform * glm::vec4(positions[indices[i + 2]], 1.0f));
+	}
+
+	m_stats.occluders++;
+	m_stats.occluder_triangles += static_cast<uint32_t>(indices.size() / 3);
+}
+
+bool OcclusionCuller::is_visible(const Bounds& bounds)
+{
+	m_stats.tested_items++;
+
+	glm::vec2 screen_min(std::numeric_limits<float>::max());
+	glm::vec2 screen_max(std::numeric_limits<float>::lowest());
+	float nearest = 1.0f;
+
+	for (uint32_t corner = 0; corner < 8; corner++)
+	{
+		const glm::vec4 clip = m_view_projection * glm::vec4((corner & 1) ? bounds.max.x : bounds.min.x, (corner & 2) ? bounds.max.y : bounds.min.y,
+			(corner & 4) ? bounds.max.z : bounds.min.z, 1.0f);
+
+		// reaches behind the camera, too close to be worth testing
+		if (clip.w <= 0.0f)
+		{
+			return true;
+		}
+
+		const glm::vec3 ndc = glm::vec3(clip) / clip.w;
+		const glm::vec2 screen((ndc.x * 0.5f + 0.5f) * SOFTWARE_WIDTH, (ndc.y * 0.5f + 0.5f) * SOFTWARE_HEIGHT);
+
+		screen_min = glm::min(screen_min, screen);
+		screen_max = glm::max(screen_max, screen);
+		nearest = std::min(nearest, ndc.z * 0.5f + 0.5f);
+	}
+
+	// every pixel the rect touches, a single one with an occluder farther than the box keeps the item
+	const int32_t min_x = std::max(static_cast<int32_t>(std::floor(screen_min.x)), 0);
+	const int32_t min_y = std::max(static_cast<int32_t>(std::floor(screen_min.y)), 0);
+	const int32_t max_x = std::min(static_cast<int32_t>(std::floor(screen_max.x)), static_cast<int32_t>(SOFTWARE_WIDTH) - 1);
+	const int32_t max_y = std::min(static_cast<int32_t>(std::floor(screen_max.y)), static_cast<int32_t>(SOFTWARE_HEIGHT) - 1);
+
+	for (int32_t y = min_y; y <= max_y; y++)
+	{
+		for (int32_t x = min_x; x <= max_x; x++)
+		{
+			if (nearest <= m_software_depth[y * SOFTWARE_WIDTH + x])
+			{
+				return true;
+			}
+		}
+	}
+
+	// off screen rects end up here too, the frustum culling normally has them already
+	m_stats.occluded_items++;
+	return false;
+}
+
+const OcclusionStats& OcclusionCuller::get_stats() const
+{
+	return m_stats;
+}
+
+void OcclusionCuller::create_pyramid(uint32_t width, uint32_t height)
+{
+	// power of two levels, so each texel of a level covers exactly 2x2 texels of the next finer one
+	const uint32_t pyramid_width = previous_power_of_two(width);
+	const uint32_t pyramid_height = previous_power_of_two(height);
+
+	if (m_pyramid != 0 && pyramid_width == m_pyramid_width && pyramid_height == m_pyramid_height)
+	{
+		return;
+	}
+
+	glDeleteTextures(1, &m_pyramid);
+
+	m_pyramid_width = pyramid_width;
+	m_pyramid_height = pyramid_height;
+	m_pyramid_levels = 1;
+	while ((std::max(m_pyramid_width, m_pyramid_height) >> m_pyramid_levels) > 0)
+	{
+		m_pyramid_levels++;
+	}
+
+	glCreateTextures(GL_TEXTURE_2D, 1, &m_pyramid);
+	glTextureStorage2D(m_pyramid, m_pyramid_levels, GL_R32F, m_pyramid_width, m_pyramid_height);
+	glTextureParameteri(m_pyramid, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTextureParameteri(m_pyramid, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTextureParameteri(m_pyramid, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(m_pyramid, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+}
+
+void OcclusionCuller::build_pyramid()
+{
+	m_pyramid_shader.use();
+	m_pyramid_shader.set_int("source", 0);
+
+	// level 0 from the depth buffer, then each level from the one before
+	for (uint32_t level = 0; level < m_pyramid_levels; level++)
+	{
+		const uint32_t level_width = std::max(m_pyramid_width >> level, 1u);
+		const uint32_t level_height = std::max(m_pyramid_height >> level, 1u);
+
+		glBindTextureUnit(0, level == 0 ? m_depth_texture : m_pyramid);
+		m_pyramid_shader.set_int("source_level", level == 0 ? 0 : static_cast<int>(level - 1));
+		glBindImageTexture(0, m_pyramid, static_cast<int32_t>(level), GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+
+		m_pyramid_shader.dispatch((level_width + PYRAMID_GROUP_SIZE - 1) / PYRAMID_GROUP_SIZE, (level_height + PYRAMID_GROUP_SIZE - 1) / PYRAMID_GROUP_SIZE);
+
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+	}
+}
+
+void OcclusionCuller::read_stats()
+{
+	// the buffer about to be reused was written STATS_LATENCY frames ago
+	m_stats_frame = (m_stats_frame + 1) % STATS_LATENCY;
+
+	uint32_t counters[2] = {};
+	glGetNamedBufferSubData(m_stats_buffers[m_stats_frame], 0, sizeof(counters), counters);
+
+	m_stats.tested_items = counters[0];
+	m_stats.occluded_items = counters[1];
+
+	glClearNamedBufferData(m_stats_buffers[m_stats_frame], GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+}
+
+void OcclusionCuller::rasterize_triangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c)
+{
+	// triangles crossing the near plane are skipped rather than clipped, occluding less is always safe
+	if (a.w <= 0.0f || b.w <= 0.0f || c.w <= 0.0f)
+	{
+		return;
+	}
+
+	const glm::vec2 size(SOFTWARE_WIDTH, SOFTWARE_HEIGHT);
+	glm::vec2 p0 = (glm::vec2(a.x, a.y) / a.w * 0.5f + 0.5f) * size;
+	glm::vec2 p1 = (glm::vec2(b.x, b.y) / b.w * 0.5f + 0.5f) * size;
+	glm::vec2 p2 = (glm::vec2(c.x, c.y) / c.w * 0.5f + 0.5f) * size;
+
+	float z0 = a.z / a.w * 0.5f + 0.5f;
+	float z1 = b.z / b.w * 0.5f + 0.5f;
+	float z2 = c.z / c.w * 0.5f + 0.5f;
+
+	float area = edge(p0, p1, p2);
+	if (std::abs(area) < 1e-6f)
+	{
+		return;
+	}
+
+	// both faces occlude, clockwise triangles are flipped
+	if (area < 0.0f)
+	{
+		std::swap(p1, p2);
+		std::swap(z1, z2);
+		area = -area;
+	}
+
+	const int32_t min_x = std::max(static_cast<int32_t>(std::floor(std::min({ p0.x, p1.x, p2.x }))), 0);
+	const int32_t min_y = std::max(static_cast<int32_t>(std::floor(std::min({ p0.y, p1.y, p2.y }))), 0);
+	const int32_t max_x = std::min(static_cast<int32_t>(std::ceil(std::max({ p0.x, p1.x, p2.x }))), static_cast<int32_t>(SOFTWARE_WIDTH) - 1);
+	const int32_t max_y = std::min(static_cast<int32_t>(std::ceil(std::max({ p0.y, p1.y, p2.y }))), static_cast<int32_t>(SOFTWARE_HEIGHT) - 1);
+
+	if (min_x > max_x || min_y > max_y)
+	{
+		return;
+	}
+
+	// edge functions and depth are affine in screen space : a pixel is covered entirely when every edge is still
+	// positive at its worst corner, and its depth is taken at its farthest corner
+	const glm::vec2 edge_gradients[3] = { glm::vec2(p1.y - p2.y, p2.x - p1.x), glm::vec2(p2.y - p0.y, p0.x - p2.x), glm::vec2(p0.y - p1.y, p1.x - p0.x) };
+
+	const glm::vec2 depth_gradient = (edge_gradients[0] * z0 + edge_gradients[1] * z1 + edge_gradients[2] * z2) / area;
+	const float depth_slack = 0.5f * (std::abs(depth_gradient.x) + std::abs(depth_gradient.y));
+
+	float edge_slack[3];
+	for (uint32_t i = 0; i < 3; i++)
+	{
+		edge_slack[i] = 0.5f * (std::abs(edge_gradients[i].x) + std::abs(edge_gradients[i].y));
+	}
+
+	for (int32_t y = min_y; y <= max_y; y++)
+	{
+		for (int32_t x = min_x; x <= max_x; x++)
+		{
+			const glm::vec2 center(x + 0.5f, y + 0.5f);
+
+			const float w0 = edge(p1, p2, center);
+			const float w1 = edge(p2, p0, center);
+			const float w2 = edge(p0, p1, center);
+
+			if (w0 < edge_slack[0] || w1 < edge_slack[1] || w2 < edge_slack[2])
+			{
+				continue;
+			}
+
+			const float depth = (w0 * z0 + w1 * z1 + w2 * z2) / area + depth_slack;
+
+			float& stored = m_software_depth[y * SOFTWARE_WIDTH + x];
+			stored = std::min(stored, depth);
+		}
+	}
+}
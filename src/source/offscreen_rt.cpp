@@ -0,0 +1,97 @@
+#include "../include/offscreen_rt.hpp"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+
+RenderTargetDesc HdrFormatPolicy::get_color_desc(uint32_t width, uint32_t height) const
+{
+	switch (precision)
+	{
+	case HdrPrecision::Half:
+		return { width, height, GL_RGBA16F };
+	case HdrPrecision::Packed:
+		return { width, height, GL_R11F_G11F_B10F };
+	default:
+		return { width, height, GL_RGBA32F };
+	}
+}
+
+RenderTargetDesc HdrFormatPolicy::get_bright_desc(uint32_t width, uint32_t height) const
+{
+	if (half_res_bright)
+	{
+		width = std::max(width / 2, 1u);
+		height = std::max(height / 2, 1u);
+	}
+
+	// only RGB is ever read from the bright pass, so below the reference it is always packed
+	return { width, height, precision == HdrPrecision::Full ? static_cast<uint32_t>(GL_RGBA32F) : static_cast<uint32_t>(GL_R11F_G11F_B10F) };
+}
+
+RenderTargetDesc HdrFormatPolicy::get_depth_desc(uint32_t width, uint32_t height) const
+{
+	return { width, height, GL_DEPTH24_STENCIL8 };
+}
+
+uint32_t HdrFormatPolicy::get_bloom_format() const
+{
+	switch (precision)
+	{
+	case HdrPrecision::Half:
+		return GL_RGBA16F;
+	case HdrPrecision::Packed:
+		return GL_R11F_G11F_B10F;
+	default:
+		return GL_RGBA32F;
+	}
+}
+
+const char* HdrFormatPolicy::get_name(HdrPrecision precision)
+{
+	switch (precision)
+	{
+	case HdrPrecision::Half:
+		return "RGBA16F";
+	case HdrPrecision::Packed:
+		return "R11G11B10F";
+	default:
+		return "RGBA32F";
+	}
+}
+
+OffscreenRT::OffscreenRT(const HdrFormatPolicy& policy)
+	: policy(policy), vao(0), vbo(0)
+{
+	// set up offscreen vbo and vao
+	float fbo_vertices[] =
+	{
+	   -1.0f, 1.0f, 0.0f, 1.0f,
+	   -1.0f, -1.0f, 0.0f, 0.0f,
+		1.0f, -1.0f, 1.0f, 0.0f,
+
+	   -1.0f, 1.0f, 0.0f, 1.0f,
+		1.0f, -1.0f, 1.0f, 0.0f,
+		1.0f, 1.0f, 1.0f, 1.0f
+	};
+
+	glGenVertexArrays(1, &vao);
+	glBindVertexArray(vao);
+
+	glGenBuffers(1, &vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(fbo_vertices), fbo_vertices, GL_STATIC_DRAW);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(float) * 4, nullptr);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(float) * 4, (void*)(sizeof(float) * 2));
+	glEnableVertexAttribArray(1);
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+}
+
+OffscreenRT::~OffscreenRT()
+{
+	glDeleteBuffers(1, &vbo);
+	glDeleteVertexArrays(1, &vao);
+}
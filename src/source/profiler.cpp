@@ -0,0 +1,361 @@
+#include "../include/profiler.hpp"
+
+#include <glad/glad.h>
+#include <nlohmann/json.hpp>
+
+#include <fstream>
+#include <iostream>
+
+Profiler& Profiler::get()
+{
+	static Profiler profiler;
+	return profiler;
+}
+
+Profiler::Profiler()
+	: m_enabled(true), m_frame_active(false), m_frame_scope(INVALID_SCOPE), m_frames{}, m_frame_index(0), m_results_frame_index(0), m_history_offset(0),
+	  m_dropped_frames(0), m_capture_frames_left(0), m_epoch(std::chrono::steady_clock::now())
+{
+}
+
+Profiler::~Profiler()
+{
+	for (Frame& frame : m_frames)
+	{
+		if (!frame.queries.empty())
+		{
+			glDeleteQueries(static_cast<int32_t>(frame.queries.size()), frame.queries.data());
+		}
+	}
+}
+
+void Profiler::begin_frame()
+{
+	m_frame_active = m_enabled;
+	if (!m_frame_active)
+	{
+		return;
+	}
+
+	// the slot about to be reused holds the frame from FRAME_LATENCY frames ago
+	Frame& frame = m_frames[m_frame_index % FRAME_LATENCY];
+	if (frame.pending)
+	{
+		resolve(frame);
+	}
+
+	frame.scopes.clear();
+	frame.query_count = 0;
+	frame.frame_index = m_frame_index;
+	frame.pending = true;
+
+	int64_t gpu_time_ns = 0;
+	glGetInteger64v(GL_TIMESTAMP, &gpu_time_ns);
+	frame.gpu_offset_us = get_cpu_time_us() - gpu_time_ns * 1e-3;
+
+	m_open_scopes.clear();
+	m_frame_scope = begin_scope("frame", true);
+}
+
+void Profiler::end_frame()
+{
+	if (!m_frame_active)
+	{
+		return;
+	}
+
+	end_scope(m_frame_scope);
+
+	m_frame_active = false;
+	m_frame_index++;
+}
+
+uint32_t Profiler::begin_scope(std::string_view name, bool gpu)
+{
+	if (!m_frame_active)
+	{
+		return INVALID_SCOPE;
+	}
+
+	Frame& frame = m_frames[m_frame_index % FRAME_LATENCY];
+
+	Scope scope{};
+	scope.name_id = get_name_id(name);
+	scope.depth = static_cast<uint32_t>(m_open_scopes.size());
+	scope.gpu_begin_query = gpu ? write_timestamp(frame) : INVALID_SCOPE;
+	scope.gpu_end_query = INVALID_SCOPE;
+	scope.cpu_begin_us = get_cpu_time_us();
+
+	frame.scopes.push_back(scope);
+
+	const uint32_t scope_index = static_cast<uint32_t>(frame.scopes.size() - 1);
+	m_open_scopes.push_back(scope_index);
+
+	return scope_index;
+}
+
+void Profiler::end_scope(uint32_t scope_index)
+{
+	if (!m_frame_active || scope_index == INVALID_SCOPE)
+	{
+		return;
+	}
+
+	Frame& frame = m_frames[m_frame_index % FRAME_LATENCY];
+	Scope& scope = frame.scopes[scope_index];
+
+	scope.cpu_end_us = get_cpu_time_us();
+	if (scope.gpu_begin_query != INVALID_SCOPE)
+	{
+		scope.gpu_end_query = write_timestamp(frame);
+	}
+
+	if (!m_open_scopes.empty() && m_open_scopes.back() == scope_index)
+	{
+		m_open_scopes.pop_back();
+	}
+	else
+	{
+		std::cout << "Profiler scope " << m_names[scope.name_id] << " ended out of order\n";
+	}
+}
+
+void Profiler::add_draws(uint32_t draw_calls, uint64_t triangles)
+{
+	if (!m_frame_active || m_open_scopes.empty())
+	{
+		return;
+	}
+
+	Scope& scope = m_frames[m_frame_index % FRAME_LATENCY].scopes[m_open_scopes.back()];
+	scope.draw_calls += draw_calls;
+	scope.triangles += triangles;
+}
+
+void Profiler::set_enabled(bool enabled)
+{
+	m_enabled = enabled;
+}
+
+bool Profiler::is_enabled() const
+{
+	return m_enabled;
+}
+
+void Profiler::start_capture(uint32_t frame_count, const std::string& path)
+{
+	m_capture_events.clear();
+	m_capture_path = path;
+	m_capture_frames_left = frame_count;
+}
+
+bool Profiler::is_capturing() const
+{
+	return m_capture_frames_left > 0;
+}
+
+const std::vector<ProfileScopeResult>& Profiler::get_results() const
+{
+	return m_results;
+}
+
+uint64_t Profiler::get_results_frame_index() const
+{
+	return m_results_frame_index;
+}
+
+uint64_t Profiler::get_frame_index() const
+{
+	return m_frame_index;
+}
+
+const std::string& Profiler::get_name(uint32_t name_id) const
+{
+	return m_names[name_id];
+}
+
+const float* Profiler::get_cpu_history(uint32_t name_id) const
+{
+	return m_histories[name_id].cpu_ms;
+}
+
+const float* Profiler::get_gpu_history(uint32_t name_id) const
+{
+	return m_histories[name_id].gpu_ms;
+}
+
+uint32_t Profiler::get_history_offset() const
+{
+	return m_history_offset;
+}
+
+uint64_t Profiler::get_dropped_frame_count() const
+{
+	return m_dropped_frames;
+}
+
+void Profiler::resolve(Frame& frame)
+{
+	frame.pending = false;
+
+	// the last query written finishes last, if it is not done the frame's GPU times are given up rather than waited on
+	bool gpu_ready = true;
+	if (frame.query_count > 0)
+	{
+		int32_t available = 0;
+		glGetQueryObjectiv(frame.queries[frame.query_count - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+
+		gpu_ready = available != 0;
+		if (!gpu_ready)
+		{
+			m_dropped_frames++;
+		}
+	}
+
+	std::vector<uint64_t> timestamps(frame.query_count, 0);
+	if (gpu_ready)
+	{
+		for (uint32_t i = 0; i < frame.query_count; i++)
+		{
+			glGetQueryObjectui64v(frame.queries[i], GL_QUERY_RESULT, &timestamps[i]);
+		}
+	}
+
+	for (History& history : m_histories)
+	{
+		history.cpu_ms[m_history_offset] = 0.0f;
+		history.gpu_ms[m_history_offset] = 0.0f;
+	}
+
+	m_results.clear();
+	m_results_frame_index = frame.frame_index;
+
+	for (const Scope& scope : frame.scopes)
+	{
+		const bool has_gpu = gpu_ready && scope.gpu_begin_query != INVALID_SCOPE && scope.gpu_end_query != INVALID_SCOPE;
+
+		ProfileScopeResult result{};
+		result.name_id = scope.name_id;
+		result.depth = scope.depth;
+		result.cpu_ms = static_cast<float>((scope.cpu_end_us - scope.cpu_begin_us) * 1e-3);
+		result.gpu_ms = has_gpu ? static_cast<float>((timestamps[scope.gpu_end_query] - timestamps[scope.gpu_begin_query]) * 1e-6) : -1.0f;
+		result.draw_calls = scope.draw_calls;
+		result.triangles = scope.triangles;
+
+		m_results.push_back(result);
+
+		History& history = m_histories[scope.name_id];
+		history.cpu_ms[m_history_offset] += result.cpu_ms;
+		history.gpu_ms[m_history_offset] += has_gpu ? result.gpu_ms : 0.0f;
+
+		if (m_capture_frames_left > 0)
+		{
+			CaptureEvent event{};
+			event.name_id = scope.name_id;
+			event.frame_index = frame.frame_index;
+			event.cpu_begin_us = scope.cpu_begin_us;
+			event.cpu_duration_us = scope.cpu_end_us - scope.cpu_begin_us;
+			event.gpu_begin_us = has_gpu ? timestamps[scope.gpu_begin_query] * 1e-3 + frame.gpu_offset_us : 0.0;
+			event.gpu_duration_us = has_gpu ? (timestamps[scope.gpu_end_query] - timestamps[scope.gpu_begin_query]) * 1e-3 : -1.0;
+			event.draw_calls = scope.draw_calls;
+			event.triangles = scope.triangles;
+
+			m_capture_events.push_back(event);
+		}
+	}
+
+	m_history_offset = (m_history_offset + 1) % HISTORY_SIZE;
+
+	if (m_capture_frames_left > 0 && --m_capture_frames_left == 0)
+	{
+		write_capture();
+	}
+}
+
+void Profiler::write_capture()
+{
+	constexpr int CPU_TRACK = 0;
+	constexpr int GPU_TRACK = 1;
+
+	nlohmann::json events = nlohmann::json::array();
+
+	events.push_back({ { "name", "thread_name" }, { "ph", "M" }, { "pid", 0 }, { "tid", CPU_TRACK }, { "args", { { "name", "CPU" } } } });
+	events.push_back({ { "name", "thread_name" }, { "ph", "M" }, { "pid", 0 }, { "tid", GPU_TRACK }, { "args", { { "name", "GPU" } } } });
+
+	for (const CaptureEvent& event : m_capture_events)
+	{
+		const nlohmann::json args =
+		{
+			{ "frame", event.frame_index },
+			{ "draw_calls", event.draw_calls },
+			{ "triangles", event.triangles }
+		};
+
+		events.push_back({ { "name", m_names[event.name_id] }, { "ph", "X" }, { "pid", 0 }, { "tid", CPU_TRACK },
+			{ "ts", event.cpu_begin_us }, { "dur", event.cpu_duration_us }, { "args", args } });
+
+		if (event.gpu_duration_us >= 0.0)
+		{
+			events.push_back({ { "name", m_names[event.name_id] }, { "ph", "X" }, { "pid", 0 }, { "tid", GPU_TRACK },
+				{ "ts", event.gpu_begin_us }, { "dur", event.gpu_duration_us }, { "args", args } });
+		}
+	}
+
+	const nlohmann::json trace = { { "traceEvents", events }, { "displayTimeUnit", "ms" } };
+
+	std::ofstream file(m_capture_path);
+	if (!file)
+	{
+		std::cout << "Failed to write profile capture " << m_capture_path << "\n";
+		return;
+	}
+
+	file << trace.dump();
+	m_capture_events.clear();
+
+	std::cout << "Wrote profile capture " << m_capture_path << "\n";
+}
+
+uint32_t Profiler::get_name_id(std::string_view name)
+{
+	auto it = m_name_ids.find(name);
+	if (it != m_name_ids.end())
+	{
+		return it->second;
+	}
+
+	const uint32_t name_id = static_cast<uint32_t>(m_names.size());
+	m_names.emplace_back(name);
+	m_name_ids.emplace(m_names.back(), name_id);
+	m_histories.push_back(History{});
+
+	return name_id;
+}
+
+uint32_t Profiler::write_timestamp(Frame& frame)
+{
+	if (frame.query_count == frame.queries.size())
+	{
+		uint32_t query = 0;
+		glCreateQueries(GL_TIMESTAMP, 1, &query);
+		frame.queries.push_back(query);
+	}
+
+	glQueryCounter(frame.queries[frame.query_count], GL_TIMESTAMP);
+	return frame.query_count++;
+}
+
+double Profiler::get_cpu_time_us() const
+{
+	return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - m_epoch).count();
+}
+
+ProfileScope::ProfileScope(std::string_view name, bool gpu)
+	: m_scope(Profiler::get().begin_scope(name, gpu))
+{
+}
+
+ProfileScope::~ProfileScope()
+{
+	Profiler::get().end_scope(m_scope);
+}
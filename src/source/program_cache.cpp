@@ -0,0 +1,257 @@
+#include "../include/program_cache.hpp"
+
+#include <glad/glad.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+	constexpr uint32_t MAGIC = 0x50434c47; // "GLCP"
+
+	struct FileHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t key;
+		uint32_t binary_format;
+		uint32_t binary_size;
+	};
+
+	std::string_view get_gl_string(GLenum name)
+	{
+		const char* str = reinterpret_cast<const char*>(glGetString(name));
+		return str != nullptr ? std::string_view(str) : std::string_view();
+	}
+
+	bool has_extension(std::string_view extension)
+	{
+		int extension_count = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &extension_count);
+
+		for (int i = 0; i < extension_count; i++)
+		{
+			const char* name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, static_cast<uint32_t>(i)));
+			if (name != nullptr && extension == name)
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+}
+
+ProgramCache& ProgramCache::get()
+{
+	static ProgramCache program_cache;
+	return program_cache;
+}
+
+ProgramCache::ProgramCache()
+	: m_initialized(false), m_enabled(true), m_parallel_compile(false), m_binary_supported(false), m_driver_hash(0), m_stats{}
+{
+}
+
+void ProgramCache::init()
+{
+	if (m_initialized)
+	{
+		return;
+	}
+
+	m_initialized = true;
+
+	m_driver_hash = hash(get_gl_string(GL_VENDOR));
+	m_driver_hash = hash(get_gl_string(GL_RENDERER), m_driver_hash);
+	m_driver_hash = hash(get_gl_string(GL_VERSION), m_driver_hash);
+
+	int format_count = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+	m_binary_supported = format_count > 0;
+
+	m_parallel_compile = has_extension("GL_KHR_parallel_shader_compile");
+
+#ifdef GL_KHR_parallel_shader_compile
+	// let the driver use as many compiler threads as it likes, the default may be a single one
+	if (m_parallel_compile && GLAD_GL_KHR_parallel_shader_compile)
+	{
+		glMaxShaderCompilerThreadsKHR(0xffffffff);
+	}
+#endif
+
+	std::error_code error;
+	std::filesystem::create_directories(CACHE_DIRECTORY, error);
+	if (error)
+	{
+		std::cout << "Failed to create program cache directory : " << CACHE_DIRECTORY << " (" << error.message() << ")\n";
+		m_binary_supported = false;
+	}
+}
+
+uint64_t ProgramCache::get_key(std::string_view vs_source, std::string_view fs_source)
+{
+	init();
+
+	// the sources are separated so that moving text from one stage to the other changes the key
+	uint64_t key = hash(vs_source, m_driver_hash);
+	key = hash("|", key);
+	return hash(fs_source, key);
+}
+
+uint32_t ProgramCache::load(uint64_t key)
+{
+	init();
+
+	if (!m_enabled || !m_binary_supported)
+	{
+		return 0;
+	}
+
+	std::ifstream file(get_path(key), std::ios::binary);
+	if (!file.is_open())
+	{
+		m_stats.misses++;
+		return 0;
+	}
+
+	FileHeader header{};
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+	if (!file.good() || header.magic != MAGIC || header.version != VERSION || header.key != key)
+	{
+		m_stats.misses++;
+		return 0;
+	}
+
+	std::vector<char> binary(header.binary_size);
+	file.read(binary.data(), binary.size());
+
+	if (!file.good())
+	{
+		m_stats.misses++;
+		return 0;
+	}
+
+	uint32_t program = glCreateProgram();
+	glProgramBinary(program, header.binary_format, binary.data(), static_cast<int32_t>(binary.size()));
+
+	// a driver update invalidates the binaries without changing the version string on some drivers
+	int success = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if (!success)
+	{
+		glDeleteProgram(program);
+
+		m_stats.rejected++;
+		m_stats.misses++;
+		return 0;
+	}
+
+	m_stats.hits++;
+
+	return program;
+}
+
+void ProgramCache::store(uint64_t key, uint32_t program)
+{
+	init();
+
+	if (!m_enabled || !m_binary_supported)
+	{
+		return;
+	}
+
+	int binary_size = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binary_size);
+	if (binary_size <= 0)
+	{
+		return;
+	}
+
+	std::vector<char> binary(static_cast<size_t>(binary_size));
+
+	GLenum binary_format = 0;
+	glGetProgramBinary(program, binary_size, nullptr, &binary_format, binary.data());
+
+	FileHeader header{};
+	header.magic = MAGIC;
+	header.version = VERSION;
+	header.key = key;
+	header.binary_format = binary_format;
+	header.binary_size = static_cast<uint32_t>(binary_size);
+
+	// same temporary file + rename as the mesh cache, a crash never leaves a truncated binary behind
+	const std::string path = get_path(key);
+	const std::string temp_path = path + ".tmp";
+	{
+		std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			std::cout << "Failed to open program cache for writing : " << temp_path << '\n';
+			return;
+		}
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(binary.data(), binary.size());
+
+		if (!file.good())
+		{
+			std::cout << "Failed to write program cache : " << temp_path << '\n';
+			return;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temp_path, path, error);
+	if (error)
+	{
+		std::cout << "Failed to move program cache into place : " << path << " (" << error.message() << ")\n";
+		std::filesystem::remove(temp_path, error);
+	}
+}
+
+void ProgramCache::set_enabled(bool enabled)
+{
+	m_enabled = enabled;
+}
+
+bool ProgramCache::is_enabled() const
+{
+	return m_enabled;
+}
+
+bool ProgramCache::has_parallel_compile()
+{
+	init();
+	return m_parallel_compile;
+}
+
+const ProgramCacheStats& ProgramCache::get_stats() const
+{
+	return m_stats;
+}
+
+uint64_t ProgramCache::hash(std::string_view data, uint64_t seed)
+{
+	// 64 bit FNV-1a, continued from seed
+	uint64_t hash = seed;
+	for (char c : data)
+	{
+		hash ^= static_cast<uint8_t>(c);
+		hash *= 0x100000001b3ull;
+	}
+
+	return hash;
+}
+
+std::string ProgramCache::get_path(uint64_t key) const
+{
+	char name[32];
+	std::snprintf(name, sizeof(name), "%016llx.glprogram", static_cast<unsigned long long>(key));
+
+	return std::string(CACHE_DIRECTORY) + '/' + name;
+}
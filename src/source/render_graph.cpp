@@ -0,0 +1,507 @@
+#include "../include/render_graph.hpp"
+#include "../include/profiler.hpp"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <queue>
+
+RenderPassBuilder::RenderPassBuilder(RenderGraph& graph, uint32_t pass_index)
+	: m_graph(graph), m_pass_index(pass_index)
+{
+}
+
+RenderGraphResource RenderPassBuilder::create(const std::string& name, const RenderTargetDesc& desc)
+{
+	RenderGraph::Resource resource{};
+	resource.name = name;
+	resource.desc = desc;
+	resource.physical = RenderGraphResource::INVALID;
+
+	m_graph.m_resources.push_back(resource);
+	return RenderGraphResource{ static_cast<uint32_t>(m_graph.m_resources.size() - 1) };
+}
+
+void RenderPassBuilder::read(RenderGraphResource resource)
+{
+	m_graph.m_passes[m_pass_index].reads.push_back(resource.index);
+}
+
+void RenderPassBuilder::write_color(RenderGraphResource resource)
+{
+	write(resource);
+	m_graph.m_passes[m_pass_index].color_outputs.push_back(resource.index);
+}
+
+void RenderPassBuilder::write_depth(RenderGraphResource resource)
+{
+	write(resource);
+	m_graph.m_passes[m_pass_index].depth_output = resource.index;
+}
+
+void RenderPassBuilder::write(RenderGraphResource resource)
+{
+	RenderGraph::Pass& pass = m_graph.m_passes[m_pass_index];
+	pass.writes.push_back(resource.index);
+
+	if (m_graph.m_resources[resource.index].backbuffer)
+	{
+		pass.side_effect = true;
+	}
+}
+
+void RenderPassBuilder::set_side_effect()
+{
+	m_graph.m_passes[m_pass_index].side_effect = true;
+}
+
+RenderGraph::RenderGraph()
+	: m_stats{}
+{
+}
+
+RenderGraph::~RenderGraph()
+{
+	destroy_framebuffers();
+
+	for (const PhysicalTexture& physical : m_pool)
+	{
+		glDeleteTextures(1, &physical.texture);
+	}
+}
+
+void RenderGraph::reset()
+{
+	m_resources.clear();
+	m_passes.clear();
+	m_order.clear();
+
+	// age the pool, anything that sat unused for a while (old sizes after a resize, disabled passes) is freed
+	bool deleted = false;
+	for (PhysicalTexture& physical : m_pool)
+	{
+		physical.unused_frames = physical.in_use ? 0 : physical.unused_frames + 1;
+		physical.in_use = false;
+
+		if (physical.unused_frames > MAX_UNUSED_FRAMES)
+		{
+			glDeleteTextures(1, &physical.texture);
+			physical.texture = 0;
+			deleted = true;
+		}
+	}
+
+	if (deleted)
+	{
+		m_pool.erase(std::remove_if(m_pool.begin(), m_pool.end(), [](const PhysicalTexture& physical) { return physical.texture == 0; }), m_pool.end());
+
+		// framebuffers may point at deleted textures
+		destroy_framebuffers();
+	}
+}
+
+RenderGraphResource RenderGraph::import_texture(const std::string& name, uint32_t texture, const RenderTargetDesc& desc)
+{
+	Resource resource{};
+	resource.name = name;
+	resource.desc = desc;
+	resource.imported = true;
+	resource.texture = texture;
+	resource.physical = RenderGraphResource::INVALID;
+
+	m_resources.push_back(resource);
+	return RenderGraphResource{ static_cast<uint32_t>(m_resources.size() - 1) };
+}
+
+RenderGraphResource RenderGraph::import_backbuffer(uint32_t width, uint32_t height, uint32_t framebuffer)
+{
+	RenderGraphResource resource = import_texture("backbuffer", framebuffer, { width, height, GL_RGBA8 });
+	m_resources[resource.index].backbuffer = true;
+
+	return resource;
+}
+
+void RenderGraph::add_pass(const std::string& name, const SetupFn& setup, ExecuteFn execute)
+{
+	Pass pass{};
+	pass.name = name;
+	pass.execute = std::move(execute);
+	pass.depth_output = RenderGraphResource::INVALID;
+
+	m_passes.push_back(std::move(pass));
+
+	RenderPassBuilder builder(*this, static_cast<uint32_t>(m_passes.size() - 1));
+	setup(builder);
+}
+
+void RenderGraph::compile()
+{
+	// a pass depends on every writer of what it reads, and on the writers / readers of what it writes that were
+	// added before it (writes to a resource happen in the order the passes were added)
+	std::vector<std::vector<uint32_t>> dependencies(m_passes.size());
+
+	for (uint32_t i = 0; i < m_passes.size(); i++)
+	{
+		for (uint32_t j = 0; j < m_passes.size(); j++)
+		{
+			if (i == j)
+			{
+				continue;
+			}
+
+			const Pass& pass = m_passes[i];
+			const Pass& other = m_passes[j];
+
+			auto touches = [](const std::vector<uint32_t>& resources, const std::vector<uint32_t>& others)
+			{
+				return std::find_first_of(resources.begin(), resources.end(), others.begin(), others.end()) != resources.end();
+			};
+
+			const bool reads_output = touches(pass.reads, other.writes);
+			const bool ordered_write = j < i && (touches(pass.writes, other.writes) || touches(pass.writes, other.reads));
+
+			if (reads_output || ordered_write)
+			{
+				dependencies[i].push_back(j);
+			}
+		}
+	}
+
+	cull_passes(dependencies);
+	sort_passes(dependencies);
+	assign_physical_textures();
+}
+
+void RenderGraph::execute()
+{
+	for (uint32_t pass_index : m_order)
+	{
+		const Pass& pass = m_passes[pass_index];
+		ProfileScope scope(pass.name);
+
+		if (!pass.color_outputs.empty() || pass.depth_output != RenderGraphResource::INVALID)
+		{
+			const uint32_t first_output = pass.color_outputs.empty() ? pass.depth_output : pass.color_outputs[0];
+			const RenderTargetDesc& desc = m_resources[first_output].desc;
+
+			glBindFramebuffer(GL_FRAMEBUFFER, get_framebuffer(pass));
+			glViewport(0, 0, desc.width, desc.height);
+		}
+
+		pass.execute(*this);
+	}
+}
+
+uint32_t RenderGraph::get_texture(RenderGraphResource resource) const
+{
+	const Resource& graph_resource = m_resources[resource.index];
+	if (graph_resource.imported)
+	{
+		return graph_resource.texture;
+	}
+
+	return graph_resource.physical != RenderGraphResource::INVALID ? m_pool[graph_resource.physical].texture : 0;
+}
+
+const RenderTargetDesc& RenderGraph::get_desc(RenderGraphResource resource) const
+{
+	return m_resources[resource.index].desc;
+}
+
+const RenderGraphStats& RenderGraph::get_stats() const
+{
+	return m_stats;
+}
+
+uint64_t RenderGraph::get_byte_size(const RenderTargetDesc& desc)
+{
+	uint64_t bytes_per_pixel = 4;
+	switch (desc.format)
+	{
+	case GL_RGBA32F:
+		bytes_per_pixel = 16;
+		break;
+	case GL_RGBA16F:
+	case GL_RGB16F:
+	case GL_DEPTH32F_STENCIL8:
+		bytes_per_pixel = 8;
+		break;
+	case GL_R16F:
+	case GL_DEPTH_COMPONENT16:
+		bytes_per_pixel = 2;
+		break;
+	case GL_R8:
+		bytes_per_pixel = 1;
+		break;
+	default:
+		// RGBA8, R11G11B10F, RGB10A2, DEPTH24_STENCIL8, DEPTH32F, R32F, ...
+		break;
+	}
+
+	return bytes_per_pixel * desc.width * desc.height;
+}
+
+void RenderGraph::cull_passes(const std::vector<std::vector<uint32_t>>& dependencies)
+{
+	// walk back from the passes with side effects, everything not reached has no consumer
+	std::vector<uint32_t> stack;
+	for (uint32_t i = 0; i < m_passes.size(); i++)
+	{
+		m_passes[i].culled = !m_passes[i].side_effect;
+		if (m_passes[i].side_effect)
+		{
+			stack.push_back(i);
+		}
+	}
+
+	while (!stack.empty())
+	{
+		const uint32_t pass_index = stack.back();
+		stack.pop_back();
+
+		for (uint32_t dependency : dependencies[pass_index])
+		{
+			if (m_passes[dependency].culled)
+			{
+				m_passes[dependency].culled = false;
+				stack.push_back(dependency);
+			}
+		}
+	}
+}
+
+void RenderGraph::sort_passes(const std::vector<std::vector<uint32_t>>& dependencies)
+{
+	// Kahn's algorithm, preferring the order passes were added in when several are ready
+	std::vector<uint32_t> pending(m_passes.size(), 0);
+	std::vector<std::vector<uint32_t>> dependents(m_passes.size());
+
+	for (uint32_t i = 0; i < m_passes.size(); i++)
+	{
+		for (uint32_t dependency : dependencies[i])
+		{
+			pending[i]++;
+			dependents[dependency].push_back(i);
+		}
+	}
+
+	std::priority_queue<uint32_t, std::vector<uint32_t>, std::greater<uint32_t>> ready;
+	for (uint32_t i = 0; i < m_passes.size(); i++)
+	{
+		if (pending[i] == 0)
+		{
+			ready.push(i);
+		}
+	}
+
+	std::vector<uint32_t> order;
+	while (!ready.empty())
+	{
+		const uint32_t pass_index = ready.top();
+		ready.pop();
+
+		order.push_back(pass_index);
+
+		for (uint32_t dependent : dependents[pass_index])
+		{
+			if (--pending[dependent] == 0)
+			{
+				ready.push(dependent);
+			}
+		}
+	}
+
+	if (order.size() != m_passes.size())
+	{
+		std::cout << "Render graph has a dependency cycle, running passes in the order they were added\n";
+
+		order.clear();
+		for (uint32_t i = 0; i < m_passes.size(); i++)
+		{
+			order.push_back(i);
+		}
+	}
+
+	m_order.clear();
+	m_stats = {};
+
+	for (uint32_t pass_index : order)
+	{
+		if (m_passes[pass_index].culled)
+		{
+			m_stats.culled_pass_count++;
+			continue;
+		}
+
+		m_order.push_back(pass_index);
+	}
+
+	m_stats.pass_count = static_cast<uint32_t>(m_order.size());
+}
+
+void RenderGraph::assign_physical_textures()
+{
+	for (Resource& resource : m_resources)
+	{
+		resource.first_use = RenderGraphResource::INVALID;
+		resource.last_use = 0;
+	}
+
+	for (uint32_t position = 0; position < m_order.size(); position++)
+	{
+		const Pass& pass = m_passes[m_order[position]];
+
+		for (const std::vector<uint32_t>* resources : { &pass.reads, &pass.writes })
+		{
+			for (uint32_t resource_index : *resources)
+			{
+				Resource& resource = m_resources[resource_index];
+				resource.first_use = std::min(resource.first_use, position);
+				resource.last_use = std::max(resource.last_use, position);
+			}
+		}
+	}
+
+	// hand out pooled textures in execution order, returning them after the last pass that uses them so later
+	// transients with the same description reuse them
+	for (uint32_t position = 0; position < m_order.size(); position++)
+	{
+		for (Resource& resource : m_resources)
+		{
+			if (!resource.imported && resource.first_use == position)
+			{
+				resource.physical = acquire_physical(resource.desc);
+
+				m_stats.transient_count++;
+				m_stats.transient_bytes += get_byte_size(resource.desc);
+			}
+		}
+
+		for (Resource& resource : m_resources)
+		{
+			if (!resource.imported && resource.last_use == position && resource.physical != RenderGraphResource::INVALID)
+			{
+				m_pool[resource.physical].in_use = false;
+			}
+		}
+	}
+
+	// in_use now marks what this frame touched, for reset to age the rest
+	m_stats.physical_count = 0;
+	m_stats.physical_bytes = 0;
+
+	for (const Resource& resource : m_resources)
+	{
+		if (!resource.imported && resource.physical != RenderGraphResource::INVALID)
+		{
+			m_pool[resource.physical].in_use = true;
+		}
+	}
+
+	for (const PhysicalTexture& physical : m_pool)
+	{
+		if (physical.in_use)
+		{
+			m_stats.physical_count++;
+			m_stats.physical_bytes += get_byte_size(physical.desc);
+		}
+	}
+}
+
+uint32_t RenderGraph::acquire_physical(const RenderTargetDesc& desc)
+{
+	for (uint32_t i = 0; i < m_pool.size(); i++)
+	{
+		if (!m_pool[i].in_use && m_pool[i].desc == desc)
+		{
+			m_pool[i].in_use = true;
+			return i;
+		}
+	}
+
+	PhysicalTexture physical{};
+	physical.desc = desc;
+	physical.in_use = true;
+
+	glCreateTextures(GL_TEXTURE_2D, 1, &physical.texture);
+	glTextureStorage2D(physical.texture, 1, desc.format, desc.width, desc.height);
+	glTextureParameteri(physical.texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTextureParameteri(physical.texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTextureParameteri(physical.texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(physical.texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	m_pool.push_back(physical);
+	return static_cast<uint32_t>(m_pool.size() - 1);
+}
+
+uint32_t RenderGraph::get_framebuffer(const Pass& pass)
+{
+	for (uint32_t output : pass.color_outputs)
+	{
+		if (m_resources[output].backbuffer)
+		{
+			return m_resources[output].texture;
+		}
+	}
+
+	std::vector<uint32_t> attachments;
+	for (uint32_t output : pass.color_outputs)
+	{
+		attachments.push_back(get_texture(RenderGraphResource{ output }));
+	}
+
+	const uint32_t depth_texture = pass.depth_output != RenderGraphResource::INVALID ? get_texture(RenderGraphResource{ pass.depth_output }) : 0;
+	attachments.push_back(depth_texture);
+
+	auto it = m_framebuffers.find(attachments);
+	if (it != m_framebuffers.end())
+	{
+		return it->second;
+	}
+
+	uint32_t fbo = 0;
+	glCreateFramebuffers(1, &fbo);
+
+	std::vector<uint32_t> draw_buffers;
+	for (uint32_t i = 0; i + 1 < attachments.size(); i++)
+	{
+		glNamedFramebufferTexture(fbo, GL_COLOR_ATTACHMENT0 + i, attachments[i], 0);
+		draw_buffers.push_back(GL_COLOR_ATTACHMENT0 + i);
+	}
+
+	if (depth_texture != 0)
+	{
+		const uint32_t depth_format = m_resources[pass.depth_output].desc.format;
+		const bool has_stencil = depth_format == GL_DEPTH24_STENCIL8 || depth_format == GL_DEPTH32F_STENCIL8;
+		glNamedFramebufferTexture(fbo, has_stencil ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT, depth_texture, 0);
+	}
+
+	if (draw_buffers.empty())
+	{
+		glNamedFramebufferDrawBuffer(fbo, GL_NONE);
+	}
+	else
+	{
+		glNamedFramebufferDrawBuffers(fbo, static_cast<int32_t>(draw_buffers.size()), draw_buffers.data());
+	}
+
+	if (glCheckNamedFramebufferStatus(fbo, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "Render graph framebuffer for pass " << pass.name << " is not complete\n";
+	}
+
+	m_framebuffers.emplace(std::move(attachments), fbo);
+	return fbo;
+}
+
+void RenderGraph::destroy_framebuffers()
+{
+	for (const auto& [attachments, fbo] : m_framebuffers)
+	{
+		glDeleteFramebuffers(1, &fbo);
+	}
+
+	m_framebuffers.clear();
+}
@@ -0,0 +1,475 @@
+#include "../include/render_queue.hpp"
+#include "../include/profiler.hpp"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+
+RenderQueue::RenderQueue()
+	: m_frustum{}, m_culling_enabled(true), m_bounds_built(false), m_objects_uploaded(false), m_camera_position(0.0f), m_lod_projection_scale(0.0f), m_lod_error_pixels(0.0f), m_object_buffer(0), m_indirect_buffer(0), m_stats{}
+{
+	glCreateBuffers(1, &m_object_buffer);
+	glCreateBuffers(1, &m_indirect_buffer);
+}
+
+RenderQueue::~RenderQueue()
+{
+	glDeleteBuffers(1, &m_object_buffer);
+	glDeleteBuffers(1, &m_indirect_buffer);
+}
+
+uint32_t RenderQueue::add_object(const glm::mat4& transform, const glm::vec3& color)
+{
+	m_objects.push_back({ transform, glm::vec4(color, 1.0f) });
+	return static_cast<uint32_t>(m_objects.size() - 1);
+}
+
+void RenderQueue::submit(Shader& shader, Mesh& mesh, uint32_t object_index)
+{
+	m_items.push_back({ &shader, &mesh, object_index, 0 });
+}
+
+void RenderQueue::set_frustum(const Frustum& frustum)
+{
+	m_frustum = frustum;
+}
+
+void RenderQueue::set_culling_enabled(bool enabled)
+{
+	m_culling_enabled = enabled;
+}
+
+void RenderQueue::set_lod_view(const glm::vec3& camera_position, float fov_y, float viewport_height, float lod_error_pixels)
+{
+	m_camera_position = camera_position;
+	m_lod_projection_scale = viewport_height / (2.0f * std::tan(fov_y * 0.5f));
+	m_lod_error_pixels = lod_error_pixels;
+}
+
+void RenderQueue::flush()
+{
+	draw();
+	clear();
+}
+
+void RenderQueue::draw(OcclusionCuller* occlusion)
+{
+	m_stats = {};
+	m_stats.submitted_items = static_cast<uint32_t>(m_items.size());
+
+	// world space bounds are needed for LOD selection as well, so they are built even without culling
+	build_bounds();
+
+	// the occluders are picked among the items in view
+	if (m_culling_enabled || occlusion != nullptr)
+	{
+		m_culler.cull(m_frustum);
+	}
+
+	if (occlusion != nullptr && occlusion->get_mode() == OcclusionMode::Cpu && !occlusion->is_tested())
+	{
+		cull_occluded(*occlusion);
+	}
+
+	// sort (key, index) pairs rather than the items themselves, they are much smaller
+	m_sort_keys.clear();
+	m_sort_keys.reserve(m_items.size());
+
+	for (uint32_t i = 0; i < m_items.size(); i++)
+	{
+		if ((m_culling_enabled && !m_culler.is_visible(i)) || is_occluded(i, occlusion))
+		{
+			m_stats.culled_items++;
+			continue;
+		}
+
+		DrawItem& item = m_items[i];
+		item.lod = select_lod(item, m_culler.get_world_sphere(i));
+
+		m_stats.triangles += item.mesh->get_index_count(item.lod) / 3;
+		m_stats.full_detail_triangles += item.mesh->get_index_count() / 3;
+
+		m_sort_keys.emplace_back(make_sort_key(item.shader->get_program(), item.mesh->get_material_id(), item.mesh->get_vao()), i);
+	}
+
+	std::sort(m_sort_keys.begin(), m_sort_keys.end());
+
+	draw_batches(m_items, false, m_stats, occlusion);
+
+	Profiler::get().add_draws(m_stats.draw_calls, m_stats.triangles);
+}
+
+void RenderQueue::clear()
+{
+	m_items.clear();
+	m_objects.clear();
+
+	m_bounds_built = false;
+	m_objects_uploaded = false;
+}
+
+uint32_t RenderQueue::draw_depth(Shader& shader, Shader& alpha_test_shader, const Frustum& frustum, OcclusionCuller* occlusion)
+{
+	build_bounds();
+	m_culler.cull(frustum);
+
+	if (occlusion != nullptr && occlusion->get_mode() == OcclusionMode::Cpu && !occlusion->is_tested())
+	{
+		cull_occluded(*occlusion);
+	}
+
+	// LODs are still picked from the camera, a caster far from it is coarse in its shadow as well
+	RenderQueueStats stats{};
+	uint32_t drawn_items = 0;
+
+	m_depth_items.resize(m_items.size());
+	m_sort_keys.clear();
+	m_sort_keys.reserve(m_items.size());
+
+	for (uint32_t i = 0; i < m_items.size(); i++)
+	{
+		if (!m_culler.is_visible(i) || is_occluded(i, occlusion))
+		{
+			continue;
+		}
+
+		DrawItem item = m_items[i];
+		item.lod = select_lod(item, m_culler.get_world_sphere(i));
+		item.shader = is_alpha_tested(item) ? &alpha_test_shader : &shader;
+
+		stats.triangles += item.mesh->get_index_count(item.lod) / 3;
+
+		m_sort_keys.emplace_back(make_sort_key(item.shader->get_program(), get_batch_material(item, true), item.mesh->get_vao()), i);
+		m_depth_items[i] = item;
+
+		drawn_items++;
+	}
+
+	std::sort(m_sort_keys.begin(), m_sort_keys.end());
+
+	draw_batches(m_depth_items, true, stats, occlusion);
+
+	Profiler::get().add_draws(stats.draw_calls, stats.triangles);
+
+	return drawn_items;
+}
+
+uint32_t RenderQueue::get_item_count() const
+{
+	return static_cast<uint32_t>(m_items.size());
+}
+
+uint64_t RenderQueue::get_scene_hash() const
+{
+	// FNV-1a over the transforms and the geometry each item draws
+	uint64_t hash = 0xcbf29ce484222325ull;
+
+	const auto add = [&hash](const void* data, size_t size)
+	{
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		for (size_t i = 0; i < size; i++)
+		{
+			hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+		}
+	};
+
+	add(m_objects.data(), sizeof(ObjectData) * m_objects.size());
+
+	for (const DrawItem& item : m_items)
+	{
+		const uint32_t geometry[4] = { item.mesh->get_vao(), item.mesh->get_first_index(), item.mesh->get_index_count(), item.object_index };
+		add(geometry, sizeof(geometry));
+	}
+
+	return hash;
+}
+
+const RenderQueueStats& RenderQueue::get_stats() const
+{
+	return m_stats;
+}
+
+uint32_t RenderQueue::select_lod(const DrawItem& item, const glm::vec4& world_sphere) const
+{
+	if (m_lod_error_pixels <= 0.0f || item.mesh->get_lod_count() == 1)
+	{
+		return 0;
+	}
+
+	// nearest point of the bounding sphere, inside the sphere the mesh is always drawn at full detail
+	const float distance = glm::length(glm::vec3(world_sphere) - m_camera_position) - world_sphere.w;
+	if (distance <= 0.0f)
+	{
+		return 0;
+	}
+
+	// world space error that projects to the pixel threshold at that distance, brought into the space of the mesh's
+	// draw bounds through the largest scale of the object transform
+	const glm::mat4& transform = m_objects[item.object_index].model_mat;
+	const float max_scale = glm::max(glm::max(glm::length(glm::vec3(transform[0])), glm::length(glm::vec3(transform[1]))), glm::length(glm::vec3(transform[2])));
+
+	const float max_world_error = m_lod_error_pixels * distance / m_lod_projection_scale;
+	return item.mesh->select_lod(max_world_error / max_scale);
+}
+
+void RenderQueue::draw_batches(const std::vector<DrawItem>& items, bool depth_only, RenderQueueStats& stats, OcclusionCuller* occlusion)
+{
+	// one command per item in sorted order, base_instance carries the object index to the shaders
+	m_commands.clear();
+	m_commands.reserve(m_sort_keys.size());
+
+	for (const auto& [sort_key, index] : m_sort_keys)
+	{
+		const DrawItem& item = items[index];
+		m_commands.push_back({ item.mesh->get_index_count(item.lod), 1, item.mesh->get_first_index(item.lod), static_cast<int32_t>(item.mesh->get_base_vertex()), item.object_index });
+	}
+
+	upload_objects();
+
+	// orphan and refill every draw, the commands differ between views
+	glNamedBufferData(m_indirect_buffer, sizeof(DrawElementsIndirectCommand) * m_commands.size(), m_commands.data(), GL_STREAM_DRAW);
+
+	if (occlusion == nullptr || occlusion->get_mode() != OcclusionMode::Gpu)
+	{
+		submit_batches(items, depth_only, stats);
+		return;
+	}
+
+	m_occlusion_items.clear();
+	m_occlusion_bounds.clear();
+
+	for (const auto& [sort_key, index] : m_sort_keys)
+	{
+		m_occlusion_items.push_back(index);
+		m_occlusion_bounds.push_back(m_culler.get_world_bounds(index));
+	}
+
+	// phase one : what was visible at the last test
+	occlusion->set_commands(m_indirect_buffer, m_occlusion_items, m_occlusion_bounds);
+	occlusion->apply_visibility();
+	submit_batches(items, depth_only, stats);
+
+	// phase two, for the first occluded draw of the frame : test against the depth phase one wrote, and draw what
+	// became visible
+	if (!occlusion->is_tested())
+	{
+		occlusion->test();
+
+		RenderQueueStats second_phase_stats{};
+		submit_batches(items, depth_only, second_phase_stats);
+		stats.second_phase_draw_calls += second_phase_stats.draw_calls;
+	}
+}
+
+void RenderQueue::submit_batches(const std::vector<DrawItem>& items, bool depth_only, RenderQueueStats& stats)
+{
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirect_buffer);
+
+	// GL state is unknown at the start of a flush, so the first use of everything is always bound
+	Shader* current_shader = nullptr;
+	uint32_t current_material = UNBOUND;
+	uint32_t current_vao = UNBOUND;
+
+	uint32_t bound_textures[MAX_TEXTURE_UNITS];
+	std::fill(std::begin(bound_textures), std::end(bound_textures), UNBOUND);
+
+	uint32_t batch_start = 0;
+	while (batch_start < m_sort_keys.size())
+	{
+		const DrawItem& item = items[m_sort_keys[batch_start].second];
+		Mesh& mesh = *item.mesh;
+		const uint32_t material = get_batch_material(item, depth_only);
+
+		// extend the batch over every following item with the same shader, material and vao
+		uint32_t batch_end = batch_start + 1;
+		while (batch_end < m_sort_keys.size())
+		{
+			const DrawItem& next_item = items[m_sort_keys[batch_end].second];
+			if (next_item.shader != item.shader || get_batch_material(next_item, depth_only) != material || next_item.mesh->get_vao() != mesh.get_vao())
+			{
+				break;
+			}
+
+			batch_end++;
+		}
+
+		const uint32_t batch_size = batch_end - batch_start;
+
+		if (item.shader != current_shader)
+		{
+			item.shader->use();
+
+			// sampler bindings belong to the program, so start over for the new one
+			current_shader = item.shader;
+			current_material = UNBOUND;
+
+			stats.shader_binds++;
+		}
+		else
+		{
+			stats.skipped_shader_binds++;
+		}
+
+		if (material == NO_MATERIAL)
+		{
+			// depth only and opaque, the textures are of no use
+		}
+		else if (material != current_material)
+		{
+			mesh.bind_samplers(*item.shader);
+
+			const std::vector<uint32_t>& texture_units = mesh.get_texture_units();
+			for (uint32_t i = 0; i < mesh.m_textures.size(); i++)
+			{
+				const uint32_t unit = texture_units[i];
+				const uint32_t texture_id = mesh.m_textures[i].texture_id;
+
+				if (unit < MAX_TEXTURE_UNITS && bound_textures[unit] == texture_id)
+				{
+					stats.skipped_texture_binds++;
+					continue;
+				}
+
+				glActiveTexture(GL_TEXTURE0 + unit);
+				glBindTexture(GL_TEXTURE_2D, texture_id);
+
+				if (unit < MAX_TEXTURE_UNITS)
+				{
+					bound_textures[unit] = texture_id;
+				}
+
+				stats.texture_binds++;
+			}
+
+			current_material = material;
+			stats.material_binds++;
+		}
+		else
+		{
+			stats.skipped_material_binds++;
+		}
+
+		if (mesh.get_vao() != current_vao)
+		{
+			glBindVertexArray(mesh.get_vao());
+			current_vao = mesh.get_vao();
+
+			stats.vao_binds++;
+		}
+		else
+		{
+			stats.skipped_vao_binds++;
+		}
+
+		// items merged into the batch would each have needed their own binds and draw
+		stats.skipped_shader_binds += batch_size - 1;
+		stats.skipped_material_binds += batch_size - 1;
+		stats.skipped_vao_binds += batch_size - 1;
+
+		const uintptr_t command_offset = sizeof(DrawElementsIndirectCommand) * batch_start;
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, reinterpret_cast<const void*>(command_offset), static_cast<int32_t>(batch_size), 0);
+
+		stats.draw_calls++;
+		stats.draw_commands += batch_size;
+
+		batch_start = batch_end;
+	}
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	glActiveTexture(GL_TEXTURE0);
+}
+
+void RenderQueue::cull_occluded(OcclusionCuller& occlusion)
+{
+	m_occluded.assign(m_items.size(), 0);
+
+	// the items in view covering the most screen occlude the most, alpha tested ones have holes
+	m_occluder_candidates.clear();
+
+	for (uint32_t i = 0; i < m_items.size(); i++)
+	{
+		if (!m_culler.is_visible(i) || is_alpha_tested(m_items[i]))
+		{
+			continue;
+		}
+
+		const glm::vec4 sphere = m_culler.get_world_sphere(i);
+		const float distance = std::max(glm::length(glm::vec3(sphere) - m_camera_position) - sphere.w, 1e-3f);
+
+		m_occluder_candidates.emplace_back(sphere.w / distance, i);
+	}
+
+	const size_t occluder_count = std::min<size_t>(m_occluder_candidates.size(), OcclusionCuller::MAX_OCCLUDERS);
+	std::partial_sort(m_occluder_candidates.begin(), m_occluder_candidates.begin() + occluder_count, m_occluder_candidates.end(), std::greater<>());
+
+	for (size_t i = 0; i < occluder_count; i++)
+	{
+		const DrawItem& item = m_items[m_occluder_candidates[i].second];
+		occlusion.add_occluder(*item.mesh, m_objects[item.object_index].model_mat);
+	}
+
+	occlusion.test();
+
+	for (uint32_t i = 0; i < m_items.size(); i++)
+	{
+		if (m_culler.is_visible(i) && !occlusion.is_visible(m_culler.get_world_bounds(i)))
+		{
+			m_occluded[i] = 1;
+		}
+	}
+}
+
+bool RenderQueue::is_occluded(uint32_t index, const OcclusionCuller* occlusion) const
+{
+	return occlusion != nullptr && occlusion->get_mode() == OcclusionMode::Cpu && m_occluded[index] != 0;
+}
+
+bool RenderQueue::is_alpha_tested(const DrawItem& item)
+{
+	return (item.mesh->get_shader_keywords() & ShaderKeywords::ALPHA_TEST) != 0;
+}
+
+uint32_t RenderQueue::get_batch_material(const DrawItem& item, bool depth_only)
+{
+	return depth_only && !is_alpha_tested(item) ? NO_MATERIAL : item.mesh->get_material_id();
+}
+
+void RenderQueue::build_bounds()
+{
+	if (m_bounds_built)
+	{
+		return;
+	}
+
+	m_culler.clear();
+	for (const DrawItem& item : m_items)
+	{
+		m_culler.add(item.mesh->get_draw_bounds(), item.mesh->get_draw_sphere(), m_objects[item.object_index].model_mat);
+	}
+
+	m_bounds_built = true;
+}
+
+void RenderQueue::upload_objects()
+{
+	// orphan and refill once per frame, the data is rebuilt from scratch anyway
+	if (!m_objects_uploaded)
+	{
+		glNamedBufferData(m_object_buffer, sizeof(ObjectData) * m_objects.size(), m_objects.data(), GL_STREAM_DRAW);
+		m_objects_uploaded = true;
+	}
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, OBJECT_BUFFER_BINDING, m_object_buffer);
+}
+
+uint64_t RenderQueue::make_sort_key(uint32_t program, uint32_t material_id, uint32_t vao)
+{
+	// [ program : 16 | material : 24 | vao : 24 ]
+	return (static_cast<uint64_t>(program & 0xffff) << 48) |
+		(static_cast<uint64_t>(material_id & 0xffffff) << 24) |
+		static_cast<uint64_t>(vao & 0xffffff);
+}
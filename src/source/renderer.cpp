@@ -0,0 +1,748 @@
+#include "../include/renderer.hpp"
+#include "../include/asset_cache.hpp"
+#include "../include/profiler.hpp"
+#include "../include/scene_systems.hpp"
+#include "../include/job_system.hpp"
+
+#include <glad/glad.h>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <random>
+
+// GL_ARB_pipeline_statistics_query, core since 4.6
+#ifndef GL_FRAGMENT_SHADER_INVOCATIONS
+#define GL_FRAGMENT_SHADER_INVOCATIONS 0x82F4
+#endif
+
+RenderSettings::RenderSettings()
+	: clear_color(0.1f, 0.6f, 0.8f, 1.0f), light_position(0.0f, 10.0f, 0.0f), light_color(1.0f), light_intensity(1.0f), height_scale(0.01f),
+	  point_light_count(256), point_light_radius(8.0f), point_light_intensity(4.0f), animate_point_lights(true),
+	  sun_direction(-0.3f, -1.0f, -0.2f), sun_color(1.0f, 0.95f, 0.85f), sun_intensity(1.5f), shadows(true),
+	  shadow_cascade_count(static_cast<int>(ShadowRenderer::MAX_CASCADES)), shadow_resolution(static_cast<int>(ShadowRenderer::DEFAULT_RESOLUTION)),
+	  shadow_distance(150.0f), shadow_split_lambda(0.75f), depth_prepass(true),
+	  occlusion_culling(static_cast<int>(OcclusionMode::Gpu)),
+	  cube_position(0.0f, 10.0f, 1.0f), cube_scale(1.0f), cube_color(1.0f), object_count(0), frustum_culling(true), lod_error_pixels(1.0f),
+	  exposure(1.0f), bloom_intensity(0.0f), spread(0.0f), bloom_mip_count(static_cast<int>(BloomRenderer::DEFAULT_MIP_COUNT)),
+	  gaussian_bloom(false), compare_bloom(false), hdr_precision(static_cast<int>(HdrPrecision::Half)), half_res_bright(false),
+	  validate_precision(false)
+{
+}
+
+Renderer::Renderer(uint32_t width, uint32_t height)
+	: m_time(0.0f), m_light_shader("../shaders/light_vertex.glsl", "../shaders/light_fragment.glsl"),
+	  m_scene_shaders("../shaders/test_packed_vertex.glsl", "../shaders/test_fragment.glsl"),
+	  m_depth_shaders("../shaders/depth_vertex.glsl", "../shaders/depth_fragment.glsl"), m_opaque_depth_shader(nullptr), m_alpha_test_depth_shader(nullptr),
+	  m_offscreen_fb_shader("../shaders/offscreen_vertex.glsl", "../shaders/offscreen_fragment.glsl"),
+	  m_bright_extract_shader("../shaders/offscreen_vertex.glsl", "../shaders/bright_extract_fragment.glsl"),
+	  m_offscreen_rt(HdrFormatPolicy{ static_cast<HdrPrecision>(m_settings.hdr_precision), m_settings.half_res_bright }),
+	  m_shadow_renderer(ShadowRenderer::DEFAULT_RESOLUTION, ShadowRenderer::MAX_CASCADES),
+	  m_bloom_renderer(width, height, BloomRenderer::DEFAULT_MIP_COUNT, m_offscreen_rt.policy.get_bloom_format()), m_view_frustum{}, m_view_projection(1.0f),
+	  m_prepass_invocations(GL_FRAGMENT_SHADER_INVOCATIONS), m_color_invocations{ GpuCounter(GL_FRAGMENT_SHADER_INVOCATIONS), GpuCounter(GL_FRAGMENT_SHADER_INVOCATIONS) },
+	  m_reference_policy{ HdrPrecision::Full, false }, m_precision_difference{}
+{
+	SceneSystems::register_components(m_registry);
+
+	const std::shared_ptr<Model> cube_model = AssetCache::get().acquire_model("../assets/models/cube/Cube.gltf");
+
+	m_sponza = m_registry.create();
+	m_registry.add(m_sponza, TransformComponent::make(glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(0.05f)));
+	m_registry.add(m_sponza, MeshRendererComponent{ AssetCache::get().acquire_model("../assets/models/sponza/glTF/Sponza.gltf", VertexFormat::PackedQuantized),
+		nullptr, &m_scene_shaders, glm::vec3(1.0f) });
+	m_registry.add(m_sponza, BoundsComponent{});
+
+	m_light_source = m_registry.create();
+	m_registry.add(m_light_source, TransformComponent::make(m_settings.light_position));
+	m_registry.add(m_light_source, MeshRendererComponent{ cube_model, &m_light_shader, nullptr, m_settings.light_color });
+	m_registry.add(m_light_source, BoundsComponent{});
+
+	m_cube = m_registry.create();
+	m_registry.add(m_cube, TransformComponent::make(m_settings.cube_position, glm::vec3(0.0f, glm::radians(90.0f), 0.0f), m_settings.cube_scale));
+	m_registry.add(m_cube, MeshRendererComponent{ cube_model, &m_light_shader, nullptr, m_settings.cube_color });
+	m_registry.add(m_cube, BoundsComponent{});
+
+	// the scene bounds place the lights and objects
+	SceneSystems::update_transforms(m_registry);
+	SceneSystems::update_bounds(m_registry);
+
+	// compiling in parallel from the start, the plain variants are the fallbacks of the others
+	m_depth_shaders.get(ShaderKeywords::NONE);
+	m_depth_shaders.get(ShaderKeywords::ALPHA_TEST);
+	m_scene_shaders.get(ShaderKeywords::NONE);
+}
+
+void Renderer::render_frame(Camera& camera, uint32_t width, uint32_t height, uint32_t output_framebuffer, const std::function<void()>& draw_ui)
+{
+	const uint32_t submit_scope = Profiler::get().begin_scope("submit", false);
+
+	submit_scene(camera, width, height);
+
+	m_offscreen_rt.policy.precision = static_cast<HdrPrecision>(m_settings.hdr_precision);
+	m_offscreen_rt.policy.half_res_bright = m_settings.half_res_bright;
+
+	m_bloom_renderer.resize(width, height);
+	m_bloom_renderer.set_mip_count(static_cast<uint32_t>(m_settings.bloom_mip_count));
+	m_bloom_renderer.set_format(m_offscreen_rt.policy.get_bloom_format());
+
+	if (m_settings.validate_precision)
+	{
+		if (!m_reference_bloom_renderer)
+		{
+			m_reference_bloom_renderer = std::make_unique<BloomRenderer>(width, height, static_cast<uint32_t>(m_settings.bloom_mip_count), m_reference_policy.get_bloom_format());
+		}
+
+		m_reference_bloom_renderer->resize(width, height);
+		m_reference_bloom_renderer->set_mip_count(static_cast<uint32_t>(m_settings.bloom_mip_count));
+	}
+	else
+	{
+		m_reference_bloom_renderer.reset();
+	}
+
+	const RenderSettings& settings = m_settings;
+	const HdrFormatPolicy& policy = m_offscreen_rt.policy;
+
+	// frame graph : scene -> (bright) -> bloom -> tonemap -> ui
+	m_render_graph.reset();
+
+	const glm::ivec2 bloom_size = m_bloom_renderer.get_output_size(settings.gaussian_bloom);
+	const RenderGraphResource backbuffer = m_render_graph.import_backbuffer(width, height, output_framebuffer);
+	const RenderGraphResource bloom = m_render_graph.import_texture("bloom", m_bloom_renderer.get_output_texture(settings.gaussian_bloom),
+		{ static_cast<uint32_t>(bloom_size.x), static_cast<uint32_t>(bloom_size.y), m_bloom_renderer.get_format() });
+
+	RenderGraphResource scene_color;
+	RenderGraphResource scene_depth;
+	RenderGraphResource bright;
+	RenderGraphResource shadow_map;
+
+	// the cascades live across frames, so unchanged ones can be kept
+	if (settings.shadows)
+	{
+		const uint32_t shadow_resolution = m_shadow_renderer.get_resolution();
+		shadow_map = m_render_graph.import_texture("shadow_map", m_shadow_renderer.get_texture(), { shadow_resolution, shadow_resolution, GL_DEPTH_COMPONENT32F });
+
+		m_render_graph.add_pass("shadows", [&](RenderPassBuilder& builder)
+		{
+			builder.write(shadow_map);
+		},
+		[&](RenderGraph& graph)
+		{
+			m_shadow_renderer.render(m_render_queue, m_render_queue.get_scene_hash());
+		});
+	}
+
+	m_render_graph.add_pass("scene", [&](RenderPassBuilder& builder)
+	{
+		if (shadow_map.is_valid())
+		{
+			builder.read(shadow_map);
+		}
+
+		scene_color = builder.create("scene_color", policy.get_color_desc(width, height));
+		builder.write_color(scene_color);
+
+		if (!policy.half_res_bright)
+		{
+			bright = builder.create("bright", policy.get_bright_desc(width, height));
+			builder.write_color(bright);
+		}
+
+		scene_depth = builder.create("scene_depth", policy.get_depth_desc(width, height));
+		builder.write_depth(scene_depth);
+	},
+	[&](RenderGraph& graph)
+	{
+		// the Hi-Z pyramid is built from the depth this pass writes
+		m_occlusion_culler.begin_frame(static_cast<OcclusionMode>(settings.occlusion_culling), m_view_projection, m_render_queue.get_item_count(),
+			graph.get_texture(scene_depth), width, height);
+
+		draw_scene(true, &m_occlusion_culler);
+	});
+
+	// a quarter of the pixels to write here and to read in the first bloom level, instead of a second full
+	// resolution attachment on every scene fragment
+	if (policy.half_res_bright)
+	{
+		m_render_graph.add_pass("bright", [&](RenderPassBuilder& builder)
+		{
+			bright = builder.create("bright", policy.get_bright_desc(width, height));
+
+			builder.read(scene_color);
+			builder.write_color(bright);
+		},
+		[&](RenderGraph& graph)
+		{
+			glDisable(GL_DEPTH_TEST);
+			glDisable(GL_BLEND);
+
+			m_bright_extract_shader.use();
+			m_bright_extract_shader.set_float("threshold", BRIGHT_THRESHOLD);
+			m_bright_extract_shader.set_float("intensity", settings.light_intensity);
+
+			glActiveTexture(GL_TEXTURE0);
+			glBindTexture(GL_TEXTURE_2D, graph.get_texture(scene_color));
+			m_bright_extract_shader.set_int("scene_sampler", 0);
+
+			glBindVertexArray(m_offscreen_rt.vao);
+			glDrawArrays(GL_TRIANGLES, 0, 6);
+
+			Profiler::get().add_draws(1, 2);
+		});
+	}
+
+	// the full resolution gaussian is kept to compare against
+	m_render_graph.add_pass("bloom", [&](RenderPassBuilder& builder)
+	{
+		builder.read(bright);
+		builder.write(bloom);
+	},
+	[&](RenderGraph& graph)
+	{
+		render_bloom(m_bloom_renderer, graph.get_texture(bright), settings.gaussian_bloom);
+	});
+
+	// also run the other path (result unused) so both GPU timings are measured on the same frames
+	if (settings.compare_bloom)
+	{
+		m_render_graph.add_pass("bloom_compare", [&](RenderPassBuilder& builder)
+		{
+			builder.read(bright);
+			builder.set_side_effect();
+		},
+		[&](RenderGraph& graph)
+		{
+			render_bloom(m_bloom_renderer, graph.get_texture(bright), !settings.gaussian_bloom);
+		});
+	}
+
+	m_render_graph.add_pass("tonemap", [&](RenderPassBuilder& builder)
+	{
+		builder.read(scene_color);
+
+		// without bloom nothing reads it, and the bloom pass gets culled
+		if (settings.bloom_intensity > 0.0f)
+		{
+			builder.read(bloom);
+		}
+
+		builder.write_color(backbuffer);
+	},
+	[&](RenderGraph& graph)
+	{
+		draw_tonemap(graph.get_texture(scene_color), graph.get_texture(bloom));
+	});
+
+	if (draw_ui)
+	{
+		m_render_graph.add_pass("ui", [&](RenderPassBuilder& builder)
+		{
+			builder.write_color(backbuffer);
+		},
+		[&](RenderGraph& graph)
+		{
+			draw_ui();
+		});
+	}
+
+	// the same frame with 32F targets, both tonemapped to RGBA8 and compared on the CPU. The readback stalls,
+	// which is fine for a debug mode.
+	RenderGraphResource reference_color;
+	RenderGraphResource reference_bright;
+	RenderGraphResource reference_bloom;
+	RenderGraphResource validation_ldr;
+	RenderGraphResource reference_ldr;
+
+	if (settings.validate_precision)
+	{
+		const glm::ivec2 reference_bloom_size = m_reference_bloom_renderer->get_output_size(settings.gaussian_bloom);
+		reference_bloom = m_render_graph.import_texture("reference_bloom", m_reference_bloom_renderer->get_output_texture(settings.gaussian_bloom),
+			{ static_cast<uint32_t>(reference_bloom_size.x), static_cast<uint32_t>(reference_bloom_size.y), m_reference_bloom_renderer->get_format() });
+
+		const RenderTargetDesc ldr_desc{ width, height, GL_RGBA8 };
+
+		m_render_graph.add_pass("scene_reference", [&](RenderPassBuilder& builder)
+		{
+			if (shadow_map.is_valid())
+			{
+				builder.read(shadow_map);
+			}
+
+			reference_color = builder.create("reference_color", m_reference_policy.get_color_desc(width, height));
+			reference_bright = builder.create("reference_bright", m_reference_policy.get_bright_desc(width, height));
+
+			builder.write_color(reference_color);
+			builder.write_color(reference_bright);
+			builder.write_depth(builder.create("reference_depth", m_reference_policy.get_depth_desc(width, height)));
+		},
+		[&](RenderGraph& graph)
+		{
+			draw_scene(false, nullptr);
+		});
+
+		m_render_graph.add_pass("bloom_reference", [&](RenderPassBuilder& builder)
+		{
+			builder.read(reference_bright);
+			builder.write(reference_bloom);
+		},
+		[&](RenderGraph& graph)
+		{
+			render_bloom(*m_reference_bloom_renderer, graph.get_texture(reference_bright), settings.gaussian_bloom);
+		});
+
+		m_render_graph.add_pass("tonemap_validation", [&](RenderPassBuilder& builder)
+		{
+			validation_ldr = builder.create("validation_ldr", ldr_desc);
+
+			builder.read(scene_color);
+			if (settings.bloom_intensity > 0.0f)
+			{
+				builder.read(bloom);
+			}
+
+			builder.write_color(validation_ldr);
+		},
+		[&](RenderGraph& graph)
+		{
+			draw_tonemap(graph.get_texture(scene_color), graph.get_texture(bloom));
+		});
+
+		m_render_graph.add_pass("tonemap_reference", [&](RenderPassBuilder& builder)
+		{
+			reference_ldr = builder.create("reference_ldr", ldr_desc);
+
+			builder.read(reference_color);
+			if (settings.bloom_intensity > 0.0f)
+			{
+				builder.read(reference_bloom);
+			}
+
+			builder.write_color(reference_ldr);
+		},
+		[&](RenderGraph& graph)
+		{
+			draw_tonemap(graph.get_texture(reference_color), graph.get_texture(reference_bloom));
+		});
+
+		m_render_graph.add_pass("precision_compare", [&](RenderPassBuilder& builder)
+		{
+			builder.read(validation_ldr);
+			builder.read(reference_ldr);
+			builder.set_side_effect();
+		},
+		[&](RenderGraph& graph)
+		{
+			const size_t pixel_count = static_cast<size_t>(width) * height;
+			m_validation_pixels.resize(pixel_count * 4);
+			m_reference_pixels.resize(pixel_count * 4);
+
+			glGetTextureImage(graph.get_texture(validation_ldr), 0, GL_RGBA, GL_UNSIGNED_BYTE, static_cast<int32_t>(m_validation_pixels.size()), m_validation_pixels.data());
+			glGetTextureImage(graph.get_texture(reference_ldr), 0, GL_RGBA, GL_UNSIGNED_BYTE, static_cast<int32_t>(m_reference_pixels.size()), m_reference_pixels.data());
+
+			m_precision_difference = compare_rgba8(m_validation_pixels.data(), m_reference_pixels.data(), pixel_count);
+		});
+	}
+
+	Profiler::get().end_scope(submit_scope);
+
+	{
+		ProfileScope scope("compile_graph", false);
+		m_render_graph.compile();
+	}
+
+	m_render_graph.execute();
+
+	m_render_queue.clear();
+}
+
+void Renderer::warm_up(Camera& camera, uint32_t width, uint32_t height, uint32_t output_framebuffer)
+{
+	render_frame(camera, width, height, output_framebuffer, nullptr);
+
+	m_scene_shaders.wait_all();
+	m_depth_shaders.wait_all();
+	m_shadow_renderer.wait_shaders();
+}
+
+RenderSettings& Renderer::get_settings()
+{
+	return m_settings;
+}
+
+void Renderer::set_time(float time)
+{
+	m_time = time;
+}
+
+const RenderQueueStats& Renderer::get_queue_stats() const
+{
+	return m_render_queue.get_stats();
+}
+
+const RenderGraphStats& Renderer::get_graph_stats() const
+{
+	return m_render_graph.get_stats();
+}
+
+const BloomRenderer& Renderer::get_bloom_renderer() const
+{
+	return m_bloom_renderer;
+}
+
+const ImageDifference& Renderer::get_precision_difference() const
+{
+	return m_precision_difference;
+}
+
+size_t Renderer::get_scene_shader_variant_count() const
+{
+	return m_scene_shaders.get_variant_count();
+}
+
+const ClusteredLightingStats& Renderer::get_light_stats() const
+{
+	return m_clustered_lighting.get_stats();
+}
+
+const ShadowStats& Renderer::get_shadow_stats() const
+{
+	return m_shadow_renderer.get_stats();
+}
+
+SceneInvocationStats Renderer::get_invocation_stats() const
+{
+	if (!m_settings.depth_prepass)
+	{
+		return { 0, m_color_invocations[0].get_value(), m_color_invocations[0].get_value() };
+	}
+
+	return { m_prepass_invocations.get_value(), m_color_invocations[1].get_value(), m_color_invocations[0].get_value() };
+}
+
+const OcclusionStats& Renderer::get_occlusion_stats() const
+{
+	return m_occlusion_culler.get_stats();
+}
+
+uint32_t Renderer::get_entity_count() const
+{
+	return m_registry.get_entity_count();
+}
+
+void Renderer::submit_scene(Camera& camera, uint32_t width, uint32_t height)
+{
+	const glm::mat4 view_mat = camera.get_view_mat();
+	const glm::mat4 projection_mat = glm::perspective(glm::radians(camera.get_zoom()), width / (float)height, NEAR_PLANE, FAR_PLANE);
+
+	m_render_queue.set_culling_enabled(m_settings.frustum_culling);
+	m_view_projection = projection_mat * view_mat;
+	m_view_frustum = Frustum::from_matrix(m_view_projection);
+
+	m_render_queue.set_frustum(m_view_frustum);
+	m_render_queue.set_lod_view(camera.m_position, glm::radians(camera.get_zoom()), static_cast<float>(height), m_settings.lod_error_pixels);
+
+	// the settings only dirty the transforms they changed
+	TransformComponent& light_transform = m_registry.get<TransformComponent>(m_light_source);
+	if (light_transform.position != m_settings.light_position)
+	{
+		light_transform.position = m_settings.light_position;
+		light_transform.dirty = true;
+	}
+
+	TransformComponent& cube_transform = m_registry.get<TransformComponent>(m_cube);
+	if (cube_transform.position != m_settings.cube_position || cube_transform.scale != m_settings.cube_scale)
+	{
+		cube_transform.position = m_settings.cube_position;
+		cube_transform.scale = m_settings.cube_scale;
+		cube_transform.dirty = true;
+	}
+
+	m_registry.get<MeshRendererComponent>(m_light_source).color = m_settings.light_color;
+	m_registry.get<MeshRendererComponent>(m_cube).color = m_settings.cube_color;
+
+	update_point_lights();
+	update_objects();
+
+	SceneSystems::update_orbits(m_registry, m_settings.animate_point_lights ? m_time : 0.0f);
+	SceneSystems::update_transforms(m_registry);
+
+	// bounds and lights only read the transforms and write their own components, so they run next to the submission
+	JobCounter scene_jobs;
+	JobSystem::get().submit([this]() { SceneSystems::update_bounds(m_registry); }, scene_jobs);
+	JobSystem::get().submit([this]() { SceneSystems::collect_point_lights(m_registry, m_point_lights); }, scene_jobs);
+
+	// queue the scene, drawn by the scene pass. Submitting first creates any scene shader variant not seen yet, so
+	// the uniforms below reach every variant the queue will use.
+	SceneSystems::submit_renderers(m_registry, m_render_queue);
+
+	JobSystem::get().wait(scene_jobs);
+
+	{
+		ProfileScope scope("light_culling", false);
+
+		m_clustered_lighting.build(m_point_lights, view_mat, projection_mat, NEAR_PLANE, FAR_PLANE, width, height);
+	}
+
+	if (m_settings.shadows)
+	{
+		m_shadow_renderer.set_resolution(static_cast<uint32_t>(m_settings.shadow_resolution));
+		m_shadow_renderer.set_cascade_count(static_cast<uint32_t>(m_settings.shadow_cascade_count));
+		m_shadow_renderer.update(view_mat, glm::radians(camera.get_zoom()), width / (float)height, NEAR_PLANE, m_settings.shadow_distance,
+			m_settings.shadow_split_lambda, m_settings.sun_direction, get_scene_bounds());
+	}
+
+	// per shader uniforms, per object state is set by the render queue
+	m_light_shader.use();
+	m_light_shader.set_mat4("view_mat", view_mat);
+	m_light_shader.set_mat4("projection_mat", projection_mat);
+	m_light_shader.set_float("light_intensity", m_settings.light_intensity);
+
+	// a variant finishing its compile later in the frame must not be drawn without these
+	m_opaque_depth_shader = &m_depth_shaders.get(ShaderKeywords::NONE);
+	m_alpha_test_depth_shader = &m_depth_shaders.get_exact(ShaderKeywords::ALPHA_TEST);
+
+	m_depth_shaders.for_each([&](Shader& shader)
+	{
+		shader.use();
+		shader.set_mat4("view_mat", view_mat);
+		shader.set_mat4("projection_mat", projection_mat);
+	});
+
+	m_scene_shaders.for_each([&](Shader& shader)
+	{
+		shader.use();
+		shader.set_mat4("view_mat", view_mat);
+		shader.set_mat4("projection_mat", projection_mat);
+		shader.set_vec3f("light_pos", m_settings.light_position);
+		shader.set_vec3f("camera_pos", camera.m_position);
+		shader.set_vec3f("light_color", m_settings.light_color);
+		shader.set_float("height_scale", m_settings.height_scale);
+		shader.set_float("light_intensity", m_settings.light_intensity);
+
+		m_clustered_lighting.set_uniforms(shader);
+
+		shader.set_vec3f("sun_direction", m_settings.sun_direction);
+		shader.set_vec3f("sun_color", m_settings.sun_color);
+		shader.set_float("sun_intensity", m_settings.sun_intensity);
+
+		m_shadow_renderer.set_uniforms(shader);
+		if (!m_settings.shadows)
+		{
+			// no cascade covers anything, the sun lights every fragment
+			shader.set_int("cascade_count", 0);
+		}
+	});
+}
+
+Bounds Renderer::get_scene_bounds() const
+{
+	return m_registry.find_pool<BoundsComponent>()->get(m_sponza).world;
+}
+
+void Renderer::update_point_lights()
+{
+	// the anchors are only placed once the scene is loaded, in its world space bounds
+	if (m_point_light_anchors.empty())
+	{
+		const Bounds bounds = get_scene_bounds();
+		const glm::vec3& min = bounds.min;
+		const glm::vec3& max = bounds.max;
+
+		if (min == max)
+		{
+			return;
+		}
+
+		// fixed seed, so every run (and every benchmark) lights the scene the same way
+		std::mt19937 random(1234);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+		m_point_light_anchors.resize(MAX_POINT_LIGHTS);
+		m_point_light_colors.resize(MAX_POINT_LIGHTS);
+
+		for (int i = 0; i < MAX_POINT_LIGHTS; i++)
+		{
+			// lower half of the scene, where the floors and walls are
+			const glm::vec3 position(glm::mix(min.x, max.x, unit(random)), glm::mix(min.y, (min.y + max.y) * 0.5f, unit(random)), glm::mix(min.z, max.z, unit(random)));
+			m_point_light_anchors[i] = glm::vec4(position, unit(random) * glm::two_pi<float>());
+
+			// saturated colors, one channel at least at full
+			glm::vec3 color(unit(random), unit(random), unit(random));
+			m_point_light_colors[i] = color / std::max({ color.x, color.y, color.z, 0.001f });
+		}
+	}
+
+	const size_t count = static_cast<size_t>(std::clamp(m_settings.point_light_count, 0, MAX_POINT_LIGHTS));
+
+	while (m_point_light_entities.size() > count)
+	{
+		m_registry.destroy(m_point_light_entities.back());
+		m_point_light_entities.pop_back();
+	}
+
+	while (m_point_light_entities.size() < count)
+	{
+		const size_t i = m_point_light_entities.size();
+		const glm::vec4& anchor = m_point_light_anchors[i];
+
+		const Entity entity = m_registry.create();
+		m_registry.add(entity, TransformComponent::make(glm::vec3(anchor)));
+		m_registry.add(entity, OrbitComponent{ glm::vec3(anchor), POINT_LIGHT_ORBIT, anchor.w });
+		m_registry.add(entity, LightComponent{ m_point_light_colors[i], 0.0f, 0.0f });
+
+		m_point_light_entities.push_back(entity);
+	}
+
+	for (LightComponent& light : m_registry.find_pool<LightComponent>()->get_components())
+	{
+		light.radius = m_settings.point_light_radius;
+		light.intensity = m_settings.point_light_intensity;
+	}
+}
+
+// Uniform float in [0, 1) from an object index and a channel, so each object keeps its placement as the count changes
+static float hash_unit(uint32_t index, uint32_t channel)
+{
+	uint32_t hash = index * 0x9E3779B9u + channel * 0x85EBCA6Bu;
+	hash ^= hash >> 16;
+	hash *= 0x7FEB352Du;
+	hash ^= hash >> 15;
+	hash *= 0x846CA68Bu;
+	hash ^= hash >> 16;
+
+	return static_cast<float>(hash >> 8) / static_cast<float>(1u << 24);
+}
+
+void Renderer::update_objects()
+{
+	const Bounds bounds = get_scene_bounds();
+	if (bounds.min == bounds.max)
+	{
+		return;
+	}
+
+	const size_t count = static_cast<size_t>(std::clamp(m_settings.object_count, 0, MAX_OBJECTS));
+
+	while (m_object_entities.size() > count)
+	{
+		m_registry.destroy(m_object_entities.back());
+		m_object_entities.pop_back();
+	}
+
+	if (m_object_entities.size() == count)
+	{
+		return;
+	}
+
+	const std::shared_ptr<Model>& cube_model = m_registry.get<MeshRendererComponent>(m_cube).model;
+
+	while (m_object_entities.size() < count)
+	{
+		const uint32_t i = static_cast<uint32_t>(m_object_entities.size());
+
+		// resting on the lower half of the scene, like the lights
+		const glm::vec3 position(glm::mix(bounds.min.x, bounds.max.x, hash_unit(i, 0)), glm::mix(bounds.min.y, (bounds.min.y + bounds.max.y) * 0.5f, hash_unit(i, 1)),
+			glm::mix(bounds.min.z, bounds.max.z, hash_unit(i, 2)));
+		const glm::vec3 rotation(0.0f, hash_unit(i, 3) * glm::two_pi<float>(), 0.0f);
+		const glm::vec3 color(hash_unit(i, 4), hash_unit(i, 5), hash_unit(i, 6));
+
+		const Entity entity = m_registry.create();
+		m_registry.add(entity, TransformComponent::make(position, rotation, glm::vec3(0.25f)));
+		m_registry.add(entity, MeshRendererComponent{ cube_model, &m_light_shader, nullptr, color / std::max({ color.x, color.y, color.z, 0.001f }) });
+		m_registry.add(entity, BoundsComponent{});
+
+		m_object_entities.push_back(entity);
+	}
+}
+
+void Renderer::draw_scene(bool count_invocations, OcclusionCuller* occlusion)
+{
+	const glm::vec4& clear_color = m_settings.clear_color;
+
+	glEnable(GL_FRAMEBUFFER_SRGB);
+	glEnable(GL_DEPTH_TEST);
+	glDepthFunc(GL_LESS);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glEnable(GL_CULL_FACE);
+	glCullFace(GL_BACK);
+	glClearColor(clear_color.x * clear_color.w, clear_color.y * clear_color.w, clear_color.z * clear_color.w, clear_color.w);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	m_clustered_lighting.bind();
+	m_shadow_renderer.bind();
+
+	const bool prepass = m_settings.depth_prepass;
+
+	if (prepass)
+	{
+		if (count_invocations)
+		{
+			m_prepass_invocations.begin();
+		}
+
+		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		m_render_queue.draw_depth(*m_opaque_depth_shader, *m_alpha_test_depth_shader, m_view_frustum, occlusion);
+		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+		if (count_invocations)
+		{
+			m_prepass_invocations.end();
+		}
+
+		// every visible pixel already holds its final depth, so the color pass shades exactly those
+		glDepthFunc(GL_EQUAL);
+		glDepthMask(GL_FALSE);
+	}
+
+	if (count_invocations)
+	{
+		m_color_invocations[prepass].begin();
+	}
+
+	m_render_queue.draw(occlusion);
+
+	if (count_invocations)
+	{
+		m_color_invocations[prepass].end();
+	}
+
+	glDepthFunc(GL_LESS);
+	glDepthMask(GL_TRUE);
+}
+
+void Renderer::render_bloom(BloomRenderer& renderer, uint32_t bright_texture, bool gaussian)
+{
+	if (gaussian)
+	{
+		renderer.render_gaussian(bright_texture, m_settings.spread, m_offscreen_rt.vao);
+	}
+	else
+	{
+		renderer.render(bright_texture, m_settings.spread, m_offscreen_rt.vao);
+	}
+}
+
+void Renderer::draw_tonemap(uint32_t scene_texture, uint32_t bloom_texture)
+{
+	glDisable(GL_DEPTH_TEST);
+	glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+
+	m_offscreen_fb_shader.use();
+	m_offscreen_fb_shader.set_float("exposure", m_settings.exposure);
+	m_offscreen_fb_shader.set_float("bloom_intensity", m_settings.bloom_intensity);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, scene_texture);
+	m_offscreen_fb_shader.set_int("offscreen_texture_sampler", 0);
+
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, bloom_texture);
+	m_offscreen_fb_shader.set_int("bloom_texture_sampler", 1);
+
+	glBindVertexArray(m_offscreen_rt.vao);
+	glDrawArrays(GL_TRIANGLES, 0, 6);
+
+	Profiler::get().add_draws(1, 2);
+}
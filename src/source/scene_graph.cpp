@@ -0,0 +1,210 @@
+#include "../include/scene_graph.hpp"
+#include "../include/job_system.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+
+SceneGraph::SceneGraph()
+	: m_first_dirty(0), m_updated_count(0)
+{
+}
+
+void SceneGraph::clear()
+{
+	m_parents.clear();
+	m_subtree_sizes.clear();
+	m_local.clear();
+	m_world.clear();
+	m_dirty.clear();
+
+	m_first_dirty = 0;
+	m_updated_count = 0;
+}
+
+void SceneGraph::reserve(uint32_t node_count)
+{
+	m_parents.reserve(node_count);
+	m_subtree_sizes.reserve(node_count);
+	m_local.reserve(node_count);
+	m_world.reserve(node_count);
+	m_dirty.reserve(node_count);
+}
+
+uint32_t SceneGraph::add_node(uint32_t parent, const glm::mat4& local_mat)
+{
+	const uint32_t node = get_node_count();
+
+	// the subtree of parent has to end at the last node, so the new node extends it
+	if (parent != NO_PARENT)
+	{
+		uint32_t ancestor = node == 0 ? NO_PARENT : node - 1;
+		while (ancestor != NO_PARENT && ancestor != parent)
+		{
+			ancestor = m_parents[ancestor];
+		}
+
+		if (ancestor == NO_PARENT)
+		{
+			std::cout << "Scene graph node " << node << " added under " << parent << ", which is not on the last node's path\n";
+			return NO_PARENT;
+		}
+	}
+
+	for (uint32_t ancestor = parent; ancestor != NO_PARENT; ancestor = m_parents[ancestor])
+	{
+		m_subtree_sizes[ancestor]++;
+	}
+
+	m_parents.push_back(parent);
+	m_subtree_sizes.push_back(1);
+	m_local.push_back(local_mat);
+	m_world.push_back(local_mat);
+	m_dirty.push_back(1);
+
+	m_first_dirty = std::min(m_first_dirty, node);
+
+	return node;
+}
+
+void SceneGraph::set_local(uint32_t node, const glm::mat4& local_mat)
+{
+	if (m_local[node] == local_mat)
+	{
+		return;
+	}
+
+	m_local[node] = local_mat;
+	m_dirty[node] = 1;
+
+	m_first_dirty = std::min(m_first_dirty, node);
+}
+
+void SceneGraph::update()
+{
+	const uint32_t node_count = get_node_count();
+
+	m_updated_count = 0;
+	if (m_first_dirty >= node_count)
+	{
+		return;
+	}
+
+	const uint32_t thread_count = JobSystem::get().get_thread_count();
+
+	if (node_count - m_first_dirty >= PARALLEL_THRESHOLD && thread_count > 1)
+	{
+		update_parallel(m_first_dirty, thread_count);
+	}
+	else
+	{
+		m_updated_count = update_range(m_first_dirty, node_count);
+	}
+
+	std::fill(m_dirty.begin() + m_first_dirty, m_dirty.end(), 0);
+	m_first_dirty = node_count;
+}
+
+uint32_t SceneGraph::get_node_count() const
+{
+	return static_cast<uint32_t>(m_parents.size());
+}
+
+uint32_t SceneGraph::get_parent(uint32_t node) const
+{
+	return m_parents[node];
+}
+
+uint32_t SceneGraph::get_subtree_size(uint32_t node) const
+{
+	return m_subtree_sizes[node];
+}
+
+const glm::mat4& SceneGraph::get_local(uint32_t node) const
+{
+	return m_local[node];
+}
+
+const glm::mat4& SceneGraph::get_world(uint32_t node) const
+{
+	return m_world[node];
+}
+
+uint32_t SceneGraph::get_updated_count() const
+{
+	return m_updated_count;
+}
+
+uint32_t SceneGraph::update_range(uint32_t begin, uint32_t end)
+{
+	uint32_t updated_count = 0;
+
+	for (uint32_t node = begin; node < end; node++)
+	{
+		const uint32_t parent = m_parents[node];
+
+		// parents come first, so their flag already says whether their world matrix changed
+		if (!m_dirty[node] && (parent == NO_PARENT || !m_dirty[parent]))
+		{
+			continue;
+		}
+
+		m_world[node] = parent == NO_PARENT ? m_local[node] : m_world[parent] * m_local[node];
+		m_dirty[node] = 1;
+
+		updated_count++;
+	}
+
+	return updated_count;
+}
+
+void SceneGraph::update_parallel(uint32_t begin, uint32_t thread_count)
+{
+	const uint32_t node_count = get_node_count();
+
+	// nodes with subtrees larger than a share are updated here first, the subtrees below them are then independent
+	// of each other and go to the threads
+	const uint32_t share = std::max((node_count - begin) / (thread_count * 4), 1u);
+
+	m_ranges.clear();
+
+	uint32_t node = begin;
+	while (node < node_count)
+	{
+		if (m_subtree_sizes[node] > share)
+		{
+			m_updated_count += update_range(node, node + 1);
+			node++;
+		}
+		else
+		{
+			m_ranges.emplace_back(node, node + m_subtree_sizes[node]);
+			node += m_subtree_sizes[node];
+		}
+	}
+
+	std::atomic<size_t> next_range = 0;
+	std::atomic<uint32_t> updated_count = 0;
+
+	const auto work = [&]()
+	{
+		uint32_t count = 0;
+		for (size_t i = next_range++; i < m_ranges.size(); i = next_range++)
+		{
+			count += update_range(m_ranges[i].first, m_ranges[i].second);
+		}
+
+		updated_count += count;
+	};
+
+	// one puller per thread of the job system, the calling thread takes its share while it waits
+	JobCounter jobs;
+	for (uint32_t i = 0; i < thread_count; i++)
+	{
+		JobSystem::get().submit(work, jobs);
+	}
+
+	JobSystem::get().wait(jobs);
+
+	m_updated_count += updated_count;
+}
@@ -0,0 +1,87 @@
+#include "../include/scene_systems.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+
+void SceneSystems::register_components(Registry& registry)
+{
+	registry.register_component<TransformComponent>();
+	registry.register_component<MeshRendererComponent>();
+	registry.register_component<LightComponent>();
+	registry.register_component<OrbitComponent>();
+	registry.register_component<BoundsComponent>();
+}
+
+void SceneSystems::update_orbits(Registry& registry, float time)
+{
+	registry.each<OrbitComponent, TransformComponent>([time](Entity, const OrbitComponent& orbit, TransformComponent& transform)
+	{
+		const float angle = time + orbit.phase;
+
+		transform.position = orbit.anchor + glm::vec3(std::cos(angle), 0.0f, std::sin(angle)) * orbit.radius;
+		transform.dirty = true;
+	});
+}
+
+void SceneSystems::update_transforms(Registry& registry)
+{
+	for (TransformComponent& transform : registry.register_component<TransformComponent>().get_components())
+	{
+		if (!transform.dirty)
+		{
+			continue;
+		}
+
+		glm::mat4 world_mat = glm::translate(glm::mat4(1.0f), transform.position);
+		world_mat = glm::rotate(world_mat, transform.rotation.y, glm::vec3(0.0f, 1.0f, 0.0f));
+		world_mat = glm::rotate(world_mat, transform.rotation.x, glm::vec3(1.0f, 0.0f, 0.0f));
+		world_mat = glm::rotate(world_mat, transform.rotation.z, glm::vec3(0.0f, 0.0f, 1.0f));
+
+		transform.world_mat = glm::scale(world_mat, transform.scale);
+		transform.version++;
+		transform.dirty = false;
+	}
+}
+
+void SceneSystems::update_bounds(Registry& registry)
+{
+	registry.each<BoundsComponent, TransformComponent, MeshRendererComponent>([](Entity, BoundsComponent& bounds, const TransformComponent& transform,
+		const MeshRendererComponent& renderer)
+	{
+		const uint32_t reload_count = renderer.model->get_reload_count();
+		if (bounds.transform_version == transform.version && bounds.model_reload_count == reload_count)
+		{
+			return;
+		}
+
+		bounds.world = transform_bounds(renderer.model->get_bounds(), transform.world_mat);
+		bounds.transform_version = transform.version;
+		bounds.model_reload_count = reload_count;
+	});
+}
+
+void SceneSystems::collect_point_lights(Registry& registry, std::vector<PointLight>& lights)
+{
+	lights.clear();
+
+	registry.each<LightComponent, TransformComponent>([&lights](Entity, const LightComponent& light, const TransformComponent& transform)
+	{
+		lights.push_back({ glm::vec3(transform.world_mat[3]), light.radius, light.color, light.intensity });
+	});
+}
+
+void SceneSystems::submit_renderers(Registry& registry, RenderQueue& queue)
+{
+	registry.each<MeshRendererComponent, TransformComponent>([&queue](Entity, MeshRendererComponent& renderer, const TransformComponent& transform)
+	{
+		if (renderer.shader_variants != nullptr)
+		{
+			renderer.model->submit(queue, *renderer.shader_variants, transform.world_mat, renderer.color);
+		}
+		else
+		{
+			renderer.model->submit(queue, *renderer.shader, transform.world_mat, renderer.color);
+		}
+	});
+}
@@ -1,81 +1,284 @@
 #include "../include/shader.hpp"
+#include "../include/program_cache.hpp"
+#include "../include/hot_reload.hpp"
 
 #include <string>
+#include <filesystem>
 #include <fstream>
+#include <set>
 #include <sstream>
 #include <iostream>
 
-Shader::Shader(const char* vs_path, const char* fs_path)
-	: m_program(0), m_vertex_shader(0), m_fragment_shader(0)
+// GL_KHR_parallel_shader_compile, only queried when the driver reports the extension
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+namespace
+{
+	constexpr uint32_t MAX_INCLUDE_DEPTH = 16;
+
+	bool read_file(const std::string& path, std::string& contents)
+	{
+		std::ifstream file(path);
+		if (!file.is_open())
+		{
+			std::cout << "Failed to open file : " << path << '\n';
+			return false;
+		}
+
+		std::stringstream stream;
+		stream << file.rdbuf();
+		contents = stream.str();
+
+		return true;
+	}
+
+	// Appends the file at path to source with its #include lines expanded, files already in included are skipped
+	bool expand_includes(const std::string& path, std::string& source, std::set<std::string>& included, uint32_t depth)
+	{
+		if (depth > MAX_INCLUDE_DEPTH)
+		{
+			std::cout << "Shader includes nested too deep : " << path << '\n';
+			return false;
+		}
+
+		std::string contents;
+		if (!read_file(path, contents))
+		{
+			return false;
+		}
+
+		const std::filesystem::path directory = std::filesystem::path(path).parent_path();
+
+		std::istringstream stream(contents);
+		std::string line;
+		while (std::getline(stream, line))
+		{
+			const size_t directive = line.find_first_not_of(" \t");
+			if (directive == std::string::npos || line.compare(directive, 8, "#include") != 0)
+			{
+				source += line;
+				source += '\n';
+				continue;
+			}
+
+			const size_t name_begin = line.find('"', directive);
+			const size_t name_end = name_begin != std::string::npos ? line.find('"', name_begin + 1) : std::string::npos;
+			if (name_end == std::string::npos)
+			{
+				std::cout << "Malformed #include in " << path << " : " << line << '\n';
+				return false;
+			}
+
+			const std::string include_path = (directory / line.substr(name_begin + 1, name_end - name_begin - 1)).lexically_normal().generic_string();
+			if (!included.insert(include_path).second)
+			{
+				continue;
+			}
+
+			if (!expand_includes(include_path, source, included, depth + 1))
+			{
+				std::cout << "Included from : " << path << '\n';
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	const char* get_stage_name(uint32_t type)
+	{
+		switch (type)
+		{
+		case GL_VERTEX_SHADER:
+			return "VS";
+		case GL_FRAGMENT_SHADER:
+			return "FS";
+		default:
+			return "CS";
+		}
+	}
+
+	bool load_source(const std::string& path, const std::vector<std::string>& defines, std::string& source, std::set<std::string>& included)
+	{
+		if (!expand_includes(path, source, included, 0))
+		{
+			return false;
+		}
+
+		if (defines.empty())
+		{
+			return true;
+		}
+
+		// #version has to stay the first statement, the defines go right after it
+		std::string define_lines;
+		for (const std::string& define : defines)
+		{
+			define_lines += "#define " + define + '\n';
+		}
+
+		const size_t version = source.find("#version");
+		const size_t insert_at = version != std::string::npos ? source.find('\n', version) : std::string::npos;
+
+		if (insert_at == std::string::npos)
+		{
+			source.insert(0, define_lines);
+		}
+		else
+		{
+			source.insert(insert_at + 1, define_lines);
+		}
+
+		return true;
+	}
+}
+
+Shader::Shader(const char* vs_path, const char* fs_path, const std::vector<std::string>& defines)
+	: m_program(0), m_pending(false), m_linked(false), m_cache_key(0), m_generation(0),
+	  m_stages{ { GL_VERTEX_SHADER, vs_path, 0 }, { GL_FRAGMENT_SHADER, fs_path, 0 } }, m_defines(defines)
+{
+	build();
+}
+
+Shader::Shader(const char* cs_path, const std::vector<std::string>& defines)
+	: m_program(0), m_pending(false), m_linked(false), m_cache_key(0), m_generation(0),
+	  m_stages{ { GL_COMPUTE_SHADER, cs_path, 0 } }, m_defines(defines)
+{
+	build();
+}
+
+Shader::~Shader()
+{
+	HotReload::get().unregister_shader(this);
+
+	for (const Stage& stage : m_stages)
+	{
+		glDeleteShader(stage.shader);
+	}
+
+	glDeleteProgram(m_program);
+}
+
+void Shader::build()
 {
-	std::ifstream vs_file(vs_path);
-	if (!vs_file.is_open())
+	HotReload::get().register_shader(this);
+
+	std::vector<std::string> sources;
+	if (!load_sources(sources))
 	{
-		std::cout << "Failed to open file : " << vs_path << '\n';
 		return;
 	}
-	
-	std::ifstream fs_file(fs_path);
-	if (!fs_file.is_open())
+
+	// the defines are part of the sources, so every variant gets its own cache entry
+	ProgramCache& program_cache = ProgramCache::get();
+	m_cache_key = get_cache_key(sources);
+
+	m_program = program_cache.load(m_cache_key);
+	if (m_program != 0)
 	{
-		std::cout << "Failed to open file : " << fs_path << '\n';
+		m_linked = true;
+		reflect_uniforms();
 		return;
 	}
 
-	std::stringstream vs_stream;
-	vs_stream << vs_file.rdbuf();
+	compile(sources);
+}
 
-	std::stringstream fs_stream;
-	fs_stream << fs_file.rdbuf();
+bool Shader::load_sources(std::vector<std::string>& sources)
+{
+	// the main files are tracked even if they fail to load, so fixing them triggers a reload
+	std::set<std::string> source_files;
+	for (const Stage& stage : m_stages)
+	{
+		source_files.insert(stage.path);
+	}
 
-	std::string vs_source = vs_stream.str();
-	std::string fs_source = fs_stream.str();
+	bool loaded = true;
+	sources.resize(m_stages.size());
 
-	const char* vs_source_code = vs_source.c_str();
-	const char* fs_source_code = fs_source.c_str();
+	// include once applies per stage, a header shared by the vertex and fragment stage is expanded into both
+	for (size_t i = 0; i < m_stages.size() && loaded; i++)
+	{
+		std::set<std::string> included = { m_stages[i].path };
+		loaded = load_source(m_stages[i].path, m_defines, sources[i], included);
 
-	m_vertex_shader = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(m_vertex_shader, 1, &vs_source_code, nullptr);
-	glCompileShader(m_vertex_shader);
+		source_files.insert(included.begin(), included.end());
+	}
+
+	m_source_files.assign(source_files.begin(), source_files.end());
+
+	return loaded;
+}
+
+uint64_t Shader::get_cache_key(const std::vector<std::string>& sources) const
+{
+	// a compute program is keyed like a vertex / fragment pair with an empty second stage
+	return ProgramCache::get().get_key(sources[0], sources.size() > 1 ? sources[1] : std::string_view());
+}
+
+void Shader::compile(const std::vector<std::string>& sources)
+{
+	m_program = glCreateProgram();
+	glProgramParameteri(m_program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 
-	// Check for compilation errors of VS
+	for (size_t i = 0; i < m_stages.size(); i++)
 	{
-		int success = 0;
-		char info_log[512] = {};
+		const char* source_code = sources[i].c_str();
 
-		glGetShaderiv(m_vertex_shader, GL_COMPILE_STATUS, &success);
-		if (!success)
-		{
-			glGetShaderInfoLog(m_vertex_shader, 512, nullptr, info_log);
-			std::cout << "VS ERROR : " << info_log << '\n';
-			std::cout << "Path : " << vs_path;
-		}
+		m_stages[i].shader = glCreateShader(m_stages[i].type);
+		glShaderSource(m_stages[i].shader, 1, &source_code, nullptr);
+		glCompileShader(m_stages[i].shader);
+
+		glAttachShader(m_program, m_stages[i].shader);
 	}
 
-	m_fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(m_fragment_shader, 1, &fs_source_code, nullptr);
-	glCompileShader(m_fragment_shader);
+	// link right away without querying the compile status, which would wait for the compile to finish
+	glLinkProgram(m_program);
 
-	// Check for compilation errors of FS
+	m_pending = true;
+}
+
+bool Shader::is_ready() const
+{
+	if (!m_pending || !ProgramCache::get().has_parallel_compile())
+	{
+		return true;
+	}
+
+	int completed = 0;
+	glGetProgramiv(m_program, GL_COMPLETION_STATUS_KHR, &completed);
+
+	return completed != 0;
+}
+
+bool Shader::wait() const
+{
+	if (!m_pending)
+	{
+		return m_linked;
+	}
+
+	m_pending = false;
+
+	// Check for compilation errors of every stage
+	for (const Stage& stage : m_stages)
 	{
 		int success = 0;
 		char info_log[512] = {};
 
-		glGetShaderiv(m_fragment_shader, GL_COMPILE_STATUS, &success);
+		glGetShaderiv(stage.shader, GL_COMPILE_STATUS, &success);
 		if (!success)
 		{
-			glGetShaderInfoLog(m_fragment_shader, 512, nullptr, info_log);
-			std::cout << "VS ERROR : " << info_log << '\n';
-			std::cout << "Path : " << fs_path;
+			glGetShaderInfoLog(stage.shader, 512, nullptr, info_log);
+			std::cout << get_stage_name(stage.type) << " ERROR : " << info_log << '\n';
+			std::cout << "Path : " << stage.path;
 		}
 	}
 
-	m_program = glCreateProgram();
-	glAttachShader(m_program, m_vertex_shader);
-	glAttachShader(m_program, m_fragment_shader);
-	glLinkProgram(m_program);
-
 	// Check for compilation errors of shader program
+	bool linked = false;
 	{
 		int success = 0;
 		char info_log[512] = {};
@@ -85,46 +288,222 @@ Shader::Shader(const char* vs_path, const char* fs_path)
 		{
 			glGetProgramInfoLog(m_program, 512, nullptr, info_log);
 			std::cout << "SHADER PROGRAM ERROR : " << info_log << '\n';
-			std::cout << "Path of vs : " << vs_path << "\n";
-			std::cout << "Path of fs : " << fs_path << "\n";
+			for (const Stage& stage : m_stages)
+			{
+				std::cout << "Path of " << get_stage_name(stage.type) << " : " << stage.path << "\n";
+			}
 		}
+
+		linked = success != 0;
 	}
 
-	glDeleteShader(m_vertex_shader);
-	glDeleteShader(m_fragment_shader);
+	for (Stage& stage : m_stages)
+	{
+		glDeleteShader(stage.shader);
+		stage.shader = 0;
+	}
+
+	if (linked)
+	{
+		ProgramCache::get().store(m_cache_key, m_program);
+	}
+
+	m_linked = linked;
+	reflect_uniforms();
+
+	return linked;
+}
+
+bool Shader::reload()
+{
+	// a program still compiling from the constructor or a previous reload is finished first
+	wait();
+
+	std::vector<std::string> sources;
+	if (!load_sources(sources))
+	{
+		return false;
+	}
+
+	const uint32_t previous_program = m_program;
+	const uint64_t previous_key = m_cache_key;
+	const bool previous_linked = m_linked;
+
+	ProgramCache& program_cache = ProgramCache::get();
+	m_cache_key = get_cache_key(sources);
+
+	// an edit that was undone finds its binary again
+	m_program = program_cache.load(m_cache_key);
+	if (m_program != 0)
+	{
+		m_linked = true;
+		reflect_uniforms();
+	}
+	else
+	{
+		compile(sources);
+	}
+
+	if (!wait())
+	{
+		glDeleteProgram(m_program);
+
+		m_program = previous_program;
+		m_cache_key = previous_key;
+		m_linked = previous_linked;
+		reflect_uniforms();
+
+		return false;
+	}
+
+	glDeleteProgram(previous_program);
+	m_generation++;
+
+	return true;
+}
+
+uint32_t Shader::get_generation() const
+{
+	return m_generation;
+}
+
+const std::vector<std::string>& Shader::get_source_files() const
+{
+	return m_source_files;
+}
+
+void Shader::dispatch(uint32_t groups_x, uint32_t groups_y, uint32_t groups_z)
+{
+	use();
+	glDispatchCompute(groups_x, groups_y, groups_z);
 }
 
 void Shader::use()
 {
+	wait();
 	glUseProgram(m_program);
 }
 
+uint32_t Shader::get_program() const
+{
+	wait();
+	return m_program;
+}
+
+int32_t Shader::get_uniform_location(std::string_view name) const
+{
+	wait();
+
+	auto it = m_uniform_locations.find(name);
+	if (it == m_uniform_locations.end())
+	{
+		return -1;
+	}
+
+	return it->second;
+}
+
+void Shader::set(UniformHandle<int> handle, int value) const
+{
+	glUniform1i(handle.location, value);
+}
+
+void Shader::set(UniformHandle<bool> handle, bool value) const
+{
+	glUniform1i(handle.location, (int)value);
+}
+
+void Shader::set(UniformHandle<float> handle, float value) const
+{
+	glUniform1f(handle.location, value);
+}
+
+void Shader::set(UniformHandle<glm::vec3> handle, const glm::vec3& value) const
+{
+	glUniform3fv(handle.location, 1, &value[0]);
+}
+
+void Shader::set(UniformHandle<glm::mat4> handle, const glm::mat4& mat) const
+{
+	glUniformMatrix4fv(handle.location, 1, GL_FALSE, &mat[0][0]);
+}
+
 void Shader::set_bool(const char* name, bool value) const
 {
-	glUniform1i(glGetUniformLocation(m_program, name), (int)value);
+	glUniform1i(get_uniform_location(name), (int)value);
 }
 
 void Shader::set_int(const char* name, int value) const
 {
-	glUniform1i(glGetUniformLocation(m_program, name), value);
+	glUniform1i(get_uniform_location(name), value);
 }
 
 void Shader::set_float(const char* name, float value) const
 {
-	glUniform1f(glGetUniformLocation(m_program, name), value);
+	glUniform1f(get_uniform_location(name), value);
+}
+
+void Shader::set_vec2f(const char* name, const glm::vec2& value) const
+{
+	glUniform2fv(get_uniform_location(name), 1, &value[0]);
 }
 
 void Shader::set_vec3f(const char* name, const glm::vec3& value) const
 {
-	glUniform3fv(glGetUniformLocation(m_program, name), 1, &value[0]);
+	glUniform3fv(get_uniform_location(name), 1, &value[0]);
 }
 
 void Shader::set_vec3f(const char* name, float x, float y, float z) const
 {
-	glUniform3f(glGetUniformLocation(m_program, name), x, y, z);
+	glUniform3f(get_uniform_location(name), x, y, z);
 }
 
 void Shader::set_mat4(const char* name, const glm::mat4& mat) const
 {
-	glUniformMatrix4fv(glGetUniformLocation(m_program, name), 1, GL_FALSE, &mat[0][0]);
+	glUniformMatrix4fv(get_uniform_location(name), 1, GL_FALSE, &mat[0][0]);
+}
+
+void Shader::reflect_uniforms() const
+{
+	m_uniform_locations.clear();
+
+	int uniform_count = 0;
+	int max_name_length = 0;
+	glGetProgramiv(m_program, GL_ACTIVE_UNIFORMS, &uniform_count);
+	glGetProgramiv(m_program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_name_length);
+
+	std::string name(static_cast<size_t>(max_name_length), '\0');
+
+	for (int i = 0; i < uniform_count; i++)
+	{
+		int length = 0;
+		int size = 0;
+		GLenum type = 0;
+		glGetActiveUniform(m_program, static_cast<uint32_t>(i), max_name_length, &length, &size, &type, name.data());
+
+		std::string uniform_name = name.substr(0, static_cast<size_t>(length));
+
+		// members of uniform blocks have no location
+		int32_t location = glGetUniformLocation(m_program, uniform_name.c_str());
+		if (location < 0)
+		{
+			continue;
+		}
+
+		m_uniform_locations[uniform_name] = location;
+
+		// arrays are reported as "name[0]", make "name" and every element reachable as well
+		size_t bracket = uniform_name.rfind("[0]");
+		if (bracket != std::string::npos && bracket + 3 == uniform_name.size())
+		{
+			std::string base_name = uniform_name.substr(0, bracket);
+			m_uniform_locations[base_name] = location;
+
+			for (int element = 1; element < size; element++)
+			{
+				std::string element_name = base_name + '[' + std::to_string(element) + ']';
+				m_uniform_locations[element_name] = glGetUniformLocation(m_program, element_name.c_str());
+			}
+		}
+	}
 }
\ No newline at end of file
@@ -0,0 +1,107 @@
+#include "../include/shader_variants.hpp"
+
+#include <bit>
+
+const char* ShaderKeywords::get_name(uint32_t bit_index)
+{
+	static constexpr const char* NAMES[COUNT] = { "HAS_NORMAL_MAP", "HAS_HEIGHT_MAP", "ALPHA_TEST" };
+	return bit_index < COUNT ? NAMES[bit_index] : "";
+}
+
+std::vector<std::string> ShaderKeywords::get_defines(uint32_t keywords)
+{
+	std::vector<std::string> defines;
+	for (uint32_t i = 0; i < COUNT; i++)
+	{
+		if (keywords & (1u << i))
+		{
+			defines.push_back(get_name(i));
+		}
+	}
+
+	return defines;
+}
+
+ShaderVariants::ShaderVariants(const char* vs_path, const char* fs_path)
+	: m_vs_path(vs_path), m_fs_path(fs_path)
+{
+}
+
+Shader& ShaderVariants::get(uint32_t keywords)
+{
+	Shader& variant = create(keywords);
+	if (variant.is_ready())
+	{
+		return variant;
+	}
+
+	// polled again on the next call, the variant takes over once the driver is done with it
+	if (Shader* fallback = find_fallback(keywords))
+	{
+		return *fallback;
+	}
+
+	// nothing to stand in, finish it now so it is ready (and visited by for_each) like anything get returns
+	variant.wait();
+	return variant;
+}
+
+Shader& ShaderVariants::get_exact(uint32_t keywords)
+{
+	Shader& variant = create(keywords);
+	variant.wait();
+	return variant;
+}
+
+void ShaderVariants::wait_all()
+{
+	for (auto& [keywords, variant] : m_variants)
+	{
+		variant->wait();
+	}
+}
+
+void ShaderVariants::for_each(const std::function<void(Shader&)>& fn)
+{
+	for (auto& [keywords, variant] : m_variants)
+	{
+		if (variant->is_ready())
+		{
+			fn(*variant);
+		}
+	}
+}
+
+Shader& ShaderVariants::create(uint32_t keywords)
+{
+	std::unique_ptr<Shader>& variant = m_variants[keywords];
+	if (!variant)
+	{
+		variant = std::make_unique<Shader>(m_vs_path.c_str(), m_fs_path.c_str(), ShaderKeywords::get_defines(keywords));
+	}
+
+	return *variant;
+}
+
+Shader* ShaderVariants::find_fallback(uint32_t keywords)
+{
+	Shader* fallback = nullptr;
+	int fallback_bits = -1;
+
+	for (auto& [variant_keywords, variant] : m_variants)
+	{
+		const int bits = std::popcount(variant_keywords);
+		if ((variant_keywords & ~keywords) == 0 && variant_keywords != keywords && bits > fallback_bits && variant->is_ready())
+		{
+			fallback = variant.get();
+			fallback_bits = bits;
+		}
+	}
+
+	return fallback;
+}
+
+size_t ShaderVariants::get_variant_count() const
+{
+	return m_variants.size();
+}
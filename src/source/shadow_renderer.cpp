@@ -0,0 +1,262 @@
+#include "../include/shadow_renderer.hpp"
+
+#include <glad/glad.h>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <string>
+
+ShadowRenderer::ShadowRenderer(uint32_t resolution, uint32_t cascade_count)
+	: m_depth_shaders("../shaders/depth_vertex.glsl", "../shaders/depth_fragment.glsl"), m_resolution(resolution),
+	  m_cascade_count(std::clamp(cascade_count, 1u, MAX_CASCADES)), m_texture(0), m_fbo(0), m_light_space_matrices{}, m_frustums{}, m_splits{},
+	  m_cached_matrices{}, m_cached{}, m_cached_scene_hash(0), m_stats{}
+{
+	create_targets();
+}
+
+ShadowRenderer::~ShadowRenderer()
+{
+	destroy_targets();
+}
+
+void ShadowRenderer::set_resolution(uint32_t resolution)
+{
+	if (resolution == m_resolution)
+	{
+		return;
+	}
+
+	m_resolution = resolution;
+
+	destroy_targets();
+	create_targets();
+}
+
+void ShadowRenderer::set_cascade_count(uint32_t cascade_count)
+{
+	cascade_count = std::clamp(cascade_count, 1u, MAX_CASCADES);
+	if (cascade_count == m_cascade_count)
+	{
+		return;
+	}
+
+	m_cascade_count = cascade_count;
+
+	// the splits move, so every cascade changes anyway
+	destroy_targets();
+	create_targets();
+}
+
+void ShadowRenderer::update(const glm::mat4& view_mat, float fov_y, float aspect, float near_plane, float shadow_distance, float split_lambda,
+	const glm::vec3& light_direction, const Bounds& scene_bounds)
+{
+	const glm::mat4 inverse_view = glm::inverse(view_mat);
+
+	const float tan_y = std::tan(fov_y * 0.5f);
+	const float tan_x = tan_y * aspect;
+
+	// the light looks down light_direction, up only has to be away from it
+	const glm::vec3 direction = glm::normalize(light_direction);
+	const glm::vec3 up = std::abs(direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+	const glm::mat4 light_view = glm::lookAt(glm::vec3(0.0f), direction, up);
+
+	// depth range along the light covering the whole scene, so casters between the light and a cascade are kept
+	float scene_min_z = std::numeric_limits<float>::max();
+	float scene_max_z = std::numeric_limits<float>::lowest();
+
+	for (uint32_t corner = 0; corner < 8; corner++)
+	{
+		const glm::vec3 position((corner & 1) ? scene_bounds.max.x : scene_bounds.min.x, (corner & 2) ? scene_bounds.max.y : scene_bounds.min.y,
+			(corner & 4) ? scene_bounds.max.z : scene_bounds.min.z);
+
+		const float z = (light_view * glm::vec4(position, 1.0f)).z;
+		scene_min_z = std::min(scene_min_z, z);
+		scene_max_z = std::max(scene_max_z, z);
+	}
+
+	float split_near = near_plane;
+
+	for (uint32_t i = 0; i < m_cascade_count; i++)
+	{
+		// practical split scheme : logarithmic splits follow the perspective resolution, uniform ones keep the far
+		// cascades from getting too large
+		const float ratio = static_cast<float>(i + 1) / m_cascade_count;
+		const float log_split = near_plane * std::pow(shadow_distance / near_plane, ratio);
+		const float uniform_split = near_plane + (shadow_distance - near_plane) * ratio;
+		const float split_far = split_lambda * log_split + (1.0f - split_lambda) * uniform_split;
+
+		m_splits[i] = split_far;
+
+		// bounding sphere of the slice. Its radius only depends on the split distances and the fov, so the texel size
+		// stays fixed as the camera turns. The center is on the view axis and moves with any camera motion, rotation
+		// included, so turning redraws the cascades.
+		const float far_extent = split_far * glm::length(glm::vec2(tan_x, tan_y));
+		const float near_extent = split_near * glm::length(glm::vec2(tan_x, tan_y));
+
+		const float center_depth = std::clamp(0.5f * (split_near + split_far) + 0.5f * (far_extent * far_extent - near_extent * near_extent) / (split_far - split_near),
+			split_near, split_far);
+
+		float radius = std::max(glm::length(glm::vec2(far_extent, split_far - center_depth)), glm::length(glm::vec2(near_extent, center_depth - split_near)));
+
+		// rounded up, so float noise does not change the texel size from frame to frame
+		radius = std::ceil(radius * 16.0f) / 16.0f;
+
+		const glm::vec3 center = glm::vec3(inverse_view * glm::vec4(0.0f, 0.0f, -center_depth, 1.0f));
+		glm::vec3 light_center = glm::vec3(light_view * glm::vec4(center, 1.0f));
+
+		// whole texels only, a static caster then always rasterizes to the same texels
+		const float texel_size = 2.0f * radius / m_resolution;
+		light_center.x = std::floor(light_center.x / texel_size) * texel_size;
+		light_center.y = std::floor(light_center.y / texel_size) * texel_size;
+
+		// view space z is negative in front of the light
+		const float near_z = -std::max(scene_max_z, light_center.z + radius);
+		const float far_z = -std::min(scene_min_z, light_center.z - radius);
+
+		const glm::mat4 light_projection = glm::ortho(light_center.x - radius, light_center.x + radius, light_center.y - radius, light_center.y + radius,
+			near_z, far_z);
+
+		m_light_space_matrices[i] = light_projection * light_view;
+		m_frustums[i] = Frustum::from_matrix(m_light_space_matrices[i]);
+
+		split_near = split_far;
+	}
+}
+
+void ShadowRenderer::render(RenderQueue& queue, uint64_t scene_hash)
+{
+	m_stats = {};
+	m_stats.cascade_count = m_cascade_count;
+
+	if (scene_hash != m_cached_scene_hash)
+	{
+		invalidate();
+		m_cached_scene_hash = scene_hash;
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+	glViewport(0, 0, m_resolution, m_resolution);
+
+	glEnable(GL_DEPTH_TEST);
+	glDepthFunc(GL_LESS);
+	glDepthMask(GL_TRUE);
+	glDisable(GL_BLEND);
+
+	// Sponza has single sided walls and foliage, so both faces cast, and the slope scaled offset fights acne instead
+	// of front face culling
+	glDisable(GL_CULL_FACE);
+	glEnable(GL_POLYGON_OFFSET_FILL);
+	glPolygonOffset(2.0f, 4.0f);
+
+	Shader& opaque_shader = m_depth_shaders.get(ShaderKeywords::NONE);
+	Shader& alpha_test_shader = m_depth_shaders.get(ShaderKeywords::ALPHA_TEST);
+
+	for (uint32_t i = 0; i < m_cascade_count; i++)
+	{
+		if (m_cached[i] && m_cached_matrices[i] == m_light_space_matrices[i])
+		{
+			m_stats.cached_cascades++;
+			continue;
+		}
+
+		glNamedFramebufferTextureLayer(m_fbo, GL_DEPTH_ATTACHMENT, m_texture, 0, static_cast<int32_t>(i));
+		glClear(GL_DEPTH_BUFFER_BIT);
+
+		m_depth_shaders.for_each([&](Shader& shader)
+		{
+			shader.use();
+			shader.set_mat4("view_mat", glm::mat4(1.0f));
+			shader.set_mat4("projection_mat", m_light_space_matrices[i]);
+		});
+
+		m_stats.drawn_items += queue.draw_depth(opaque_shader, alpha_test_shader, m_frustums[i]);
+		m_stats.rendered_cascades++;
+
+		// not kept while the opaque variant stands in for the alpha tested one, which is still compiling
+		m_cached_matrices[i] = m_light_space_matrices[i];
+		m_cached[i] = &alpha_test_shader != &opaque_shader;
+	}
+
+	glDisable(GL_POLYGON_OFFSET_FILL);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void ShadowRenderer::invalidate()
+{
+	std::fill(std::begin(m_cached), std::end(m_cached), false);
+}
+
+void ShadowRenderer::wait_shaders()
+{
+	m_depth_shaders.wait_all();
+}
+
+void ShadowRenderer::bind() const
+{
+	glBindTextureUnit(TEXTURE_UNIT, m_texture);
+}
+
+void ShadowRenderer::set_uniforms(Shader& shader) const
+{
+	shader.set_int("shadow_map", static_cast<int>(TEXTURE_UNIT));
+	shader.set_int("cascade_count", static_cast<int>(m_cascade_count));
+
+	for (uint32_t i = 0; i < m_cascade_count; i++)
+	{
+		const std::string index = "[" + std::to_string(i) + "]";
+
+		shader.set_mat4(("light_space_matrices" + index).c_str(), m_light_space_matrices[i]);
+		shader.set_float(("cascade_splits" + index).c_str(), m_splits[i]);
+	}
+}
+
+uint32_t ShadowRenderer::get_texture() const
+{
+	return m_texture;
+}
+
+uint32_t ShadowRenderer::get_resolution() const
+{
+	return m_resolution;
+}
+
+uint32_t ShadowRenderer::get_cascade_count() const
+{
+	return m_cascade_count;
+}
+
+const ShadowStats& ShadowRenderer::get_stats() const
+{
+	return m_stats;
+}
+
+void ShadowRenderer::create_targets()
+{
+	glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &m_texture);
+	glTextureStorage3D(m_texture, 1, GL_DEPTH_COMPONENT32F, m_resolution, m_resolution, m_cascade_count);
+
+	// hardware 2x2 PCF through sampler2DArrayShadow
+	glTextureParameteri(m_texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTextureParameteri(m_texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTextureParameteri(m_texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(m_texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(m_texture, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+	glTextureParameteri(m_texture, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+	glCreateFramebuffers(1, &m_fbo);
+	glNamedFramebufferDrawBuffer(m_fbo, GL_NONE);
+	glNamedFramebufferReadBuffer(m_fbo, GL_NONE);
+
+	invalidate();
+}
+
+void ShadowRenderer::destroy_targets()
+{
+	glDeleteFramebuffers(1, &m_fbo);
+	glDeleteTextures(1, &m_texture);
+
+	m_fbo = 0;
+	m_texture = 0;
+}
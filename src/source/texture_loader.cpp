@@ -0,0 +1,364 @@
+#include "../include/texture_loader.hpp"
+#include "../include/job_system.hpp"
+
+#include <stb_image.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <GL/glext.h>
+
+TextureLoader& TextureLoader::get()
+{
+	static TextureLoader texture_loader;
+	return texture_loader;
+}
+
+TextureLoader::TextureLoader()
+	: m_pending_count(0), m_stop(false), m_next_ticket(0), m_pbo(0), m_pbo_mapped(nullptr), m_pbo_fences{}, m_pbo_slot(0), m_max_anisotropy(-1.0f)
+{
+	// the cores the job system leaves free, so streaming next to the frame's jobs does not oversubscribe the CPU
+	const uint32_t core_count = std::thread::hardware_concurrency();
+	const uint32_t job_thread_count = JobSystem::get().get_thread_count();
+	const uint32_t worker_count = core_count > job_thread_count ? core_count - job_thread_count : 1;
+	for (uint32_t i = 0; i < worker_count; i++)
+	{
+		m_workers.emplace_back(&TextureLoader::worker_loop, this);
+	}
+}
+
+TextureLoader::~TextureLoader()
+{
+	// GL objects are released in shutdown(), by now the context is usually gone
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+
+	m_request_cv.notify_all();
+	m_space_cv.notify_all();
+
+	for (std::thread& worker : m_workers)
+	{
+		if (worker.joinable())
+		{
+			worker.join();
+		}
+	}
+
+	for (DecodedImage& image : m_decoded)
+	{
+		stbi_image_free(image.data);
+	}
+}
+
+uint32_t TextureLoader::load(const std::string& path, bool gamma, const uint8_t placeholder[4])
+{
+	if (m_max_anisotropy < 0.0f)
+	{
+		glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &m_max_anisotropy);
+	}
+
+	uint32_t texture_id;
+	glGenTextures(1, &texture_id);
+
+	glBindTexture(GL_TEXTURE_2D, texture_id);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder);
+
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, m_max_anisotropy);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	queue_request(texture_id, path, gamma);
+
+	return texture_id;
+}
+
+void TextureLoader::reload(uint32_t texture_id, const std::string& path, bool gamma)
+{
+	queue_request(texture_id, path, gamma);
+}
+
+void TextureLoader::cancel(uint32_t texture_id)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_cancelled_before[texture_id] = m_next_ticket;
+
+		// queued and decoded requests go now, the ones being decoded are dropped by their worker
+		const size_t request_count = m_requests.size();
+		m_requests.erase(std::remove_if(m_requests.begin(), m_requests.end(), [&](const DecodeRequest& request) { return request.texture_id == texture_id; }),
+			m_requests.end());
+		m_pending_count -= static_cast<uint32_t>(request_count - m_requests.size());
+
+		const size_t decoded_count = m_decoded.size();
+		m_decoded.erase(std::remove_if(m_decoded.begin(), m_decoded.end(), [&](DecodedImage& image)
+		{
+			if (image.texture_id != texture_id)
+			{
+				return false;
+			}
+
+			stbi_image_free(image.data);
+			return true;
+		}), m_decoded.end());
+		m_pending_count -= static_cast<uint32_t>(decoded_count - m_decoded.size());
+	}
+
+	m_space_cv.notify_all();
+}
+
+void TextureLoader::upload_pending(uint32_t max_uploads)
+{
+	if (!m_pbo)
+	{
+		create_pbo_ring();
+	}
+
+	for (uint32_t i = 0; i < max_uploads; i++)
+	{
+		DecodedImage image;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_decoded.empty())
+			{
+				break;
+			}
+
+			image = m_decoded.front();
+		}
+
+		// PBO ring is still in use by the GPU, try again next frame instead of stalling
+		if (!upload(image))
+		{
+			break;
+		}
+
+		stbi_image_free(image.data);
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_decoded.pop_front();
+			m_pending_count--;
+		}
+
+		m_space_cv.notify_one();
+	}
+}
+
+void TextureLoader::wait_idle()
+{
+	while (get_pending_count() > 0)
+	{
+		upload_pending(PBO_SLOT_COUNT);
+
+		// wait for the oldest PBO slot rather than spinning on it
+		GLsync fence = m_pbo_fences[m_pbo_slot];
+		if (fence)
+		{
+			glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+		}
+
+		std::this_thread::yield();
+	}
+}
+
+uint32_t TextureLoader::get_pending_count()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_pending_count;
+}
+
+void TextureLoader::shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+		m_requests.clear();
+	}
+
+	m_request_cv.notify_all();
+	m_space_cv.notify_all();
+
+	for (std::thread& worker : m_workers)
+	{
+		if (worker.joinable())
+		{
+			worker.join();
+		}
+	}
+
+	for (GLsync& fence : m_pbo_fences)
+	{
+		if (fence)
+		{
+			glDeleteSync(fence);
+			fence = nullptr;
+		}
+	}
+
+	if (m_pbo)
+	{
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pbo);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+		glDeleteBuffers(1, &m_pbo);
+		m_pbo = 0;
+		m_pbo_mapped = nullptr;
+	}
+}
+
+void TextureLoader::queue_request(uint32_t texture_id, const std::string& path, bool gamma)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_requests.push_back({ texture_id, m_next_ticket++, gamma, path });
+		m_pending_count++;
+	}
+
+	m_request_cv.notify_one();
+}
+
+bool TextureLoader::is_cancelled(uint32_t texture_id, uint64_t ticket) const
+{
+	auto it = m_cancelled_before.find(texture_id);
+	return it != m_cancelled_before.end() && ticket < it->second;
+}
+
+void TextureLoader::worker_loop()
+{
+	while (true)
+	{
+		DecodeRequest request;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_request_cv.wait(lock, [&]() { return m_stop || !m_requests.empty(); });
+
+			if (m_stop)
+			{
+				return;
+			}
+
+			request = std::move(m_requests.front());
+			m_requests.pop_front();
+		}
+
+		DecodedImage image{};
+		image.texture_id = request.texture_id;
+		image.ticket = request.ticket;
+		image.gamma = request.gamma;
+		image.path = std::move(request.path);
+		image.data = stbi_load(image.path.c_str(), &image.width, &image.height, &image.num_components, 0);
+
+		// bounded queue, keeps the amount of decoded memory in flight limited while the GL thread catches up
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_space_cv.wait(lock, [&]() { return m_stop || m_decoded.size() < MAX_DECODED_IMAGES; });
+
+		if (m_stop)
+		{
+			stbi_image_free(image.data);
+			return;
+		}
+
+		// the texture was released while decoding, its name may already belong to another texture
+		if (is_cancelled(image.texture_id, image.ticket))
+		{
+			stbi_image_free(image.data);
+			m_pending_count--;
+			continue;
+		}
+
+		m_decoded.push_back(std::move(image));
+	}
+}
+
+void TextureLoader::create_pbo_ring()
+{
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+	glGenBuffers(1, &m_pbo);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pbo);
+	glBufferStorage(GL_PIXEL_UNPACK_BUFFER, PBO_SLOT_COUNT * PBO_SLOT_SIZE, nullptr, flags);
+	m_pbo_mapped = static_cast<uint8_t*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, PBO_SLOT_COUNT * PBO_SLOT_SIZE, flags));
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	if (!m_pbo_mapped)
+	{
+		std::cout << "Failed to map texture upload buffer, falling back to direct uploads\n";
+	}
+}
+
+bool TextureLoader::upload(DecodedImage& image)
+{
+	if (!image.data)
+	{
+		std::cout << "Texture failed to load at path: " << image.path << std::endl;
+		return true;
+	}
+
+	GLenum data_format = GL_RGB;
+	GLenum format = GL_RGB;
+
+	if (image.num_components == 1)
+	{
+		data_format = GL_RED;
+		format = GL_RED;
+	}
+	else if (image.num_components == 3)
+	{
+		data_format = GL_RGB;
+		format = image.gamma ? GL_SRGB : GL_RGB;
+	}
+	else if (image.num_components == 4)
+	{
+		data_format = GL_RGBA;
+		format = image.gamma ? GL_SRGB_ALPHA : GL_RGBA;
+	}
+
+	const size_t size = static_cast<size_t>(image.width) * image.height * image.num_components;
+	const void* pixels = image.data;
+
+	// Images that do not fit in a slot are uploaded straight from client memory
+	const bool use_pbo = m_pbo_mapped && size <= PBO_SLOT_SIZE;
+	if (use_pbo)
+	{
+		GLsync& fence = m_pbo_fences[m_pbo_slot];
+		if (fence)
+		{
+			if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+			{
+				return false;
+			}
+
+			glDeleteSync(fence);
+			fence = nullptr;
+		}
+
+		const size_t offset = m_pbo_slot * PBO_SLOT_SIZE;
+		std::memcpy(m_pbo_mapped + offset, image.data, size);
+
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pbo);
+		pixels = reinterpret_cast<const void*>(offset);
+	}
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	glBindTexture(GL_TEXTURE_2D, image.texture_id);
+	glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, data_format, GL_UNSIGNED_BYTE, pixels);
+	glGenerateMipmap(GL_TEXTURE_2D);
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	if (use_pbo)
+	{
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+		m_pbo_fences[m_pbo_slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		m_pbo_slot = (m_pbo_slot + 1) % PBO_SLOT_COUNT;
+	}
+
+	return true;
+}
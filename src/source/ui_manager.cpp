@@ -1,4 +1,7 @@
 #include "../include/ui_manager.hpp"
+#include "../include/profiler.hpp"
+
+#include <string>
 
 
 UIManager::UIManager(GLFWwindow* window)
@@ -15,6 +18,48 @@ UIManager::UIManager(GLFWwindow* window)
 	ImGui_ImplOpenGL3_Init("#version 330 core");
 }
 
+void UIManager::draw_profiler()
+{
+	Profiler& profiler = Profiler::get();
+
+	ImGui::Begin("Profiler");
+
+	bool enabled = profiler.is_enabled();
+	if (ImGui::Checkbox("enabled", &enabled))
+	{
+		profiler.set_enabled(enabled);
+	}
+
+	ImGui::SameLine();
+	if (profiler.is_capturing())
+	{
+		ImGui::Text("capturing...");
+	}
+	else if (ImGui::Button("capture trace"))
+	{
+		profiler.start_capture(CAPTURE_FRAME_COUNT, "profile_capture.json");
+	}
+
+	ImGui::Text("frames without GPU times : %llu", static_cast<unsigned long long>(profiler.get_dropped_frame_count()));
+	ImGui::Separator();
+
+	for (const ProfileScopeResult& result : profiler.get_results())
+	{
+		const std::string& name = profiler.get_name(result.name_id);
+
+		ImGui::Text("%*s%-20s cpu %7.3f ms  gpu %7.3f ms  draws %5u  triangles %llu", static_cast<int>(result.depth * 2), "", name.c_str(),
+			result.cpu_ms, result.gpu_ms, result.draw_calls, static_cast<unsigned long long>(result.triangles));
+
+		// the GPU side for scopes that have one
+		const std::string label = "##" + name;
+		const float* history = result.gpu_ms >= 0.0f ? profiler.get_gpu_history(result.name_id) : profiler.get_cpu_history(result.name_id);
+		ImGui::PlotHistogram(label.c_str(), history, Profiler::HISTORY_SIZE, static_cast<int>(profiler.get_history_offset()),
+			nullptr, 0.0f, 3.4e38f, ImVec2(0.0f, 32.0f));
+	}
+
+	ImGui::End();
+}
+
 void UIManager::present()
 {
 	ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
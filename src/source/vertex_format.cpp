@@ -0,0 +1,220 @@
+#include "../include/vertex_format.hpp"
+
+#include <glad/glad.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <cstddef>
+#include <cstring>
+
+static float sign_not_zero(float value)
+{
+	return value >= 0.0f ? 1.0f : -1.0f;
+}
+
+// Maps a unit vector onto the [-1, 1] square of an octahedron unfolded around +z, decoded in test_packed_vertex.glsl
+static glm::vec2 octahedral_encode(const glm::vec3& vector)
+{
+	// assimp leaves zero tangents on meshes without UVs, which would divide into NaN
+	const float length = glm::abs(vector.x) + glm::abs(vector.y) + glm::abs(vector.z);
+	if (length == 0.0f)
+	{
+		return glm::vec2(0.0f);
+	}
+
+	const glm::vec3 n = vector / length;
+	if (n.z >= 0.0f)
+	{
+		return glm::vec2(n.x, n.y);
+	}
+
+	return glm::vec2((1.0f - glm::abs(n.y)) * sign_not_zero(n.x), (1.0f - glm::abs(n.x)) * sign_not_zero(n.y));
+}
+
+static void pack_attributes(const Vertex& vertex, uint32_t& normal, uint32_t& tangent, uint32_t& tex_coords)
+{
+	normal = glm::packSnorm2x16(octahedral_encode(vertex.normal));
+
+	// the bitangent is rebuilt as cross(normal, tangent) * w, so only its handedness is kept
+	const float bitangent_sign = sign_not_zero(glm::dot(glm::cross(vertex.normal, vertex.tangent), vertex.bitangent));
+	const glm::vec2 oct_tangent = octahedral_encode(vertex.tangent);
+	tangent = glm::packSnorm3x10_1x2(glm::vec4(oct_tangent.x, oct_tangent.y, 0.0f, bitangent_sign));
+
+	tex_coords = glm::packHalf2x16(vertex.tex_coords);
+}
+
+// scale of the quantization grid, uniform over all axes
+static float get_quantize_scale(const Bounds& bounds)
+{
+	const glm::vec3 extent = bounds.max - bounds.min;
+	return glm::max(glm::max(extent.x, extent.y), glm::max(extent.z, 1e-6f));
+}
+
+Vertex FullVertexPolicy::pack(const Vertex& vertex, const Bounds& bounds)
+{
+	return vertex;
+}
+
+void FullVertexPolicy::setup_attributes(uint32_t vao)
+{
+	glEnableVertexArrayAttrib(vao, 0);
+	glVertexArrayAttribFormat(vao, 0, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, position));
+	glVertexArrayAttribBinding(vao, 0, 0);
+
+	glEnableVertexArrayAttrib(vao, 1);
+	glVertexArrayAttribFormat(vao, 1, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, normal));
+	glVertexArrayAttribBinding(vao, 1, 0);
+
+	glEnableVertexArrayAttrib(vao, 2);
+	glVertexArrayAttribFormat(vao, 2, 2, GL_FLOAT, GL_FALSE, offsetof(Vertex, tex_coords));
+	glVertexArrayAttribBinding(vao, 2, 0);
+
+	glEnableVertexArrayAttrib(vao, 3);
+	glVertexArrayAttribFormat(vao, 3, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, tangent));
+	glVertexArrayAttribBinding(vao, 3, 0);
+
+	glEnableVertexArrayAttrib(vao, 4);
+	glVertexArrayAttribFormat(vao, 4, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, bitangent));
+	glVertexArrayAttribBinding(vao, 4, 0);
+}
+
+PackedVertex PackedVertexPolicy::pack(const Vertex& vertex, const Bounds& bounds)
+{
+	PackedVertex packed{};
+	packed.position[0] = vertex.position.x;
+	packed.position[1] = vertex.position.y;
+	packed.position[2] = vertex.position.z;
+
+	pack_attributes(vertex, packed.normal, packed.tangent, packed.tex_coords);
+
+	return packed;
+}
+
+// Shared by both packed layouts, only the position format differs
+static void setup_packed_attributes(uint32_t vao, uint32_t position_offset, uint32_t normal_offset, uint32_t tangent_offset, uint32_t tex_coords_offset, bool quantized)
+{
+	glEnableVertexArrayAttrib(vao, 0);
+	if (quantized)
+	{
+		glVertexArrayAttribFormat(vao, 0, 4, GL_UNSIGNED_SHORT, GL_TRUE, position_offset);
+	}
+	else
+	{
+		glVertexArrayAttribFormat(vao, 0, 3, GL_FLOAT, GL_FALSE, position_offset);
+	}
+	glVertexArrayAttribBinding(vao, 0, 0);
+
+	glEnableVertexArrayAttrib(vao, 1);
+	glVertexArrayAttribFormat(vao, 1, 2, GL_SHORT, GL_TRUE, normal_offset);
+	glVertexArrayAttribBinding(vao, 1, 0);
+
+	glEnableVertexArrayAttrib(vao, 2);
+	glVertexArrayAttribFormat(vao, 2, 2, GL_HALF_FLOAT, GL_FALSE, tex_coords_offset);
+	glVertexArrayAttribBinding(vao, 2, 0);
+
+	glEnableVertexArrayAttrib(vao, 3);
+	glVertexArrayAttribFormat(vao, 3, 4, GL_INT_2_10_10_10_REV, GL_TRUE, tangent_offset);
+	glVertexArrayAttribBinding(vao, 3, 0);
+
+	// no bitangent attribute (location 4), the shader reconstructs it
+}
+
+void PackedVertexPolicy::setup_attributes(uint32_t vao)
+{
+	setup_packed_attributes(vao, offsetof(PackedVertex, position), offsetof(PackedVertex, normal), offsetof(PackedVertex, tangent), offsetof(PackedVertex, tex_coords), false);
+}
+
+QuantizedVertex QuantizedVertexPolicy::pack(const Vertex& vertex, const Bounds& bounds)
+{
+	const float scale = get_quantize_scale(bounds);
+
+	QuantizedVertex packed{};
+	for (int i = 0; i < 3; i++)
+	{
+		packed.position[i] = glm::packUnorm1x16((vertex.position[i] - bounds.min[i]) / scale);
+	}
+
+	pack_attributes(vertex, packed.normal, packed.tangent, packed.tex_coords);
+
+	return packed;
+}
+
+void QuantizedVertexPolicy::setup_attributes(uint32_t vao)
+{
+	setup_packed_attributes(vao, offsetof(QuantizedVertex, position), offsetof(QuantizedVertex, normal), offsetof(QuantizedVertex, tangent), offsetof(QuantizedVertex, tex_coords), true);
+}
+
+glm::mat4 QuantizedVertexPolicy::get_dequantize_mat(const Bounds& bounds)
+{
+	const float scale = get_quantize_scale(bounds);
+	return glm::scale(glm::translate(glm::mat4(1.0f), bounds.min), glm::vec3(scale));
+}
+
+uint32_t get_vertex_size(VertexFormat format)
+{
+	switch (format)
+	{
+	case VertexFormat::Packed:
+		return sizeof(PackedVertex);
+	case VertexFormat::PackedQuantized:
+		return sizeof(QuantizedVertex);
+	default:
+		return sizeof(Vertex);
+	}
+}
+
+const char* get_vertex_format_name(VertexFormat format)
+{
+	switch (format)
+	{
+	case VertexFormat::Packed:
+		return "packed";
+	case VertexFormat::PackedQuantized:
+		return "quantized";
+	default:
+		return "full";
+	}
+}
+
+template <typename Policy>
+static void pack_vertices(const Vertex* vertices, size_t count, const Bounds& bounds, std::vector<uint8_t>& packed)
+{
+	packed.resize(count * sizeof(typename Policy::GpuVertex));
+
+	typename Policy::GpuVertex* gpu_vertices = reinterpret_cast<typename Policy::GpuVertex*>(packed.data());
+	for (size_t i = 0; i < count; i++)
+	{
+		gpu_vertices[i] = Policy::pack(vertices[i], bounds);
+	}
+}
+
+void pack_vertices(VertexFormat format, const Vertex* vertices, size_t count, const Bounds& bounds, std::vector<uint8_t>& packed)
+{
+	switch (format)
+	{
+	case VertexFormat::Packed:
+		pack_vertices<PackedVertexPolicy>(vertices, count, bounds, packed);
+		break;
+	case VertexFormat::PackedQuantized:
+		pack_vertices<QuantizedVertexPolicy>(vertices, count, bounds, packed);
+		break;
+	default:
+		pack_vertices<FullVertexPolicy>(vertices, count, bounds, packed);
+		break;
+	}
+}
+
+glm::vec3 get_vertex_position(VertexFormat format, const uint8_t* vertex)
+{
+	// copied out rather than cast, the stream is raw bytes
+	if (format == VertexFormat::PackedQuantized)
+	{
+		uint16_t position[3];
+		std::memcpy(position, vertex + offsetof(QuantizedVertex, position), sizeof(position));
+		return glm::vec3(position[0], position[1], position[2]) / 65535.0f;
+	}
+
+	float position[3];
+	std::memcpy(position, vertex + (format == VertexFormat::Packed ? offsetof(PackedVertex, position) : offsetof(Vertex, position)), sizeof(position));
+	return glm::vec3(position[0], position[1], position[2]);
+}